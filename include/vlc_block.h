@@ -167,6 +167,7 @@ static inline void block_Release( block_t *p_block )
 
 VLC_API block_t * block_heap_Alloc(void *, void *, size_t) VLC_USED;
 VLC_API block_t * block_mmap_Alloc(void *addr, size_t length) VLC_USED;
+VLC_API block_t * block_mmap_Slice(block_t *, size_t offset, size_t length) VLC_USED;
 VLC_API block_t * block_File(int fd) VLC_USED;
 
 static inline void block_Cleanup (void *block)
@@ -274,6 +275,61 @@ static inline block_t *block_ChainGather( block_t *p_list )
 
     block_ChainProperties( p_list, NULL, &i_total, &i_length );
 
+    /* If one block holds most of the data, gather the others around it: it
+     * is only moved if it lacks head or tail room. */
+    block_t *p_big = p_list;
+    size_t i_pre = 0, i_offset = 0;
+    for( g = p_list; g != NULL; g = g->p_next )
+    {
+        if( g->i_buffer > p_big->i_buffer )
+        {
+            p_big = g;
+            i_pre = i_offset;
+        }
+        i_offset += g->i_buffer;
+    }
+
+    if( p_big->i_buffer > 0 && p_big->i_buffer >= i_total / 2 )
+    {
+        const uint32_t i_flags = p_list->i_flags;
+        const mtime_t i_pts = p_list->i_pts;
+        const mtime_t i_dts = p_list->i_dts;
+        const size_t i_big = p_big->i_buffer;
+        block_t **pp = &p_list;
+
+        while( *pp != p_big )
+            pp = &(*pp)->p_next;
+        *pp = p_big->p_next;
+        p_big->p_next = NULL;
+
+        g = block_Realloc( p_big, i_pre, i_total - i_pre );
+        if( g )
+        {
+            bool b_big = false;
+
+            i_offset = 0;
+            for( block_t *b = p_list; b != NULL; b = b->p_next )
+            {
+                if( !b_big && i_offset == i_pre )
+                {
+                    i_offset += i_big;
+                    b_big = true;
+                }
+                memcpy( &g->p_buffer[i_offset], b->p_buffer, b->i_buffer );
+                i_offset += b->i_buffer;
+            }
+
+            g->i_flags = i_flags;
+            g->i_pts   = i_pts;
+            g->i_dts   = i_dts;
+            g->i_length = i_length;
+            g->i_rate = 0;
+            g->i_nb_samples = 0;
+        }
+        block_ChainRelease( p_list );
+        return g;
+    }
+
     g = block_Alloc( i_total );
     block_ChainExtract( p_list, g->p_buffer, g->i_buffer );
 
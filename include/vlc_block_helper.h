@@ -451,9 +451,25 @@ static inline int block_PeekOffsetBytes( block_bytestream_t *p_bytestream,
     return VLC_SUCCESS;
 }
 
+/**
+ * Fast start code search within a single buffer.
+ *
+ * It returns the first occurrence of the start code lying entirely in
+ * [p, end), or NULL if there is none.
+ */
+typedef const uint8_t *(*block_startcode_helper_t)( const uint8_t *p,
+                                                    const uint8_t *end );
+
+/**
+ * Finds a start code in the bytestream, from the given offset.
+ *
+ * The optional helper is used to search within each block, only the block
+ * boundaries are then checked byte per byte.
+ */
 static inline int block_FindStartcodeFromOffset(
     block_bytestream_t *p_bytestream, size_t *pi_offset,
-    const uint8_t *p_startcode, int i_startcode_length )
+    const uint8_t *p_startcode, int i_startcode_length,
+    block_startcode_helper_t pf_startcode_helper )
 {
     block_t *p_block, *p_block_backup = 0;
     int i_size = 0;
@@ -483,7 +499,25 @@ static inline int block_FindStartcodeFromOffset(
     i_match = 0;
     for( ; p_block != NULL; p_block = p_block->p_next )
     {
-        for( i_offset = i_size; i_offset < p_block->i_buffer; i_offset++ )
+        i_offset = i_size;
+
+        /* Search within the block, unless a match is in progress */
+        if( pf_startcode_helper && !i_match &&
+            i_offset + i_startcode_length < p_block->i_buffer )
+        {
+            const uint8_t *p_res =
+                pf_startcode_helper( &p_block->p_buffer[i_offset],
+                                     &p_block->p_buffer[p_block->i_buffer] );
+            if( p_res )
+            {
+                *pi_offset += p_res - p_block->p_buffer;
+                return VLC_SUCCESS;
+            }
+            /* Only a start code across the boundary is left to check */
+            i_offset = p_block->i_buffer - (i_startcode_length - 1);
+        }
+
+        for( ; i_offset < p_block->i_buffer; i_offset++ )
         {
             if( p_block->p_buffer[i_offset] == p_startcode[i_match] )
             {
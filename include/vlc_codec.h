@@ -69,6 +69,10 @@ struct decoder_t
     /* Tell the decoder if it is allowed to drop frames */
     bool                b_pace_control;
 
+    /* Number of extra (ie in addition to the DPB) picture buffers
+     * needed for decoding the video */
+    int                 i_extra_picture_buffers;
+
     /* */
     picture_t *         ( * pf_decode_video )( decoder_t *, block_t ** );
     aout_buffer_t *     ( * pf_decode_audio )( decoder_t *, block_t ** );
@@ -232,7 +236,9 @@ VLC_API int decoder_GetInputAttachments( decoder_t *, input_attachment_t ***ppp_
 
 /**
  * This function converts a decoder timestamp into a display date comparable
- * to mdate().
+ * to mdate(). For video, the time needed by the video output to filter and
+ * render the picture is taken into account: it is the date at which the
+ * picture must be output by the decoder.
  * You MUST use it *only* for gathering statistics about speed.
  */
 VLC_API mtime_t decoder_GetDisplayDate( decoder_t *, mtime_t ) VLC_USED;
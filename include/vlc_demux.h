@@ -207,6 +207,18 @@ VLC_API void demux_PacketizerDestroy( decoder_t *p_packetizer );
  */
 VLC_API input_thread_t * demux_GetParentInput( demux_t *p_demux ) VLC_USED;
 
+/**
+ * These functions keep the index that a demuxer built for a local file
+ * (typically by scanning the whole file) in the user cache directory, so
+ * that it does not need to be built again the next time the file is opened.
+ *
+ * The payload format is private to the demuxer, and identified by its name
+ * and version. A cached index is only returned for the same file, size and
+ * modification time.
+ */
+VLC_API block_t * demux_IndexCacheLoad( demux_t *, const char *psz_name, uint32_t i_version ) VLC_USED;
+VLC_API int demux_IndexCacheStore( demux_t *, const char *psz_name, uint32_t i_version, const void *, size_t );
+
 /* */
 #define DEMUX_INIT_COMMON() do {            \
     p_demux->pf_control = Control;          \
@@ -281,6 +281,8 @@ struct input_stats_t
     int64_t i_read_bytes;
     float f_input_bitrate;
     float f_average_input_bitrate;
+    int64_t i_read_cache_hits;
+    int64_t i_read_cache_misses;
 
     /* Demux */
     int64_t i_demux_read_packets;
@@ -290,6 +292,11 @@ struct input_stats_t
     int64_t i_demux_corrupted;
     int64_t i_demux_discontinuity;
 
+    /* Clock (microseconds) */
+    int64_t i_clock_drift;
+    int64_t i_clock_jitter;
+    int64_t i_clock_buffering;
+
     /* Decoders */
     int64_t i_decoded_audio;
     int64_t i_decoded_video;
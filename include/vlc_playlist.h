@@ -291,9 +291,17 @@ VLC_API void playlist_Clear( playlist_t *, bool );
 /** Enqueue an input item for preparsing */
 VLC_API int playlist_PreparseEnqueue(playlist_t *, input_item_t * );
 
+/** Enqueue an input item for preparsing ahead of the other waiting items
+ * (for instance because it is visible) */
+VLC_API int playlist_PreparsePrioritize(playlist_t *, input_item_t * );
+
 /** Request the art for an input item to be fetched */
 VLC_API int playlist_AskForArtEnqueue(playlist_t *, input_item_t * );
 
+/** Get the URI of a thumbnail of the art of an input item, fitting in a
+ * square of the given size, without decoding the full art when it is cached */
+VLC_API char * playlist_GetArtThumbnail(playlist_t *, input_item_t *, unsigned ) VLC_USED;
+
 /* Playlist sorting */
 VLC_API int playlist_TreeMove( playlist_t *, playlist_item_t *, playlist_item_t *, int );
 VLC_API int playlist_TreeMoveMany( playlist_t *, int, playlist_item_t **, playlist_item_t *, int );
@@ -270,7 +270,9 @@ static inline char* sql_VPrintf( sql_t *p_sql, const char *psz_fmt,
  * @brief Begin a SQL transaction
  * @param p_sql The SQL object
  * @return VLC error code or success
- * @note This function is threadsafe
+ * @note This function is threadsafe. A transaction begun by a thread which
+ * is already in a transaction is nested in it: it can be rolled back alone,
+ * but it is only committed with the outermost transaction.
  **/
 static inline int sql_BeginTransaction( sql_t *p_sql )
 {
@@ -374,7 +376,7 @@ static inline int sql_BindDouble( sql_t *p_sql, sql_stmt_t* p_stmt,
     sql_value_t value;
     value.length = 0;
     value.value.dbl = d_dbl;
-    int i_ret = sql_BindGeneric( p_sql, p_stmt, i_pos, SQL_INT, &value );
+    int i_ret = sql_BindGeneric( p_sql, p_stmt, i_pos, SQL_DOUBLE, &value );
     return i_ret;
 }
 
@@ -413,7 +415,7 @@ static inline int sql_BindBlob( sql_t *p_sql, sql_stmt_t* p_stmt, int i_pos,
     sql_value_t value;
     value.length = i_length;
     value.value.ptr = p_ptr;
-    int i_ret = sql_BindGeneric( p_sql, p_stmt, i_pos, SQL_INT, &value );
+    int i_ret = sql_BindGeneric( p_sql, p_stmt, i_pos, SQL_BLOB, &value );
     return i_ret;
 }
 
@@ -111,6 +111,9 @@ enum stream_query_e
 
     /* XXX only data read through stream_Read/Block will be recorded */
     STREAM_SET_RECORD_STATE,     /**< arg1=bool, arg2=const char *psz_ext (if arg1 is true)  res=can fail */
+
+    /* Reads go through the network, even if seeking is fast */
+    STREAM_IS_REMOTE,            /**< arg1= bool *   res=can fail (not remote) */
 };
 
 VLC_API int stream_Read( stream_t *s, void *p_read, int i_read );
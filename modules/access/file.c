@@ -64,6 +64,9 @@
 #   include <unistd.h>
 #endif
 #include <dirent.h>
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #if defined( WIN32 ) && !defined( UNDER_CE )
 #   ifdef lseek
@@ -87,8 +90,21 @@ struct access_sys_t
     /* */
     unsigned caching;
     bool b_pace_control;
+    bool b_remote;
+#ifdef HAVE_MMAP
+    size_t page_mask;
+#endif
 };
 
+#ifdef HAVE_MMAP
+/* Size of the file windows handed out as blocks, in bytes. This should be
+ * large enough to amortize the mmap() and page fault costs, while leaving
+ * room for a couple of windows in the stream cache. */
+# define MMAP_WINDOW_SIZE (4 << 20)
+
+static block_t *FileBlock (access_t *);
+#endif
+
 #if !defined (WIN32) && !defined (__OS2__)
 static bool IsRemote (int fd)
 {
@@ -219,7 +235,8 @@ int Open( vlc_object_t *p_this )
     p_sys->i_nb_reads = 0;
     p_sys->fd = fd;
     p_sys->caching = var_InheritInteger (p_access, "file-caching");
-    if (IsRemote(fd))
+    p_sys->b_remote = IsRemote(fd);
+    if (p_sys->b_remote)
         p_sys->caching += var_InheritInteger (p_access, "network-caching");
     p_sys->b_pace_control = true;
 
@@ -248,6 +265,21 @@ int Open( vlc_object_t *p_this )
 # endif
 #endif
     }
+
+#ifdef HAVE_MMAP
+    /* Local regular files can be mapped in memory and read without any
+     * copy. Remote files are excluded: a server-side truncation would kill
+     * the process with SIGBUS, and the page faults are not cheaper than
+     * read() over the network anyway. */
+    if (S_ISREG (st.st_mode) && !p_sys->b_remote
+     && var_InheritBool (p_access, "file-mmap"))
+    {
+        msg_Dbg (p_access, "using memory mapped reads");
+        p_sys->page_mask = sysconf (_SC_PAGESIZE) - 1;
+        p_access->pf_read = NULL;
+        p_access->pf_block = FileBlock;
+    }
+#endif
     return VLC_SUCCESS;
 
 error:
@@ -262,7 +294,7 @@ void Close (vlc_object_t * p_this)
 {
     access_t     *p_access = (access_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_control != FileControl)
     {
         DirClose (p_this);
         return;
@@ -333,6 +365,72 @@ ssize_t FileRead( access_t *p_access, uint8_t *p_buffer, size_t i_len )
     return i_ret;
 }
 
+#ifdef HAVE_MMAP
+#ifndef HAVE_POSIX_MADVISE
+# define posix_madvise(addr, len, adv)
+#endif
+
+/*****************************************************************************
+ * Block: map the next window of the file in memory
+ *****************************************************************************/
+static block_t *FileBlock (access_t *p_access)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    int fd = p_sys->fd;
+    uint64_t i_pos = p_access->info.i_pos;
+
+    if (i_pos >= p_access->info.i_size)
+    {
+        /* The file may be growing */
+        struct stat st;
+
+        if (fstat (fd, &st) == 0
+         && p_access->info.i_size != (uint64_t)st.st_size)
+        {
+            p_access->info.i_size = st.st_size;
+            p_access->info.i_update |= INPUT_UPDATE_SIZE;
+        }
+        if (i_pos >= p_access->info.i_size)
+        {
+            p_access->info.b_eof = true;
+            return NULL;
+        }
+    }
+
+    /* The mapping offset must be page aligned */
+    const uint64_t i_offset = i_pos & ~(uint64_t)p_sys->page_mask;
+    const size_t i_skip = i_pos - i_offset;
+    size_t i_length = MMAP_WINDOW_SIZE;
+    if (i_length > p_access->info.i_size - i_offset)
+        i_length = p_access->info.i_size - i_offset;
+
+    /* Demuxers may modify their blocks in place (byte swapping...): map the
+     * window copy-on-write, so that only the modified pages get copied. */
+    void *addr = mmap (NULL, i_length, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+                       fd, i_offset);
+    if (addr == MAP_FAILED)
+    {
+        msg_Err (p_access, "cannot map file (%m)");
+        dialog_Fatal (p_access, _("File reading failed"), "%s",
+                      _("VLC could not read the file."));
+        p_access->info.b_eof = true;
+        return NULL;
+    }
+    /* The window will be read once and in order */
+    posix_madvise (addr, i_length, POSIX_MADV_SEQUENTIAL);
+    posix_madvise (addr, i_length, POSIX_MADV_WILLNEED);
+
+    block_t *p_block = block_mmap_Alloc (addr, i_length);
+    if (unlikely(p_block == NULL))
+        return NULL;
+
+    p_block->p_buffer += i_skip;
+    p_block->i_buffer -= i_skip;
+    p_access->info.i_pos += p_block->i_buffer;
+    p_sys->i_nb_reads++;
+    return p_block;
+}
+#endif
 
 /*****************************************************************************
  * Seek: seek to a specific location in a file
@@ -371,6 +469,12 @@ int FileControl( access_t *p_access, int i_query, va_list args )
             *pb_bool = (p_access->pf_seek != NoSeek);
             break;
 
+        case ACCESS_IS_REMOTE:
+            /* Reading from network shares costs a round trip */
+            pb_bool = (bool*)va_arg( args, bool* );
+            *pb_bool = p_sys->b_remote;
+            break;
+
         case ACCESS_CAN_PAUSE:
         case ACCESS_CAN_CONTROL_PACE:
             pb_bool = (bool*)va_arg( args, bool* );
@@ -38,6 +38,12 @@
 #define NETWORK_CACHING_LONGTEXT N_( \
     "Supplementary caching value for remote files, in milliseconds." )
 
+#define MMAP_TEXT N_("Use memory mapping")
+#define MMAP_LONGTEXT N_( \
+    "Map local files in memory instead of reading them. This avoids " \
+    "copying the data, but the file must not be truncated while it is " \
+    "being played." )
+
 #define RECURSIVE_TEXT N_("Subdirectory behavior")
 #define RECURSIVE_LONGTEXT N_( \
         "Select whether subdirectories must be expanded.\n" \
@@ -68,6 +74,9 @@ vlc_module_begin ()
                  NETWORK_CACHING_TEXT, NETWORK_CACHING_LONGTEXT, true )
         change_safe()
     add_obsolete_string( "file-cat" )
+#ifdef HAVE_MMAP
+    add_bool( "file-mmap", false, MMAP_TEXT, MMAP_LONGTEXT, true )
+#endif
     set_capability( "access", 50 )
     add_shortcut( "file", "fd", "stream" )
     set_callbacks( Open, Close )
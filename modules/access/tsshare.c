@@ -0,0 +1,723 @@
+/*****************************************************************************
+ * tsshare.c: MPEG-TS programs access sharing a single source
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/***
+Monitoring several services of a multiplex used to require one input per
+service, each of them reading and demultiplexing the whole stream. With
+    tsshare://<program>@<mrl>
+all the inputs opening the same MRL share a single source: one thread reads
+it, follows its PAT and PMTs, and hands each input only the TS packets of
+its program, with a PAT rewritten to list that program only. Program 0
+forwards the whole multiplex.
+***/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_access.h>
+#include <vlc_stream.h>
+#include <vlc_block.h>
+
+#include <assert.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+#define CACHING_TEXT N_("Caching value in ms")
+#define CACHING_LONGTEXT N_( \
+    "Caching value for shared MPEG-TS programs. This " \
+    "value should be set in milliseconds." )
+
+#define QUEUE_TEXT N_("Queue size (kB)")
+#define QUEUE_LONGTEXT N_( \
+    "Amount of data queued for each program. When the queue of a program " \
+    "is full, the shared source waits if it is a file, and the data of " \
+    "that program are dropped otherwise.")
+
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+vlc_module_begin ()
+    set_shortname( N_("TS share") )
+    set_description( N_("Shared MPEG-TS programs input") )
+    set_category( CAT_INPUT )
+    set_subcategory( SUBCAT_INPUT_ACCESS )
+
+    add_integer( "tsshare-caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT,
+                 CACHING_LONGTEXT, true )
+        change_safe()
+    add_integer( "tsshare-queue-size", 8192, QUEUE_TEXT, QUEUE_LONGTEXT,
+                 true )
+        change_integer_range( 256, 1024 * 1024 )
+
+    set_capability( "access", 0 )
+    add_shortcut( "tsshare" )
+
+    set_callbacks( Open, Close )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+#define TS_PACKET_SIZE 188
+/* Number of TS packets read at once from the source */
+#define TS_BATCH 128
+
+/* PSI section being reassembled */
+typedef struct
+{
+    bool     b_started;
+    size_t   i_size;
+    uint8_t  p_data[1024];
+} ts_section_t;
+
+/* One program, read by one access */
+typedef struct
+{
+    uint16_t     i_program;  /* 0 forwards the whole multiplex */
+    uint16_t     i_pmt_pid;  /* 0 until the program is found in the PAT */
+    uint8_t      i_pat_cc;
+    uint8_t      pids[8192 / 8]; /* PIDs of the program */
+    ts_section_t pmt;
+
+    /* Packets of the batch being dispatched */
+    block_t      *p_batch;
+
+    /* Queue, protected by the source lock */
+    block_t      *p_first;
+    block_t      **pp_last;
+    size_t       i_queued;
+    bool         b_overflow;
+} ts_output_t;
+
+typedef struct ts_source_t ts_source_t;
+struct ts_source_t
+{
+    ts_source_t  *p_next;
+    char         *psz_mrl;
+    unsigned     i_refs;
+
+    vlc_object_t *p_obj;
+    stream_t     *s;
+    bool         b_can_pace;
+    vlc_thread_t thread;
+
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait_data;
+    vlc_cond_t   wait_space;
+    int          i_outputs;
+    ts_output_t  **pp_outputs;
+    size_t       i_queue_max;
+    bool         b_eof;
+
+    /* Reader thread only */
+    ts_section_t pat;
+};
+
+struct access_sys_t
+{
+    ts_source_t  *p_source;
+    ts_output_t  *p_output;
+};
+
+/* All the shared sources */
+static vlc_mutex_t sources_lock = VLC_STATIC_MUTEX;
+static ts_source_t *p_sources = NULL;
+
+static block_t *Block( access_t * );
+static int Control( access_t *, int, va_list );
+static void *Thread( void * );
+
+/*****************************************************************************
+ * Source management
+ *****************************************************************************/
+static ts_source_t *SourceHold( access_t *p_access, const char *psz_mrl,
+                                size_t i_queue_max )
+{
+    ts_source_t *p_src;
+
+    vlc_mutex_lock( &sources_lock );
+    for( p_src = p_sources; p_src != NULL; p_src = p_src->p_next )
+    {
+        if( !strcmp( p_src->psz_mrl, psz_mrl ) )
+        {
+            p_src->i_refs++;
+            goto out;
+        }
+    }
+
+    p_src = calloc( 1, sizeof( *p_src ) );
+    if( p_src == NULL )
+        goto out;
+    p_src->psz_mrl = strdup( psz_mrl );
+    p_src->i_refs = 1;
+    p_src->i_queue_max = i_queue_max;
+
+    /* The source outlives the access that created it */
+    p_src->p_obj = vlc_object_create( p_access->p_libvlc,
+                                      sizeof( *p_src->p_obj ) );
+    if( p_src->psz_mrl == NULL || p_src->p_obj == NULL )
+        goto error;
+
+    p_src->s = stream_UrlNew( p_src->p_obj, psz_mrl );
+    if( p_src->s == NULL )
+    {
+        msg_Err( p_access, "cannot open %s", psz_mrl );
+        goto error;
+    }
+    stream_Control( p_src->s, STREAM_CAN_SEEK, &p_src->b_can_pace );
+
+    vlc_mutex_init( &p_src->lock );
+    vlc_cond_init( &p_src->wait_data );
+    vlc_cond_init( &p_src->wait_space );
+    if( vlc_clone( &p_src->thread, Thread, p_src, VLC_THREAD_PRIORITY_INPUT ) )
+    {
+        vlc_cond_destroy( &p_src->wait_space );
+        vlc_cond_destroy( &p_src->wait_data );
+        vlc_mutex_destroy( &p_src->lock );
+        stream_Delete( p_src->s );
+        goto error;
+    }
+
+    msg_Dbg( p_access, "sharing %s", psz_mrl );
+    p_src->p_next = p_sources;
+    p_sources = p_src;
+out:
+    vlc_mutex_unlock( &sources_lock );
+    return p_src;
+
+error:
+    if( p_src->p_obj )
+        vlc_object_release( p_src->p_obj );
+    free( p_src->psz_mrl );
+    free( p_src );
+    vlc_mutex_unlock( &sources_lock );
+    return NULL;
+}
+
+static void SourceRelease( ts_source_t *p_src )
+{
+    vlc_mutex_lock( &sources_lock );
+    if( --p_src->i_refs > 0 )
+    {
+        vlc_mutex_unlock( &sources_lock );
+        return;
+    }
+
+    ts_source_t **pp = &p_sources;
+    while( *pp != p_src )
+        pp = &(*pp)->p_next;
+    *pp = p_src->p_next;
+    vlc_mutex_unlock( &sources_lock );
+
+    vlc_cancel( p_src->thread );
+    vlc_join( p_src->thread, NULL );
+
+    assert( p_src->i_outputs == 0 );
+    free( p_src->pp_outputs );
+    vlc_cond_destroy( &p_src->wait_space );
+    vlc_cond_destroy( &p_src->wait_data );
+    vlc_mutex_destroy( &p_src->lock );
+    stream_Delete( p_src->s );
+    vlc_object_release( p_src->p_obj );
+    free( p_src->psz_mrl );
+    free( p_src );
+}
+
+/*****************************************************************************
+ * Open: parse the program and MRL, and join the shared source
+ *****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    access_t *p_access = (access_t*)p_this;
+    const char *psz_location = p_access->psz_location;
+    char *psz_end;
+
+    /* <program>@<mrl> */
+    unsigned long i_program = strtoul( psz_location, &psz_end, 0 );
+    if( psz_end == psz_location || *psz_end != '@' || psz_end[1] == '\0' ||
+        i_program > 0xffff )
+    {
+        msg_Err( p_access, "invalid location %s, expected <program>@<mrl>",
+                 psz_location );
+        return VLC_EGENERIC;
+    }
+
+    access_sys_t *p_sys = malloc( sizeof( *p_sys ) );
+    ts_output_t *p_out = calloc( 1, sizeof( *p_out ) );
+    if( p_sys == NULL || p_out == NULL )
+    {
+        free( p_out );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+
+    p_out->i_program = i_program;
+    p_out->pp_last = &p_out->p_first;
+    /* Forward the SDT and TDT/TOT along with the program */
+    p_out->pids[0x11 / 8] |= 1 << (0x11 % 8);
+    p_out->pids[0x14 / 8] |= 1 << (0x14 % 8);
+
+    const size_t i_queue_max =
+        var_InheritInteger( p_access, "tsshare-queue-size" ) * 1024;
+    ts_source_t *p_src = SourceHold( p_access, psz_end + 1, i_queue_max );
+    if( p_src == NULL )
+    {
+        free( p_out );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    vlc_mutex_lock( &p_src->lock );
+    TAB_APPEND( p_src->i_outputs, p_src->pp_outputs, p_out );
+    vlc_mutex_unlock( &p_src->lock );
+
+    p_sys->p_source = p_src;
+    p_sys->p_output = p_out;
+
+    access_InitFields( p_access );
+    ACCESS_SET_CALLBACKS( NULL, Block, Control, NULL );
+    p_access->p_sys = p_sys;
+    free( p_access->psz_demux );
+    p_access->psz_demux = strdup( "ts" );
+
+    var_Create( p_access, "tsshare-caching",
+                VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Close: leave the shared source
+ *****************************************************************************/
+static void Close( vlc_object_t *p_this )
+{
+    access_t *p_access = (access_t*)p_this;
+    access_sys_t *p_sys = p_access->p_sys;
+    ts_source_t *p_src = p_sys->p_source;
+    ts_output_t *p_out = p_sys->p_output;
+
+    vlc_mutex_lock( &p_src->lock );
+    TAB_REMOVE( p_src->i_outputs, p_src->pp_outputs, p_out );
+    vlc_cond_signal( &p_src->wait_space );
+    vlc_mutex_unlock( &p_src->lock );
+
+    SourceRelease( p_src );
+
+    block_ChainRelease( p_out->p_first );
+    if( p_out->p_batch )
+        block_Release( p_out->p_batch );
+    free( p_out );
+    free( p_sys );
+}
+
+/*****************************************************************************
+ * Control:
+ *****************************************************************************/
+static int Control( access_t *p_access, int i_query, va_list args )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    bool    *pb_bool;
+    int64_t *pi_64;
+
+    switch( i_query )
+    {
+        /* */
+        case ACCESS_CAN_SEEK:
+        case ACCESS_CAN_FASTSEEK:
+        case ACCESS_CAN_PAUSE:
+            pb_bool = (bool*)va_arg( args, bool* );
+            *pb_bool = false;
+            break;
+        case ACCESS_CAN_CONTROL_PACE:
+            pb_bool = (bool*)va_arg( args, bool* );
+            *pb_bool = p_sys->p_source->b_can_pace;
+            break;
+        /* */
+        case ACCESS_GET_PTS_DELAY:
+            pi_64 = (int64_t*)va_arg( args, int64_t * );
+            *pi_64 = var_GetInteger( p_access, "tsshare-caching" ) * 1000;
+            break;
+
+        /* */
+        case ACCESS_SET_PAUSE_STATE:
+        case ACCESS_GET_TITLE_INFO:
+        case ACCESS_SET_TITLE:
+        case ACCESS_SET_SEEKPOINT:
+        case ACCESS_SET_PRIVATE_ID_STATE:
+        case ACCESS_GET_CONTENT_TYPE:
+            return VLC_EGENERIC;
+
+        default:
+            msg_Warn( p_access, "unimplemented query in control" );
+            return VLC_EGENERIC;
+
+    }
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Block: dequeue the packets of the program
+ *****************************************************************************/
+static block_t *Block( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    ts_source_t *p_src = p_sys->p_source;
+    ts_output_t *p_out = p_sys->p_output;
+    block_t *p_block;
+
+    if( p_access->info.b_eof )
+        return NULL;
+
+    vlc_mutex_lock( &p_src->lock );
+    mutex_cleanup_push( &p_src->lock );
+    /* Do not wait for too long, so that the input can be stopped */
+    if( p_out->p_first == NULL && !p_src->b_eof )
+        vlc_cond_timedwait( &p_src->wait_data, &p_src->lock,
+                            mdate() + CLOCK_FREQ / 10 );
+    vlc_cleanup_pop();
+
+    p_block = p_out->p_first;
+    if( p_block != NULL )
+    {
+        p_out->p_first = p_block->p_next;
+        if( p_out->p_first == NULL )
+            p_out->pp_last = &p_out->p_first;
+        p_block->p_next = NULL;
+        p_out->i_queued -= p_block->i_buffer;
+        vlc_cond_signal( &p_src->wait_space );
+    }
+    else if( p_src->b_eof )
+        p_access->info.b_eof = true;
+    vlc_mutex_unlock( &p_src->lock );
+
+    return p_block;
+}
+
+/*****************************************************************************
+ * PSI
+ *****************************************************************************/
+static uint32_t CRC32( const uint8_t *p, size_t i_size )
+{
+    uint32_t i_crc = 0xffffffff;
+
+    while( i_size-- > 0 )
+    {
+        i_crc ^= (uint32_t)*p++ << 24;
+        for( int i = 0; i < 8; i++ )
+            i_crc = ( i_crc << 1 ) ^ ( ( i_crc & 0x80000000 ) ? 0x04c11db7 : 0 );
+    }
+    return i_crc;
+}
+
+/* Reassembles the section carried by a PSI packet, returns true once a
+ * valid section is complete */
+static bool SectionPush( ts_section_t *p_sec, const uint8_t *p )
+{
+    const uint8_t *p_end = p + TS_PACKET_SIZE;
+    const bool b_unit_start = p[1]&0x40;
+
+    if( !( p[3]&0x10 ) ) /* No payload */
+        return false;
+    if( p[3]&0x20 ) /* Adaptation field */
+        p += 5 + p[4];
+    else
+        p += 4;
+
+    if( b_unit_start )
+    {
+        if( p >= p_end )
+            return false;
+        p += 1 + p[0]; /* pointer_field */
+        p_sec->b_started = true;
+        p_sec->i_size = 0;
+    }
+    if( !p_sec->b_started || p >= p_end )
+        return false;
+
+    const size_t i_copy = __MIN( (size_t)(p_end - p),
+                                 sizeof( p_sec->p_data ) - p_sec->i_size );
+    memcpy( &p_sec->p_data[p_sec->i_size], p, i_copy );
+    p_sec->i_size += i_copy;
+    if( p_sec->i_size < 3 )
+        return false;
+
+    const size_t i_length = 3 + ( ( ( p_sec->p_data[1]&0x0f ) << 8 ) |
+                                  p_sec->p_data[2] );
+    if( i_length > sizeof( p_sec->p_data ) || i_length < 12 )
+    {
+        p_sec->b_started = false;
+        return false;
+    }
+    if( p_sec->i_size < i_length )
+        return false;
+
+    p_sec->b_started = false;
+    p_sec->i_size = i_length;
+    return CRC32( p_sec->p_data, i_length ) == 0;
+}
+
+static void OutputQueue( ts_output_t *p_out, const uint8_t *p )
+{
+    block_t *p_batch = p_out->p_batch;
+
+    if( p_batch == NULL )
+    {
+        p_batch = block_Alloc( TS_BATCH * TS_PACKET_SIZE );
+        if( p_batch == NULL )
+            return;
+        p_batch->i_buffer = 0;
+        p_out->p_batch = p_batch;
+    }
+    if( p_batch->i_buffer + TS_PACKET_SIZE > TS_BATCH * TS_PACKET_SIZE )
+        return;
+
+    memcpy( &p_batch->p_buffer[p_batch->i_buffer], p, TS_PACKET_SIZE );
+    p_batch->i_buffer += TS_PACKET_SIZE;
+}
+
+/* Queues a PAT listing only the program of the output */
+static void OutputPAT( ts_output_t *p_out, uint16_t i_tsid, uint8_t i_version )
+{
+    uint8_t p[TS_PACKET_SIZE];
+    uint8_t *p_sec = &p[5];
+
+    memset( p, 0xff, sizeof( p ) );
+    p[0] = 0x47;
+    p[1] = 0x40; /* unit start, PID 0 */
+    p[2] = 0x00;
+    p[3] = 0x10 | p_out->i_pat_cc;
+    p[4] = 0x00; /* pointer_field */
+    p_out->i_pat_cc = ( p_out->i_pat_cc + 1 )&0x0f;
+
+    p_sec[0] = 0x00; /* table_id */
+    p_sec[1] = 0xb0;
+    p_sec[2] = 13;   /* section_length */
+    p_sec[3] = i_tsid >> 8;
+    p_sec[4] = i_tsid;
+    p_sec[5] = 0xc1 | ( i_version << 1 );
+    p_sec[6] = 0x00;
+    p_sec[7] = 0x00;
+    p_sec[8] = p_out->i_program >> 8;
+    p_sec[9] = p_out->i_program;
+    p_sec[10] = 0xe0 | ( p_out->i_pmt_pid >> 8 );
+    p_sec[11] = p_out->i_pmt_pid;
+    SetDWBE( &p_sec[12], CRC32( p_sec, 12 ) );
+
+    OutputQueue( p_out, p );
+}
+
+static void ParsePAT( ts_source_t *p_src )
+{
+    const uint8_t *p_data = p_src->pat.p_data;
+    const size_t i_size = p_src->pat.i_size;
+
+    if( p_data[0] != 0x00 || !( p_data[5]&0x01 ) )
+        return;
+
+    const uint16_t i_tsid = GetWBE( &p_data[3] );
+    const uint8_t i_version = ( p_data[5] >> 1 )&0x1f;
+
+    for( int i = 0; i < p_src->i_outputs; i++ )
+    {
+        ts_output_t *p_out = p_src->pp_outputs[i];
+        uint16_t i_pmt_pid = 0;
+
+        if( p_out->i_program == 0 )
+            continue;
+
+        for( size_t i_pos = 8; i_pos + 4 <= i_size - 4; i_pos += 4 )
+        {
+            if( GetWBE( &p_data[i_pos] ) == p_out->i_program )
+            {
+                i_pmt_pid = GetWBE( &p_data[i_pos + 2] )&0x1fff;
+                break;
+            }
+        }
+        if( i_pmt_pid == 0 )
+            continue;
+
+        if( i_pmt_pid != p_out->i_pmt_pid )
+        {
+            /* Forget the PIDs of the previous PMT but the SI tables */
+            memset( p_out->pids + 4, 0, sizeof( p_out->pids ) - 4 );
+            p_out->pmt.b_started = false;
+            p_out->i_pmt_pid = i_pmt_pid;
+        }
+        OutputPAT( p_out, i_tsid, i_version );
+    }
+}
+
+static void ParsePMT( ts_output_t *p_out )
+{
+    const uint8_t *p_data = p_out->pmt.p_data;
+    const size_t i_size = p_out->pmt.i_size;
+
+    if( p_data[0] != 0x02 || !( p_data[5]&0x01 ) ||
+        GetWBE( &p_data[3] ) != p_out->i_program )
+        return;
+
+    memset( p_out->pids + 4, 0, sizeof( p_out->pids ) - 4 );
+
+    const uint16_t i_pcr_pid = GetWBE( &p_data[8] )&0x1fff;
+    p_out->pids[i_pcr_pid / 8] |= 1 << ( i_pcr_pid % 8 );
+
+    size_t i_pos = 12 + ( GetWBE( &p_data[10] )&0x0fff );
+    while( i_pos + 5 <= i_size - 4 )
+    {
+        const uint16_t i_pid = GetWBE( &p_data[i_pos + 1] )&0x1fff;
+        p_out->pids[i_pid / 8] |= 1 << ( i_pid % 8 );
+        i_pos += 5 + ( GetWBE( &p_data[i_pos + 3] )&0x0fff );
+    }
+}
+
+/*****************************************************************************
+ * Thread: reads the source and dispatches the packets to the outputs
+ *****************************************************************************/
+static void Dispatch( ts_source_t *p_src, const uint8_t *p )
+{
+    const uint16_t i_pid = ( ( p[1]&0x1f ) << 8 ) | p[2];
+
+    if( i_pid == 0 && SectionPush( &p_src->pat, p ) )
+        ParsePAT( p_src );
+
+    for( int i = 0; i < p_src->i_outputs; i++ )
+    {
+        ts_output_t *p_out = p_src->pp_outputs[i];
+
+        if( p_out->i_program == 0 )
+            OutputQueue( p_out, p );
+        else if( i_pid == 0 )
+            continue; /* replaced by OutputPAT() */
+        else if( i_pid == p_out->i_pmt_pid )
+        {
+            if( SectionPush( &p_out->pmt, p ) )
+                ParsePMT( p_out );
+            OutputQueue( p_out, p );
+        }
+        else if( p_out->pids[i_pid / 8] & ( 1 << ( i_pid % 8 ) ) )
+            OutputQueue( p_out, p );
+    }
+}
+
+/* Moves the batches to the output queues */
+static void Flush( ts_source_t *p_src )
+{
+    for( int i = 0; i < p_src->i_outputs; i++ )
+    {
+        ts_output_t *p_out = p_src->pp_outputs[i];
+        block_t *p_batch = p_out->p_batch;
+
+        if( p_batch == NULL || p_batch->i_buffer == 0 )
+            continue;
+        p_out->p_batch = NULL;
+
+        if( p_out->i_queued >= p_src->i_queue_max && !p_src->b_can_pace )
+        {
+            /* Live source, a late output must not hold the others back */
+            if( !p_out->b_overflow )
+                msg_Warn( p_src->p_obj, "program %u queue full, dropping data",
+                          p_out->i_program );
+            p_out->b_overflow = true;
+            block_Release( p_batch );
+            continue;
+        }
+        p_out->b_overflow = false;
+
+        block_ChainLastAppend( &p_out->pp_last, p_batch );
+        p_out->i_queued += p_batch->i_buffer;
+    }
+    vlc_cond_broadcast( &p_src->wait_data );
+}
+
+static bool IsFull( ts_source_t *p_src )
+{
+    for( int i = 0; i < p_src->i_outputs; i++ )
+        if( p_src->pp_outputs[i]->i_queued >= p_src->i_queue_max )
+            return true;
+    return false;
+}
+
+static void *Thread( void *data )
+{
+    ts_source_t *p_src = data;
+    uint8_t *p_buffer = malloc( TS_BATCH * TS_PACKET_SIZE );
+    size_t i_buffer = 0;
+
+    if( p_buffer == NULL )
+        goto eof;
+    vlc_cleanup_push( free, p_buffer );
+
+    for( ;; )
+    {
+        const int i_read = stream_Read( p_src->s, &p_buffer[i_buffer],
+                                        TS_BATCH * TS_PACKET_SIZE - i_buffer );
+        if( i_read <= 0 )
+            break;
+        i_buffer += i_read;
+
+        size_t i_pos = 0;
+        vlc_mutex_lock( &p_src->lock );
+        mutex_cleanup_push( &p_src->lock );
+
+        while( i_pos + TS_PACKET_SIZE <= i_buffer )
+        {
+            /* Resynchronize on two consecutive sync bytes */
+            if( p_buffer[i_pos] != 0x47 ||
+                ( i_pos + TS_PACKET_SIZE < i_buffer &&
+                  p_buffer[i_pos + TS_PACKET_SIZE] != 0x47 ) )
+            {
+                i_pos++;
+                continue;
+            }
+            Dispatch( p_src, &p_buffer[i_pos] );
+            i_pos += TS_PACKET_SIZE;
+        }
+
+        Flush( p_src );
+
+        /* Wait until the outputs catch up, unless the source is live */
+        while( p_src->b_can_pace && IsFull( p_src ) )
+            vlc_cond_wait( &p_src->wait_space, &p_src->lock );
+        vlc_cleanup_run();
+
+        memmove( p_buffer, &p_buffer[i_pos], i_buffer - i_pos );
+        i_buffer -= i_pos;
+    }
+    vlc_cleanup_run();
+
+eof:
+    msg_Dbg( p_src->p_obj, "end of shared stream %s", p_src->psz_mrl );
+    vlc_mutex_lock( &p_src->lock );
+    p_src->b_eof = true;
+    vlc_cond_broadcast( &p_src->wait_data );
+    mutex_cleanup_push( &p_src->lock );
+    for( ;; )
+        vlc_cond_wait( &p_src->wait_space, &p_src->lock );
+    vlc_cleanup_pop();
+    assert( 0 );
+    return NULL;
+}
@@ -70,6 +70,12 @@ static const int  nloopf_list[] = { 0, 1, 2, 3, 4 };
 static const char *const nloopf_list_text[] =
   { N_("None"), N_("Non-ref"), N_("Bidir"), N_("Non-key"), N_("All") };
 
+#if defined(FF_THREAD_FRAME)
+static const int  nthread_type_list[] = { 0, 1, 2 };
+static const char *const nthread_type_list_text[] =
+  { N_("Automatic"), N_("Frame"), N_("Slice") };
+#endif
+
 #ifdef ENABLE_SOUT
 static const char *const enc_hq_list[] = { "rd", "bits", "simple" };
 static const char *const enc_hq_list_text[] = {
@@ -132,7 +138,12 @@ vlc_module_begin ()
 #endif
 #if defined(FF_THREAD_FRAME)
     add_integer( "ffmpeg-threads", 0, THREADS_TEXT, THREADS_LONGTEXT, true );
+    add_integer( "ffmpeg-thread-type", 0, THREAD_TYPE_TEXT,
+                 THREAD_TYPE_LONGTEXT, true )
+        change_integer_list( nthread_type_list, nthread_type_list_text )
 #endif
+    add_bool( "ffmpeg-low-delay", false, LOW_DELAY_TEXT, LOW_DELAY_LONGTEXT,
+              true )
 
 
 #ifdef ENABLE_SOUT
@@ -140,6 +140,17 @@ int ffmpeg_OpenCodec( decoder_t *p_dec );
 #define THREADS_TEXT N_( "Threads" )
 #define THREADS_LONGTEXT N_( "Number of threads used for decoding, 0 meaning auto" )
 
+#define THREAD_TYPE_TEXT N_( "Threading mode" )
+#define THREAD_TYPE_LONGTEXT N_( "Frame threading decodes several frames at " \
+    "once and gives the best throughput, but delays the output by one frame " \
+    "per thread. Slice threading splits each frame, without any delay, but " \
+    "only helps streams made of several slices." )
+
+#define LOW_DELAY_TEXT N_( "Low delay" )
+#define LOW_DELAY_LONGTEXT N_( "Decode with as little delay as possible, " \
+    "for live sources: this forces slice threading and disables the codec " \
+    "output delays." )
+
 /*
  * Encoder options
  */
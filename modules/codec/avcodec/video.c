@@ -77,9 +77,14 @@ struct decoder_sys_t
     int     i_late_frames;
     mtime_t i_late_frames_start;
 
+    /* average decoding time of a frame */
+    mtime_t i_decode_cost;
+
     /* for direct rendering */
     bool b_direct_rendering;
     int  i_direct_rendering_used;
+    unsigned i_direct_rendering_hits;
+    unsigned i_direct_rendering_misses;
 
     bool b_has_b_frames;
 
@@ -139,14 +144,18 @@ static inline picture_t *ffmpeg_NewPictBuf( decoder_t *p_dec,
 {
     decoder_sys_t *p_sys = p_dec->p_sys;
 
-    p_dec->fmt_out.video.i_width = p_context->width;
-    p_dec->fmt_out.video.i_height = p_context->height;
-
     if( !p_context->width || !p_context->height )
     {
         return NULL; /* invalid display size */
     }
 
+    /* The format keeps the coded size, as every user of the decoder format
+     * expects it. The room that direct rendering needs beyond it (see
+     * avcodec_align_dimensions()) comes from the picture allocation, which
+     * pads the pitches and lines of the planes. */
+    p_dec->fmt_out.video.i_width = p_context->width;
+    p_dec->fmt_out.video.i_height = p_context->height;
+
     if( !p_sys->p_va && GetVlcChroma( &p_dec->fmt_out.video, p_context->pix_fmt ) )
     {
         /* we are doomed, but not really, because most codecs set their pix_fmt
@@ -298,6 +307,8 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     /* ***** ffmpeg direct rendering ***** */
     p_sys->b_direct_rendering = false;
     p_sys->i_direct_rendering_used = -1;
+    p_sys->i_direct_rendering_hits = 0;
+    p_sys->i_direct_rendering_misses = 0;
     if( var_CreateGetBool( p_dec, "ffmpeg-dr" ) &&
        (p_sys->p_codec->capabilities & CODEC_CAP_DR1) &&
         /* No idea why ... but this fixes flickering on some TSCC streams */
@@ -339,7 +350,37 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
         i_thread_count = vlc_GetCPUCount();
     msg_Dbg( p_dec, "allowing %d thread(s) for decoding", i_thread_count );
     p_sys->p_context->thread_count = i_thread_count;
+
+    const bool b_low_delay = var_InheritBool( p_dec, "ffmpeg-low-delay" );
+    if( b_low_delay )
+    {
+        /* Frame threading delays the output by one frame per thread */
+        p_sys->p_context->thread_type = FF_THREAD_SLICE;
+    }
+    else switch( var_InheritInteger( p_dec, "ffmpeg-thread-type" ) )
+    {
+        case 1:
+            p_sys->p_context->thread_type = FF_THREAD_FRAME;
+            break;
+        case 2:
+            p_sys->p_context->thread_type = FF_THREAD_SLICE;
+            break;
+        default:
+            p_sys->p_context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+            break;
+    }
+
+    /* With direct rendering, the pictures held by the frame threads come from
+     * the video output pool */
+    if( p_sys->b_direct_rendering && i_thread_count > 1 &&
+        (p_sys->p_context->thread_type & FF_THREAD_FRAME) &&
+        (p_sys->p_codec->capabilities & CODEC_CAP_FRAME_THREADS) )
+        p_dec->i_extra_picture_buffers = 2 * i_thread_count;
+#else
+    const bool b_low_delay = var_InheritBool( p_dec, "ffmpeg-low-delay" );
 #endif
+    if( b_low_delay )
+        p_sys->p_context->flags |= CODEC_FLAG_LOW_DELAY;
 
 #ifdef HAVE_AVCODEC_VA
     const bool b_use_hw = var_CreateGetBool( p_dec, "ffmpeg-hw" );
@@ -359,6 +400,7 @@ int InitVideoDec( decoder_t *p_dec, AVCodecContext *p_context,
     p_sys->b_first_frame = true;
     p_sys->b_flush = false;
     p_sys->i_late_frames = 0;
+    p_sys->i_decode_cost = 0;
 
     /* Set output properties */
     p_dec->fmt_out.i_cat = VIDEO_ES;
@@ -510,6 +552,23 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
             b_drawpicture = 1;
         else
             b_drawpicture = 0;
+
+        /* Do not wait for late frames to pile up: skip the non reference
+         * frames that cannot be decoded in time */
+        if( !p_dec->b_pace_control && p_sys->b_hurry_up && b_drawpicture &&
+            p_block->i_pts > VLC_TS_INVALID )
+        {
+            const mtime_t i_display_date = decoder_GetDisplayDate( p_dec, p_block->i_pts );
+
+            if( i_display_date > VLC_TS_INVALID &&
+                i_display_date - p_sys->i_decode_cost <= mdate() )
+            {
+                b_drawpicture = 0;
+                p_context->skip_frame =
+                        (p_sys->i_skip_frame <= AVDISCARD_NONREF) ?
+                        AVDISCARD_NONREF : p_sys->i_skip_frame;
+            }
+        }
     }
 
     if( p_context->width <= 0 || p_context->height <= 0 )
@@ -572,8 +631,13 @@ picture_t *DecodeVideo( decoder_t *p_dec, block_t **pp_block )
         av_init_packet( &pkt );
         pkt.data = p_block->p_buffer;
         pkt.size = p_block->i_buffer;
+
+        const mtime_t i_decode_start = mdate();
         i_used = avcodec_decode_video2( p_context, p_sys->p_ff_pic,
                                        &b_gotpicture, &pkt );
+        if( b_gotpicture )
+            p_sys->i_decode_cost = ( 7 * p_sys->i_decode_cost +
+                                     mdate() - i_decode_start ) / 8;
 
         if( b_null_size && !p_sys->b_flush &&
             p_context->width > 0 && p_context->height > 0 )
@@ -800,6 +864,12 @@ void EndVideoDec( decoder_t *p_dec )
 
     wait_mt( p_sys );
 
+    if( p_sys->i_direct_rendering_hits + p_sys->i_direct_rendering_misses > 0 )
+        msg_Dbg( p_dec, "direct rendering used for %u of %u pictures",
+                 p_sys->i_direct_rendering_hits,
+                 p_sys->i_direct_rendering_hits +
+                 p_sys->i_direct_rendering_misses );
+
     if( p_sys->p_ff_pic ) av_free( p_sys->p_ff_pic );
 
     if( p_sys->p_va )
@@ -987,6 +1057,9 @@ static int ffmpeg_GetFrameBuf( struct AVCodecContext *p_context,
     p_pic = ffmpeg_NewPictBuf( p_dec, p_sys->p_context );
     if( !p_pic )
         goto no_dr;
+    /* Pictures from the system memory pools are padded enough (see
+     * picture_Setup()), but the buffers of a video output used directly
+     * usually are not: those are still copied */
     bool b_compatible = true;
     if( p_pic->p[0].i_pitch / p_pic->p[0].i_pixel_pitch < i_width ||
         p_pic->p[0].i_lines < i_height )
@@ -1032,17 +1105,16 @@ static int ffmpeg_GetFrameBuf( struct AVCodecContext *p_context,
 
     p_sys->p_context->draw_horiz_band = NULL;
 
+    p_sys->i_direct_rendering_hits++;
+
     p_ff_pic->opaque = (void*)p_pic;
     p_ff_pic->type = FF_BUFFER_TYPE_USER;
-    p_ff_pic->data[0] = p_pic->p[0].p_pixels;
-    p_ff_pic->data[1] = p_pic->p[1].p_pixels;
-    p_ff_pic->data[2] = p_pic->p[2].p_pixels;
-    p_ff_pic->data[3] = NULL; /* alpha channel but I'm not sure */
-
-    p_ff_pic->linesize[0] = p_pic->p[0].i_pitch;
-    p_ff_pic->linesize[1] = p_pic->p[1].i_pitch;
-    p_ff_pic->linesize[2] = p_pic->p[2].i_pitch;
-    p_ff_pic->linesize[3] = 0;
+    for( int i = 0; i < 4; i++ )
+    {
+        /* The fourth plane is the alpha channel, if any */
+        p_ff_pic->data[i] = i < p_pic->i_planes ? p_pic->p[i].p_pixels : NULL;
+        p_ff_pic->linesize[i] = i < p_pic->i_planes ? p_pic->p[i].i_pitch : 0;
+    }
 
     /* FIXME what is that, should give good value */
     p_ff_pic->age = 256*256*256*64; // FIXME FIXME from ffmpeg
@@ -1051,9 +1123,13 @@ static int ffmpeg_GetFrameBuf( struct AVCodecContext *p_context,
     return 0;
 
 no_dr:
+    p_sys->i_direct_rendering_misses++;
     if( p_sys->i_direct_rendering_used != 0 )
     {
-        msg_Warn( p_dec, "disabling direct rendering" );
+        msg_Warn( p_dec, "disabling direct rendering (used for %u of %u "
+                  "pictures)", p_sys->i_direct_rendering_hits,
+                  p_sys->i_direct_rendering_hits +
+                  p_sys->i_direct_rendering_misses );
         p_sys->i_direct_rendering_used = 0;
     }
     post_mt( p_sys );
@@ -28,6 +28,7 @@
 # include "config.h"
 #endif
 #include <assert.h>
+#include <limits.h>
 
 #include <vlc_common.h>
 #include <vlc_plugin.h>
@@ -209,7 +210,10 @@ static int AVI_PacketRead     ( demux_t *, avi_packet_t *, block_t **);
 static int AVI_PacketSearch   ( demux_t * );
 
 static void AVI_IndexLoad    ( demux_t * );
-static void AVI_IndexCreate  ( demux_t * );
+static void AVI_IndexCreate  ( demux_t *, block_t * );
+#define AVI_INDEX_CACHE_VERSION 1
+static int  AVI_IndexCacheLoad ( demux_t *, block_t * );
+static void AVI_IndexCacheStore( demux_t * );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
 
@@ -242,6 +246,7 @@ static int Open( vlc_object_t * p_this )
 
     bool       b_index = false;
     int              i_do_index;
+    block_t         *p_index_cache = NULL;
 
     avi_chunk_list_t    *p_riff;
     avi_chunk_list_t    *p_hdrl, *p_movi;
@@ -628,7 +633,8 @@ static int Open( vlc_object_t * p_this )
 aviindex:
         if( p_sys->b_seekable )
         {
-            AVI_IndexCreate( p_demux );
+            AVI_IndexCreate( p_demux, p_index_cache );
+            p_index_cache = NULL;
         }
         else
         {
@@ -669,6 +675,14 @@ aviindex:
                 b_index = true;
                 goto aviindex;
             }
+            /* No need to ask if the index was built during a previous run */
+            p_index_cache = demux_IndexCacheLoad( p_demux, "avi",
+                                                  AVI_INDEX_CACHE_VERSION );
+            if( p_index_cache != NULL )
+            {
+                b_index = true;
+                goto aviindex;
+            }
             switch( dialog_Question( p_demux, _("Broken or missing AVI Index") ,
                _( "Because this AVI file index is broken or missing, "
                   "seeking will not work correctly.\n"
@@ -2342,7 +2356,8 @@ static void AVI_IndexLoad( demux_t *p_demux )
     }
 }
 
-static void AVI_IndexCreate( demux_t *p_demux )
+/* p_cache is the index cache if it was already loaded, and is released */
+static void AVI_IndexCreate( demux_t *p_demux, block_t *p_cache )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
 
@@ -2354,6 +2369,7 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
     mtime_t i_dialog_update;
     dialog_progress_bar_t *p_dialog = NULL;
+    bool b_complete = false;
 
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
@@ -2361,12 +2377,20 @@ static void AVI_IndexCreate( demux_t *p_demux )
     if( !p_movi )
     {
         msg_Err( p_demux, "cannot find p_movi" );
+        if( p_cache != NULL )
+            block_Release( p_cache );
         return;
     }
 
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
         avi_index_Init( &p_sys->track[i_stream]->idx );
 
+    if( p_cache == NULL )
+        p_cache = demux_IndexCacheLoad( p_demux, "avi",
+                                        AVI_INDEX_CACHE_VERSION );
+    if( p_cache != NULL && !AVI_IndexCacheLoad( p_demux, p_cache ) )
+        return;
+
     i_movi_end = __MIN( (off_t)(p_movi->i_chunk_pos + p_movi->i_chunk_size),
                         stream_Size( p_demux->s ) );
 
@@ -2402,7 +2426,10 @@ static void AVI_IndexCreate( demux_t *p_demux )
         }
 
         if( AVI_PacketGetHeader( p_demux, &pk ) )
+        {
+            b_complete = true;
             break;
+        }
 
         if( pk.i_stream < p_sys->i_track &&
             pk.i_cat == p_sys->track[pk.i_stream]->i_cat )
@@ -2429,9 +2456,13 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
                     msg_Dbg( p_demux, "looking for new RIFF chunk" );
                     if( stream_Seek( p_demux->s, p_sysx->i_chunk_pos + 24 ) )
+                    {
+                        b_complete = true;
                         goto print_stat;
+                    }
                     break;
                 }
+                b_complete = true;
                 goto print_stat;
 
             case AVIFOURCC_RIFF:
@@ -2455,6 +2486,7 @@ static void AVI_IndexCreate( demux_t *p_demux )
         if( ( !p_sys->b_odml && pk.i_pos + pk.i_size >= i_movi_end ) ||
             AVI_PacketNext( p_demux ) )
         {
+            b_complete = true;
             break;
         }
     }
@@ -2463,6 +2495,9 @@ print_stat:
     if( p_dialog != NULL )
         dialog_ProgressDestroy( p_dialog );
 
+    if( b_complete )
+        AVI_IndexCacheStore( p_demux );
+
     for( i_stream = 0; i_stream < p_sys->i_track; i_stream++ )
     {
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
@@ -2470,6 +2505,128 @@ print_stat:
     }
 }
 
+/*****************************************************************************
+ * Index cache: the index built by AVI_IndexCreate is kept on disk as
+ *  - the number of tracks, the size of an entry, the last chunk position
+ *  - the number of entries of each track
+ *  - the entries of each track
+ *****************************************************************************/
+typedef struct
+{
+    uint32_t i_track;
+    uint32_t i_entry_size;
+    uint64_t i_movi_lastchunk_pos;
+} avi_index_cache_t;
+
+static int AVI_IndexCacheLoad( demux_t *p_demux, block_t *p_cache )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const uint8_t *p = p_cache->p_buffer;
+    size_t i_left = p_cache->i_buffer;
+    avi_index_cache_t hdr;
+
+    if( i_left < sizeof(hdr) )
+        goto error;
+    memcpy( &hdr, p, sizeof(hdr) );
+    p += sizeof(hdr);
+    i_left -= sizeof(hdr);
+
+    if( hdr.i_track != p_sys->i_track
+     || hdr.i_entry_size != sizeof(avi_entry_t)
+     || i_left < hdr.i_track * sizeof(uint64_t) )
+        goto error;
+
+    const uint64_t *pi_size = (const uint64_t *)p;
+    p += hdr.i_track * sizeof(uint64_t);
+    i_left -= hdr.i_track * sizeof(uint64_t);
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        if( pi_size[i] > UINT_MAX / sizeof(avi_entry_t)
+         || pi_size[i] * sizeof(avi_entry_t) > i_left )
+            goto error;
+        i_left -= pi_size[i] * sizeof(avi_entry_t);
+    }
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_index_t *p_index = &p_sys->track[i]->idx;
+        const size_t i_size = pi_size[i] * sizeof(avi_entry_t);
+
+        avi_index_Clean( p_index );
+        avi_index_Init( p_index );
+        if( i_size == 0 )
+            continue;
+
+        p_index->p_entry = malloc( i_size );
+        if( !p_index->p_entry )
+        {
+            /* Do not leave a partial index: it will be built again */
+            for( unsigned j = 0; j < i; j++ )
+            {
+                avi_index_Clean( &p_sys->track[j]->idx );
+                avi_index_Init( &p_sys->track[j]->idx );
+            }
+            block_Release( p_cache );
+            return VLC_ENOMEM;
+        }
+        memcpy( p_index->p_entry, p, i_size );
+        p_index->i_size = p_index->i_max = pi_size[i];
+        p += i_size;
+
+        msg_Dbg( p_demux, "stream[%d] loaded %d cached index entries",
+                 i, p_index->i_size );
+    }
+    p_sys->i_movi_lastchunk_pos = hdr.i_movi_lastchunk_pos;
+    block_Release( p_cache );
+    return VLC_SUCCESS;
+
+error:
+    msg_Warn( p_demux, "invalid index cache" );
+    block_Release( p_cache );
+    return VLC_EGENERIC;
+}
+
+static void AVI_IndexCacheStore( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    avi_index_cache_t hdr;
+    size_t i_data = sizeof(hdr) + p_sys->i_track * sizeof(uint64_t);
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        i_data += p_sys->track[i]->idx.i_size * sizeof(avi_entry_t);
+
+    uint8_t *p_data = malloc( i_data );
+    if( !p_data )
+        return;
+
+    hdr.i_track = p_sys->i_track;
+    hdr.i_entry_size = sizeof(avi_entry_t);
+    hdr.i_movi_lastchunk_pos = p_sys->i_movi_lastchunk_pos;
+    memcpy( p_data, &hdr, sizeof(hdr) );
+
+    uint8_t *p = p_data + sizeof(hdr);
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        const uint64_t i_size = p_sys->track[i]->idx.i_size;
+        memcpy( p, &i_size, sizeof(i_size) );
+        p += sizeof(i_size);
+    }
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        const avi_index_t *p_index = &p_sys->track[i]->idx;
+        const size_t i_size = p_index->i_size * sizeof(avi_entry_t);
+
+        if( i_size > 0 )
+            memcpy( p, p_index->p_entry, i_size );
+        p += i_size;
+    }
+
+    demux_IndexCacheStore( p_demux, "avi", AVI_INDEX_CACHE_VERSION,
+                           p_data, i_data );
+    free( p_data );
+}
+
 /* */
 static void AVI_MetaLoad( demux_t *p_demux,
                           avi_chunk_list_t *p_riff, avi_chunk_avih_t *p_avih )
@@ -0,0 +1,317 @@
+/*****************************************************************************
+ * cluster_indexer.cpp : background cluster indexing for files without cues
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include "cluster_indexer.hpp"
+
+/* EBML IDs, with their length marker */
+#define MKV_ID_CLUSTER          0x1F43B675
+#define MKV_ID_CLUSTER_TIMECODE 0xE7
+
+/* Size of the elements whose size is not known in advance (live streams) */
+#define MKV_SIZE_UNKNOWN        UINT64_MAX
+
+/* Top level elements end the clusters of unknown size */
+static bool IsTopLevel( uint32_t i_id )
+{
+    switch( i_id )
+    {
+        case 0x1F43B675: /* Cluster */
+        case 0x114D9B74: /* SeekHead */
+        case 0x1549A966: /* Info */
+        case 0x1654AE6B: /* Tracks */
+        case 0x1C53BB6B: /* Cues */
+        case 0x1941A469: /* Attachments */
+        case 0x1043A770: /* Chapters */
+        case 0x1254C367: /* Tags */
+            return true;
+        default:
+            return false;
+    }
+}
+
+cluster_indexer_c::cluster_indexer_c( demux_t *p_demux_, int64_t i_start_,
+                                      int64_t i_end_, uint64_t i_timescale_ )
+    :p_demux(p_demux_)
+    ,s(NULL)
+    ,b_started(false)
+    ,i_start(i_start_)
+    ,i_end(i_end_)
+    ,i_timescale(i_timescale_)
+{
+    memset( pp_chunks, 0, sizeof(pp_chunks) );
+    vlc_atomic_set( &count, 0 );
+    vlc_atomic_set( &done, 0 );
+    vlc_atomic_set( &abort, 0 );
+}
+
+cluster_indexer_c::~cluster_indexer_c()
+{
+    if( b_started )
+    {
+        vlc_atomic_set( &abort, 1 );
+        vlc_join( thread, NULL );
+    }
+    if( s != NULL )
+        stream_Delete( s );
+
+    for( size_t i = 0; i < MKV_CLUSTER_CHUNK_MAX && pp_chunks[i]; i++ )
+        free( pp_chunks[i] );
+}
+
+/* Starts indexing the file, read through its own stream */
+bool cluster_indexer_c::Start( const char *psz_path )
+{
+    s = stream_UrlNew( p_demux, psz_path );
+    if( s == NULL )
+        return false;
+
+    if( vlc_clone( &thread, Thread, this, VLC_THREAD_PRIORITY_LOW ) )
+    {
+        stream_Delete( s );
+        s = NULL;
+        return false;
+    }
+    b_started = true;
+    return true;
+}
+
+size_t cluster_indexer_c::Count()
+{
+    /* Full barrier: the entries are read after the count */
+    return vlc_atomic_add( &count, 0 );
+}
+
+bool cluster_indexer_c::IsDone()
+{
+    return vlc_atomic_get( &done ) != 0;
+}
+
+/* Finds the last cluster starting at or before i_time */
+bool cluster_indexer_c::FindTime( mtime_t i_time,
+                                  int64_t *pi_position, mtime_t *pi_time )
+{
+    const bool b_done = IsDone();
+    const size_t i_count = Count();
+
+    if( i_count == 0 )
+        return false;
+    /* A cluster closer to i_time may not be indexed yet */
+    if( !b_done && Get( i_count - 1 ).i_time <= i_time )
+        return false;
+
+    size_t i_low = 0, i_high = i_count - 1;
+    while( i_low < i_high )
+    {
+        const size_t i_mid = ( i_low + i_high + 1 ) / 2;
+
+        if( Get( i_mid ).i_time <= i_time )
+            i_low = i_mid;
+        else
+            i_high = i_mid - 1;
+    }
+
+    *pi_position = Get( i_low ).i_position;
+    *pi_time = Get( i_low ).i_time;
+    return true;
+}
+
+/* Finds the first cluster starting at or after i_position */
+bool cluster_indexer_c::FindPosition( int64_t i_position,
+                                      int64_t *pi_position, mtime_t *pi_time )
+{
+    const bool b_done = IsDone();
+    const size_t i_count = Count();
+
+    if( i_count == 0 )
+        return false;
+    if( !b_done && Get( i_count - 1 ).i_position < i_position )
+        return false;
+
+    size_t i_low = 0, i_high = i_count - 1;
+    while( i_low < i_high )
+    {
+        const size_t i_mid = ( i_low + i_high ) / 2;
+
+        if( Get( i_mid ).i_position >= i_position )
+            i_high = i_mid;
+        else
+            i_low = i_mid + 1;
+    }
+
+    *pi_position = Get( i_low ).i_position;
+    *pi_time = Get( i_low ).i_time;
+    return true;
+}
+
+void *cluster_indexer_c::Thread( void *data )
+{
+    cluster_indexer_c *p_indexer = static_cast<cluster_indexer_c *>( data );
+
+    p_indexer->Run();
+    return NULL;
+}
+
+/* Reads the EBML header of the element at the current position, and leaves
+ * the stream at the beginning of its payload */
+bool cluster_indexer_c::ReadHeader( uint32_t *pi_id, uint64_t *pi_size,
+                                    int64_t *pi_data )
+{
+    const uint8_t *p_peek;
+    const int i_peek = stream_Peek( s, &p_peek, 4 + 8 );
+    int i_id_len, i_size_len;
+
+    if( i_peek < 2 )
+        return false;
+
+    /* The ID keeps its length marker */
+    for( i_id_len = 1; i_id_len <= 4; i_id_len++ )
+        if( p_peek[0] & ( 0x80 >> ( i_id_len - 1 ) ) )
+            break;
+    if( i_id_len > 4 || i_id_len >= i_peek )
+        return false;
+
+    uint32_t i_id = 0;
+    for( int i = 0; i < i_id_len; i++ )
+        i_id = ( i_id << 8 ) | p_peek[i];
+
+    /* The size does not, and all ones means unknown */
+    const uint8_t i_first = p_peek[i_id_len];
+    for( i_size_len = 1; i_size_len <= 8; i_size_len++ )
+        if( i_first & ( 0x80 >> ( i_size_len - 1 ) ) )
+            break;
+    if( i_size_len > 8 || i_id_len + i_size_len > i_peek )
+        return false;
+
+    uint64_t i_size = i_first & ( 0xff >> i_size_len );
+    bool b_unknown = i_size == ( 0xffu >> i_size_len );
+    for( int i = 1; i < i_size_len; i++ )
+    {
+        i_size = ( i_size << 8 ) | p_peek[i_id_len + i];
+        b_unknown &= p_peek[i_id_len + i] == 0xff;
+    }
+
+    if( stream_Read( s, NULL, i_id_len + i_size_len ) != i_id_len + i_size_len )
+        return false;
+
+    *pi_id = i_id;
+    *pi_size = b_unknown ? MKV_SIZE_UNKNOWN : i_size;
+    *pi_data = stream_Tell( s );
+    return true;
+}
+
+bool cluster_indexer_c::Append( int64_t i_position, mtime_t i_time )
+{
+    const size_t i_count = vlc_atomic_get( &count );
+    const size_t i_chunk = i_count / MKV_CLUSTER_CHUNK_SIZE;
+
+    if( i_chunk >= MKV_CLUSTER_CHUNK_MAX )
+        return false;
+    if( pp_chunks[i_chunk] == NULL )
+    {
+        pp_chunks[i_chunk] = (mkv_cluster_t *)
+            malloc( MKV_CLUSTER_CHUNK_SIZE * sizeof(mkv_cluster_t) );
+        if( pp_chunks[i_chunk] == NULL )
+            return false;
+    }
+
+    mkv_cluster_t *p_cluster =
+        &pp_chunks[i_chunk][i_count % MKV_CLUSTER_CHUNK_SIZE];
+    p_cluster->i_position = i_position;
+    p_cluster->i_time = i_time;
+
+    /* Publish it */
+    vlc_atomic_inc( &count );
+    return true;
+}
+
+/* Walks the top level elements, skipping everything but the beginning of
+ * the clusters where their timecode lies */
+void cluster_indexer_c::Run()
+{
+    const uint64_t i_size = stream_Size( s );
+    if( i_size > 0 && (uint64_t)i_end > i_size )
+        i_end = i_size;
+
+    int64_t i_pos = i_start;
+    uint32_t i_id;
+    uint64_t i_len;
+    int64_t i_data;
+
+    while( i_pos < i_end && !vlc_atomic_get( &abort ) )
+    {
+        if( stream_Seek( s, i_pos ) || !ReadHeader( &i_id, &i_len, &i_data ) )
+            break;
+
+        if( i_id != MKV_ID_CLUSTER )
+        {
+            if( i_len == MKV_SIZE_UNKNOWN )
+                break;
+            i_pos = i_data + i_len;
+            continue;
+        }
+
+        const int64_t i_cluster = i_pos;
+        const bool b_unknown = i_len == MKV_SIZE_UNKNOWN;
+        const int64_t i_cluster_end = b_unknown ? i_end : i_data + i_len;
+        mtime_t i_time = -1;
+
+        i_pos = i_data;
+        while( i_pos < i_cluster_end )
+        {
+            if( !ReadHeader( &i_id, &i_len, &i_data ) )
+                goto end;
+            if( b_unknown && IsTopLevel( i_id ) )
+                break;
+            if( i_len == MKV_SIZE_UNKNOWN )
+                goto end;
+
+            if( i_id == MKV_ID_CLUSTER_TIMECODE && i_len <= 8 )
+            {
+                uint8_t p_tc[8];
+                uint64_t i_tc = 0;
+
+                if( stream_Read( s, p_tc, i_len ) != (int)i_len )
+                    goto end;
+                for( uint64_t i = 0; i < i_len; i++ )
+                    i_tc = ( i_tc << 8 ) | p_tc[i];
+                i_time = i_tc * i_timescale / 1000;
+                if( !b_unknown )
+                    break;
+            }
+
+            i_pos = i_data + i_len;
+            if( stream_Seek( s, i_pos ) )
+                goto end;
+        }
+
+        if( i_time >= 0 && !Append( i_cluster, i_time ) )
+            break;
+        if( !b_unknown )
+            i_pos = i_cluster_end;
+    }
+
+end:
+    if( i_pos >= i_end )
+    {
+        msg_Dbg( p_demux, "indexed %zu clusters", Count() );
+        vlc_atomic_set( &done, 1 );
+    }
+}
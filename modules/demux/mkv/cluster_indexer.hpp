@@ -0,0 +1,88 @@
+/*****************************************************************************
+ * cluster_indexer.hpp : background cluster indexing for files without cues
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef _CLUSTER_INDEXER_HPP_
+#define _CLUSTER_INDEXER_HPP_
+
+#include "mkv.hpp"
+
+#include <vlc_atomic.h>
+
+typedef struct
+{
+    int64_t i_position;
+    mtime_t i_time;
+} mkv_cluster_t;
+
+/*****************************************************************************
+ * cluster_indexer_c: finds the clusters of a segment in a low priority
+ * thread, reading their headers only.
+ *
+ * The index is appended by the thread and read by the demuxer without
+ * locking: the entries are stored in chunks that never move, and an entry
+ * is only published by incrementing the count once it is written.
+ *****************************************************************************/
+#define MKV_CLUSTER_CHUNK_SIZE  4096
+#define MKV_CLUSTER_CHUNK_MAX   4096
+
+class cluster_indexer_c
+{
+public:
+    cluster_indexer_c( demux_t *, int64_t i_start, int64_t i_end,
+                       uint64_t i_timescale );
+    virtual ~cluster_indexer_c();
+
+    bool Start( const char *psz_path );
+
+    /* Each lookup fails as long as the index does not cover the target */
+    bool FindTime( mtime_t i_time, int64_t *pi_position, mtime_t *pi_time );
+    bool FindPosition( int64_t i_position,
+                       int64_t *pi_position, mtime_t *pi_time );
+
+    size_t Count();
+    bool   IsDone();
+    const mkv_cluster_t & Get( size_t i ) const
+    {
+        return pp_chunks[i / MKV_CLUSTER_CHUNK_SIZE][i % MKV_CLUSTER_CHUNK_SIZE];
+    }
+
+private:
+    static void *Thread( void * );
+    void Run();
+    bool ReadHeader( uint32_t *pi_id, uint64_t *pi_size, int64_t *pi_data );
+    bool Append( int64_t i_position, mtime_t i_time );
+
+    demux_t       *p_demux;
+    stream_t      *s;
+    vlc_thread_t  thread;
+    bool          b_started;
+
+    int64_t       i_start;
+    int64_t       i_end;
+    uint64_t      i_timescale;
+
+    mkv_cluster_t *pp_chunks[MKV_CLUSTER_CHUNK_MAX];
+    vlc_atomic_t  count;
+    vlc_atomic_t  done;
+    vlc_atomic_t  abort;
+};
+
+#endif
@@ -65,6 +65,7 @@ matroska_segment_c::matroska_segment_c( demux_sys_t & demuxer, EbmlStream & estr
     ,b_cues(false)
     ,i_index(0)
     ,i_index_max(1024)
+    ,p_indexer(NULL)
     ,psz_muxing_application(NULL)
     ,psz_writing_application(NULL)
     ,psz_segment_filename(NULL)
@@ -96,6 +97,7 @@ matroska_segment_c::~matroska_segment_c()
     free( psz_date_utc );
     free( p_indexes );
 
+    delete p_indexer;
     delete ep;
     delete segment;
     delete p_segment_uid;
@@ -436,6 +438,28 @@ void matroska_segment_c::IndexAppendCluster( KaxCluster *cluster )
 #undef idx
 }
 
+/* Without cues, the clusters are found in the background, for the seeks to
+ * go straight to the right one instead of parsing the file up to it */
+void matroska_segment_c::IndexClusters( const char *psz_path )
+{
+    if( b_cues || p_indexer != NULL || i_start_pos <= 0 )
+        return;
+
+    int64_t i_end = INT64_MAX;
+    if( segment->IsFiniteSize() )
+        i_end = segment->GetElementPosition() + segment->HeadSize()
+              + segment->GetSize();
+
+    p_indexer = new cluster_indexer_c( &sys.demuxer, i_start_pos, i_end,
+                                       i_timescale );
+    if( !p_indexer->Start( psz_path ) )
+    {
+        msg_Warn( &sys.demuxer, "cannot index the clusters" );
+        delete p_indexer;
+        p_indexer = NULL;
+    }
+}
+
 bool matroska_segment_c::PreloadFamily( const matroska_segment_c & of_segment )
 {
     if ( b_preloaded )
@@ -671,8 +695,24 @@ void matroska_segment_c::Seek( mtime_t i_date, mtime_t i_time_offset, int64_t i_
     size_t      i_track;
     int64_t     i_seek_position = i_start_pos;
     int64_t     i_seek_time = i_start_time;
+    bool        b_indexed = false;
+
+    /* Once the cluster index covers the target, it is exact */
+    if( p_indexer != NULL )
+    {
+        if( i_global_position >= 0 )
+        {
+            b_indexed = p_indexer->FindPosition( i_global_position,
+                                                 &i_seek_position, &i_seek_time );
+            if( b_indexed )
+                i_date = i_seek_time + i_time_offset;
+        }
+        else
+            b_indexed = p_indexer->FindTime( i_date - i_time_offset,
+                                             &i_seek_position, &i_seek_time );
+    }
 
-    if( i_global_position >= 0 )
+    if( i_global_position >= 0 && !b_indexed )
     {
         /* Special case for seeking in files with no cues */
         EbmlElement *el = NULL;
@@ -704,7 +744,7 @@ void matroska_segment_c::Seek( mtime_t i_date, mtime_t i_time_offset, int64_t i_
         return;
     }
 
-    if ( i_index > 0 )
+    if ( i_index > 0 && !b_indexed )
     {
         int i_idx = 0;
 
@@ -29,6 +29,7 @@
 
 
 #include "Ebml_parser.hpp"
+#include "cluster_indexer.hpp"
 
 class chapter_edition_c;
 class chapter_translation_c;
@@ -75,6 +76,7 @@ public:
     int                     i_index;
     int                     i_index_max;
     mkv_index_t             *p_indexes;
+    cluster_indexer_c       *p_indexer;
 
     /* info */
     char                    *psz_muxing_application;
@@ -98,6 +100,7 @@ public:
 
     bool Preload();
     bool PreloadFamily( const matroska_segment_c & segment );
+    void IndexClusters( const char *psz_path );
     void InformationCreate();
     void Seek( mtime_t i_date, mtime_t i_time_offset, int64_t i_global_position );
     int BlockGet( KaxBlock * &, KaxSimpleBlock * &, bool *, bool *, int64_t *);
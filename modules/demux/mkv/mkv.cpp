@@ -35,6 +35,8 @@
 
 #include <vlc_fs.h>
 
+#include <climits>
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -65,6 +67,10 @@ vlc_module_begin ()
             N_("Seek based on percent not time"),
             N_("Seek based on percent not time."), true );
 
+    add_bool( "mkv-index-clusters", true,
+            N_("Index clusters in the background"),
+            N_("Find the clusters of files without cues in a background thread, to seek faster."), true );
+
     add_bool( "mkv-use-dummy", false,
             N_("Dummy Elements"),
             N_("Read and discard unknown EBML elements (not good for broken files)."), true );
@@ -78,6 +84,9 @@ static int  Demux  ( demux_t * );
 static int  Control( demux_t *, int, va_list );
 static void Seek   ( demux_t *, mtime_t i_date, double f_percent, chapter_item_c *p_chapter );
 
+static void IndexCacheLoad ( demux_t *, matroska_stream_c * );
+static void IndexCacheStore( demux_t *, matroska_stream_c * );
+
 /*****************************************************************************
  * Open: initializes matroska demux structures
  *****************************************************************************/
@@ -130,6 +139,14 @@ static int Open( vlc_object_t * p_this )
     {
         p_stream->segments[i]->Preload();
     }
+    IndexCacheLoad( p_demux, p_stream );
+
+    if( p_demux->psz_file != NULL &&
+        var_InheritBool( p_demux, "mkv-index-clusters" ) )
+    {
+        for( size_t i = 0; i < p_stream->segments.size(); i++ )
+            p_stream->segments[i]->IndexClusters( p_demux->psz_file );
+    }
 
     p_segment = p_stream->segments[0];
     if( p_segment->cluster == NULL )
@@ -262,9 +279,144 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys   = p_demux->p_sys;
 
+    IndexCacheStore( p_demux, p_sys->streams[0] );
     delete p_sys;
 }
 
+/*****************************************************************************
+ * Index cache: without cues, the index of the segments is built cluster by
+ * cluster while playing. What was found is kept on disk for the next time
+ * the file is opened, as:
+ *  - the number of segments and the size of an entry
+ *  - the number of entries of each segment
+ *  - the entries of each segment
+ *****************************************************************************/
+#define MKV_INDEX_CACHE_VERSION 1
+
+typedef struct
+{
+    uint32_t i_segment;
+    uint32_t i_entry_size;
+} mkv_index_cache_t;
+
+static void IndexCacheLoad( demux_t *p_demux, matroska_stream_c *p_stream )
+{
+    block_t *p_cache = demux_IndexCacheLoad( p_demux, "mkv",
+                                             MKV_INDEX_CACHE_VERSION );
+    if( p_cache == NULL )
+        return;
+
+    const uint8_t *p = p_cache->p_buffer;
+    size_t i_left = p_cache->i_buffer;
+    const size_t i_segment = p_stream->segments.size();
+    mkv_index_cache_t hdr;
+
+    if( i_left < sizeof(hdr) )
+        goto error;
+    memcpy( &hdr, p, sizeof(hdr) );
+    p += sizeof(hdr);
+    i_left -= sizeof(hdr);
+    if( hdr.i_segment != i_segment
+     || hdr.i_entry_size != sizeof(mkv_index_t)
+     || i_left < i_segment * sizeof(uint64_t) )
+        goto error;
+
+    const uint64_t *pi_index;
+    pi_index = (const uint64_t *)p;
+    p += i_segment * sizeof(uint64_t);
+    i_left -= i_segment * sizeof(uint64_t);
+
+    for( size_t i = 0; i < i_segment; i++ )
+    {
+        if( pi_index[i] > INT_MAX / sizeof(mkv_index_t) - 1
+         || pi_index[i] * sizeof(mkv_index_t) > i_left )
+            goto error;
+        i_left -= pi_index[i] * sizeof(mkv_index_t);
+    }
+
+    for( size_t i = 0; i < i_segment; i++ )
+    {
+        matroska_segment_c *p_segment = p_stream->segments[i];
+        const int i_index = pi_index[i];
+
+        /* Cues are always better than what was found while playing */
+        if( !p_segment->b_cues && i_index > p_segment->i_index )
+        {
+            mkv_index_t *p_indexes = (mkv_index_t *)
+                realloc( p_segment->p_indexes,
+                         sizeof(mkv_index_t) * (i_index + 1) );
+            if( p_indexes != NULL )
+            {
+                memcpy( p_indexes, p, sizeof(mkv_index_t) * i_index );
+                p_segment->p_indexes = p_indexes;
+                p_segment->i_index = i_index;
+                p_segment->i_index_max = i_index + 1;
+                msg_Dbg( p_demux, "segment %zu: loaded %d cached index "
+                         "entries", i, i_index );
+            }
+        }
+        p += sizeof(mkv_index_t) * i_index;
+    }
+    block_Release( p_cache );
+    return;
+
+error:
+    msg_Warn( p_demux, "invalid index cache" );
+    block_Release( p_cache );
+}
+
+static void IndexCacheStore( demux_t *p_demux, matroska_stream_c *p_stream )
+{
+    const size_t i_segment = p_stream->segments.size();
+    size_t i_data = sizeof(mkv_index_cache_t) + i_segment * sizeof(uint64_t);
+    bool b_useful = false;
+
+    for( size_t i = 0; i < i_segment; i++ )
+    {
+        const matroska_segment_c *p_segment = p_stream->segments[i];
+
+        if( p_segment->b_cues )
+            continue;
+        i_data += p_segment->i_index * sizeof(mkv_index_t);
+        b_useful |= p_segment->i_index > 1;
+    }
+    if( !b_useful )
+        return;
+
+    uint8_t *p_data = (uint8_t *)malloc( i_data );
+    if( p_data == NULL )
+        return;
+
+    mkv_index_cache_t hdr;
+    hdr.i_segment = i_segment;
+    hdr.i_entry_size = sizeof(mkv_index_t);
+    memcpy( p_data, &hdr, sizeof(hdr) );
+
+    uint8_t *p = p_data + sizeof(hdr);
+    for( size_t i = 0; i < i_segment; i++ )
+    {
+        const matroska_segment_c *p_segment = p_stream->segments[i];
+        const uint64_t i_index = p_segment->b_cues ? 0 : p_segment->i_index;
+
+        memcpy( p, &i_index, sizeof(i_index) );
+        p += sizeof(i_index);
+    }
+    for( size_t i = 0; i < i_segment; i++ )
+    {
+        const matroska_segment_c *p_segment = p_stream->segments[i];
+
+        if( p_segment->b_cues )
+            continue;
+        memcpy( p, p_segment->p_indexes,
+                p_segment->i_index * sizeof(mkv_index_t) );
+        p += p_segment->i_index * sizeof(mkv_index_t);
+    }
+
+    demux_IndexCacheStore( p_demux, "mkv", MKV_INDEX_CACHE_VERSION,
+                           p_data, i_data );
+    free( p_data );
+}
+
 /*****************************************************************************
  * Control:
  *****************************************************************************/
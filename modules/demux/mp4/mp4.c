@@ -74,23 +74,27 @@ typedef struct
     uint32_t     i_sample_count; /* how many samples in this chunk */
     uint32_t     i_sample_first; /* index of the first sample in this chunk */
 
-    /* now provide way to calculate pts, dts, and offset without too
-        much memory and with fast access */
-
-    /* with this we can calculate dts/pts without waste memory */
+    /* DTS of the first and last samples, in track time scale, to find the
+     * chunk holding a given time without decoding the stts table */
     uint64_t     i_first_dts;   /* DTS of the first sample */
     uint64_t     i_last_dts;    /* DTS of the last sample */
-    uint32_t     *p_sample_count_dts;
-    uint32_t     *p_sample_delta_dts;   /* dts delta */
-
-    uint32_t     *p_sample_count_pts;
-    int32_t      *p_sample_offset_pts;  /* pts-dts */
-
-    /* TODO if needed add pts
-        but quickly *add* support for edts and seeking */
 
 } mp4_chunk_t;
 
+/* Run-length sample to time table, built from a stts or ctts box.
+ * Runs are kept as they are stored in the box, and only the index of the
+ * first sample (and the DTS for stts) of each run is precomputed, so that
+ * memory and setup time depend on the number of runs, not of samples. */
+typedef struct
+{
+    uint32_t       i_count;         /* number of runs */
+    uint32_t       i_last;          /* last run looked up */
+    const uint32_t *p_sample_count; /* samples in each run (box data) */
+    const int32_t  *p_value;        /* delta or offset of each run (box data) */
+    uint32_t       *p_sample_first; /* index of the first sample of each run */
+    uint64_t       *p_first_dts;    /* DTS of the first sample of each run */
+} mp4_runs_t;
+
  /* Contain all needed information for read all track with vlc */
 typedef struct
 {
@@ -128,11 +132,13 @@ typedef struct
 
     mp4_chunk_t    *chunk; /* always defined  for each chunk */
 
+    mp4_runs_t     dts;    /* from stts */
+    mp4_runs_t     pts;    /* from ctts, i_count is 0 without ctts */
+
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-                                    too much time to do sumations each time*/
+    uint32_t         *p_sample_size; /* points to the stsz box data */
 
     MP4_Box_t *p_stbl;  /* will contain all timing information */
     MP4_Box_t *p_stsd;  /* will contain all data to initialize decoder */
@@ -185,32 +191,52 @@ static void     MP4_TrackSetELST( demux_t *, mp4_track_t *, int64_t );
 static void     MP4_UpdateSeekpoint( demux_t * );
 static const char *MP4_ConvertMacCode( uint16_t );
 
-/* Return time in s of a track */
-static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
+/* Return the run holding a sample */
+static inline uint32_t MP4_RunsFind( mp4_runs_t *p_runs, uint32_t i_sample )
 {
-#define chunk p_track->chunk[p_track->i_chunk]
+    uint32_t i_run = p_runs->i_last;
 
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - chunk.i_sample_first;
-    int64_t i_dts = chunk.i_first_dts;
+    /* Fast path for sequential reads: same or next run */
+    if( i_run < p_runs->i_count && p_runs->p_sample_first[i_run] <= i_sample )
+    {
+        if( i_sample - p_runs->p_sample_first[i_run] <
+                p_runs->p_sample_count[i_run] )
+            return i_run;
+        if( i_run + 1 < p_runs->i_count &&
+            i_sample - p_runs->p_sample_first[i_run+1] <
+                p_runs->p_sample_count[i_run+1] )
+            return p_runs->i_last = i_run + 1;
+    }
 
-    while( i_sample > 0 )
+    /* Last run starting at or before the sample */
+    uint32_t i_low = 0, i_high = p_runs->i_count;
+    while( i_high - i_low > 1 )
     {
-        if( i_sample > chunk.p_sample_count_dts[i_index] )
-        {
-            i_dts += chunk.p_sample_count_dts[i_index] *
-                chunk.p_sample_delta_dts[i_index];
-            i_sample -= chunk.p_sample_count_dts[i_index];
-            i_index++;
-        }
+        const uint32_t i_mid = i_low + (i_high - i_low) / 2;
+        if( p_runs->p_sample_first[i_mid] <= i_sample )
+            i_low = i_mid;
         else
-        {
-            i_dts += i_sample * chunk.p_sample_delta_dts[i_index];
-            break;
-        }
+            i_high = i_mid;
     }
+    return p_runs->i_last = i_low;
+}
+
+/* Return the DTS of a sample, in track time scale */
+static inline uint64_t MP4_TrackSampleDTS( mp4_track_t *p_track,
+                                           uint32_t i_sample )
+{
+    mp4_runs_t *p_runs = &p_track->dts;
+    const uint32_t i_run = MP4_RunsFind( p_runs, i_sample );
 
-#undef chunk
+    return p_runs->p_first_dts[i_run] +
+           (uint64_t)(i_sample - p_runs->p_sample_first[i_run]) *
+           (uint32_t)p_runs->p_value[i_run];
+}
+
+/* Return time in s of a track */
+static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
+{
+    int64_t i_dts = MP4_TrackSampleDTS( p_track, p_track->i_sample );
 
     /* now handle elst */
     if( p_track->p_elst )
@@ -238,21 +264,14 @@ static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 
 static inline int64_t MP4_TrackGetPTSDelta( mp4_track_t *p_track )
 {
-    mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
+    mp4_runs_t *p_runs = &p_track->pts;
 
-    if( ck->p_sample_count_pts == NULL || ck->p_sample_offset_pts == NULL )
+    if( p_runs->i_count == 0 )
         return -1;
 
-    for( i_index = 0;; i_index++ )
-    {
-        if( i_sample < ck->p_sample_count_pts[i_index] )
-            return ck->p_sample_offset_pts[i_index] * INT64_C(1000000) /
-                   (int64_t)p_track->i_timescale;
-
-        i_sample -= ck->p_sample_count_pts[i_index];
-    }
+    const uint32_t i_run = MP4_RunsFind( p_runs, p_track->i_sample );
+    return p_runs->p_value[i_run] * INT64_C(1000000) /
+           (int64_t)p_track->i_timescale;
 }
 
 static inline int64_t MP4_GetMoviePTS(demux_sys_t *p_sys )
@@ -1180,10 +1199,6 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
         ck->i_offset = p_co64->data.p_co64->i_chunk_offset[i_chunk];
 
         ck->i_first_dts = 0;
-        ck->p_sample_count_dts = NULL;
-        ck->p_sample_delta_dts = NULL;
-        ck->p_sample_count_pts = NULL;
-        ck->p_sample_offset_pts = NULL;
     }
 
     /* now we read index for SampleEntry( soun vide mp4a mp4v ...)
@@ -1230,6 +1245,46 @@ static int TrackCreateChunksIndex( demux_t *p_demux,
     return VLC_SUCCESS;
 }
 
+/* Build the run table of a stts (with DTS) or ctts box */
+static int TrackCreateRuns( mp4_runs_t *p_runs, uint32_t i_count,
+                            const uint32_t *p_sample_count,
+                            const int32_t *p_value, bool b_dts )
+{
+    p_runs->i_count = 0;
+    p_runs->i_last = 0;
+    p_runs->p_sample_count = p_sample_count;
+    p_runs->p_value = p_value;
+    if( i_count == 0 )
+        return VLC_SUCCESS;
+
+    p_runs->p_sample_first = malloc( i_count * sizeof( uint32_t ) );
+    if( b_dts )
+        p_runs->p_first_dts = malloc( i_count * sizeof( uint64_t ) );
+    if( p_runs->p_sample_first == NULL || ( b_dts && !p_runs->p_first_dts ) )
+        return VLC_ENOMEM;
+
+    uint32_t i_sample = 0;
+    uint64_t i_dts = 0;
+    uint32_t i_run;
+    for( i_run = 0; i_run < i_count; i_run++ )
+    {
+        /* Ignore the runs past 2^32 samples, the track cannot have them */
+        if( p_sample_count[i_run] > UINT32_MAX - i_sample )
+            break;
+
+        p_runs->p_sample_first[i_run] = i_sample;
+        i_sample += p_sample_count[i_run];
+        if( b_dts )
+        {
+            p_runs->p_first_dts[i_run] = i_dts;
+            i_dts += (uint64_t)p_sample_count[i_run] *
+                     (uint32_t)p_value[i_run];
+        }
+    }
+    p_runs->i_count = i_run;
+    return VLC_SUCCESS;
+}
+
 static int TrackCreateSamplesIndex( demux_t *p_demux,
                                     mp4_track_t *p_demux_track )
 {
@@ -1238,13 +1293,7 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     MP4_Box_data_stts_t *stts;
     /* TODO use also stss and stsh table for seeking */
     /* FIXME use edit table */
-    int64_t i_sample;
-    int64_t i_chunk;
-
-    int64_t i_index;
-    int64_t i_index_sample_used;
-
-    int64_t i_next_dts;
+    uint32_t i_chunk;
 
     /* Find stsz
      *  Gives the sample size for each samples. There is also a stz2 table
@@ -1262,14 +1311,15 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
      *  Gives mapping between sample and decoding time
      */
     p_box = MP4_BoxGet( p_demux_track->p_stbl, "stts" );
-    if( !p_box )
+    if( !p_box || p_box->data.p_stts->i_entry_count == 0 )
     {
         msg_Warn( p_demux, "cannot find STTS box" );
         return VLC_EGENERIC;
     }
     stts = p_box->data.p_stts;
 
-    /* Use stsz table to create a sample number -> sample size table */
+    /* Use stsz table as the sample number -> sample size table. The box
+     * lives as long as the track, so it is not copied. */
     p_demux_track->i_sample_count = stsz->i_sample_count;
     if( stsz->i_sample_size )
     {
@@ -1281,83 +1331,34 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     {
         /* 2: each sample can have a different size */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        p_demux_track->p_sample_size = stsz->i_entry_size;
     }
 
-    /* Use stts table to create a sample number -> dts table.
-     * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
+    /* Use stts table as the sample number -> dts table.
+     * The table is not expanded (a raw audio stream can have a sample for
+     * each channels*bits_per_sample/8 bytes): only the first sample and dts
+     * of each run are computed, and the run holding a sample is found by
+     * binary search. */
+    if( TrackCreateRuns( &p_demux_track->dts, stts->i_entry_count,
+                         stts->i_sample_count, stts->i_sample_delta, true ) )
+        return VLC_ENOMEM;
+    if( p_demux_track->dts.i_count == 0 )
+    {
+        msg_Warn( p_demux, "invalid STTS box" );
+        return VLC_EGENERIC;
+    }
 
-    i_next_dts = 0;
-    i_index = 0; i_index_sample_used = 0;
     for( i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
     {
         mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-        int64_t i_entry, i_sample_count, i;
-
-        /* save first dts */
-        ck->i_first_dts = i_next_dts;
-        ck->i_last_dts  = i_next_dts;
-
-        /* count how many entries are needed for this chunk
-         * for p_sample_delta_dts and p_sample_count_dts */
-        i_sample_count = ck->i_sample_count;
-
-        i_entry = 0;
-        while( i_sample_count > 0 )
-        {
-            i_sample_count -= stts->i_sample_count[i_index+i_entry];
-            /* don't count already used sample in this entry */
-            if( i_entry == 0 )
-                i_sample_count += i_index_sample_used;
-
-            i_entry++;
-        }
-
-        /* allocate them */
-        ck->p_sample_count_dts = calloc( i_entry, sizeof( uint32_t ) );
-        ck->p_sample_delta_dts = calloc( i_entry, sizeof( uint32_t ) );
 
-        if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
-            return VLC_ENOMEM;
-
-        /* now copy */
-        i_sample_count = ck->i_sample_count;
-        for( i = 0; i < i_entry; i++ )
-        {
-            int64_t i_used;
-            int64_t i_rest;
-
-            i_rest = stts->i_sample_count[i_index] - i_index_sample_used;
-
-            i_used = __MIN( i_rest, i_sample_count );
-
-            i_index_sample_used += i_used;
-            i_sample_count -= i_used;
-            i_next_dts += i_used * stts->i_sample_delta[i_index];
-
-            ck->p_sample_count_dts[i] = i_used;
-            ck->p_sample_delta_dts[i] = stts->i_sample_delta[i_index];
-            if( i_used > 0 )
-                ck->i_last_dts = i_next_dts - ck->p_sample_delta_dts[i];
-
-            if( i_index_sample_used >= stts->i_sample_count[i_index] )
-            {
-                i_index++;
-                i_index_sample_used = 0;
-            }
-        }
+        ck->i_first_dts = MP4_TrackSampleDTS( p_demux_track,
+                                              ck->i_sample_first );
+        if( ck->i_sample_count > 0 )
+            ck->i_last_dts = MP4_TrackSampleDTS( p_demux_track,
+                                ck->i_sample_first + ck->i_sample_count - 1 );
+        else
+            ck->i_last_dts = ck->i_first_dts;
     }
 
     /* Find ctts
@@ -1370,65 +1371,19 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
 
         msg_Warn( p_demux, "CTTS table" );
 
-        /* Create pts-dts table per chunk */
-        i_index = 0; i_index_sample_used = 0;
-        for( i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
-        {
-            mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            int64_t i_entry, i_sample_count, i;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            i_sample_count = ck->i_sample_count;
-
-            i_entry = 0;
-            while( i_sample_count > 0 )
-            {
-                i_sample_count -= ctts->i_sample_count[i_index+i_entry];
-
-                /* don't count already used sample in this entry */
-                if( i_entry == 0 )
-                    i_sample_count += i_index_sample_used;
-
-                i_entry++;
-            }
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( i_entry, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( i_entry, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-                return VLC_ENOMEM;
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-            for( i = 0; i < i_entry; i++ )
-            {
-                int64_t i_used;
-                int64_t i_rest;
-
-                i_rest = ctts->i_sample_count[i_index] -
-                    i_index_sample_used;
-
-                i_used = __MIN( i_rest, i_sample_count );
-
-                i_index_sample_used += i_used;
-                i_sample_count -= i_used;
-
-                ck->p_sample_count_pts[i] = i_used;
-                ck->p_sample_offset_pts[i] = ctts->i_sample_offset[i_index];
-
-                if( i_index_sample_used >= ctts->i_sample_count[i_index] )
-                {
-                    i_index++;
-                    i_index_sample_used = 0;
-                }
-            }
-        }
+        if( TrackCreateRuns( &p_demux_track->pts, ctts->i_entry_count,
+                             ctts->i_sample_count, ctts->i_sample_offset,
+                             false ) )
+            return VLC_ENOMEM;
     }
 
-    msg_Dbg( p_demux, "track[Id 0x%x] read %d samples length:%"PRId64"s",
+    msg_Dbg( p_demux, "track[Id 0x%x] read %d samples (%u/%u runs) "
+             "length:%"PRIu64"s",
              p_demux_track->i_track_ID, p_demux_track->i_sample_count,
-             i_next_dts / p_demux_track->i_timescale );
+             p_demux_track->dts.i_count, p_demux_track->pts.i_count,
+             MP4_TrackSampleDTS( p_demux_track,
+                                 p_demux_track->i_sample_count ) /
+             p_demux_track->i_timescale );
 
     return VLC_SUCCESS;
 }
@@ -1965,7 +1920,6 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
     uint64_t     i_dts;
     unsigned int i_sample;
     unsigned int i_chunk;
-    int          i_index;
 
     /* FIXME see if it's needed to check p_track->i_chunk_count */
     if( p_track->i_chunk_count == 0 )
@@ -2009,52 +1963,33 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = i_start * p_track->i_timescale / (int64_t)1000000;
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
-    /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
+    /* *** find the sample: last stts run starting at or before i_start *** */
+    mp4_runs_t *p_runs = &p_track->dts;
+    uint32_t i_low = 0, i_high = p_runs->i_count;
+    while( i_high - i_low > 1 )
     {
-        if( i_chunk + 1 >= p_track->i_chunk_count )
-        {
-            /* at the end and can't check if i_start in this chunk,
-               it will be check while searching i_sample */
-            i_chunk = p_track->i_chunk_count - 1;
-            break;
-        }
-
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
-        {
-            break;
-        }
+        const uint32_t i_mid = i_low + (i_high - i_low) / 2;
+        if( p_runs->p_first_dts[i_mid] <= (uint64_t)i_start )
+            i_low = i_mid;
+        else
+            i_high = i_mid;
     }
+    i_sample = p_runs->p_sample_first[i_low];
+    i_dts    = p_runs->p_first_dts[i_low];
+    if( (uint64_t)i_start > i_dts && p_runs->p_value[i_low] > 0 )
+        i_sample += ( i_start - i_dts ) / (uint32_t)p_runs->p_value[i_low];
 
-    /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
+    /* *** find the chunk holding it *** */
+    i_low = 0; i_high = p_track->i_chunk_count;
+    while( i_high - i_low > 1 )
     {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
-        {
-            i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
-
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
-            i_index++;
-        }
+        const uint32_t i_mid = i_low + (i_high - i_low) / 2;
+        if( p_track->chunk[i_mid].i_sample_first <= i_sample )
+            i_low = i_mid;
         else
-        {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
-            {
-                break;
-            }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
-            break;
-        }
+            i_high = i_mid;
     }
+    i_chunk = i_low;
 
     if( i_sample >= p_track->i_sample_count )
     {
@@ -2406,31 +2341,21 @@ static void MP4_TrackCreate( demux_t *p_demux, mp4_track_t *p_track,
  ****************************************************************************/
 static void MP4_TrackDestroy( mp4_track_t *p_track )
 {
-    unsigned int i_chunk;
-
     p_track->b_ok = false;
     p_track->b_enable   = false;
     p_track->b_selected = false;
 
     es_format_Clean( &p_track->fmt );
 
-    for( i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-    {
-        if( p_track->chunk )
-        {
-           FREENULL(p_track->chunk[i_chunk].p_sample_count_dts);
-           FREENULL(p_track->chunk[i_chunk].p_sample_delta_dts );
-
-           FREENULL(p_track->chunk[i_chunk].p_sample_count_pts);
-           FREENULL(p_track->chunk[i_chunk].p_sample_offset_pts );
-        }
-    }
     FREENULL( p_track->chunk );
 
-    if( !p_track->i_sample_size )
-    {
-        FREENULL( p_track->p_sample_size );
-    }
+    FREENULL( p_track->dts.p_sample_first );
+    FREENULL( p_track->dts.p_first_dts );
+    FREENULL( p_track->pts.p_sample_first );
+    p_track->dts.i_count = p_track->pts.i_count = 0;
+
+    /* p_sample_size points to the stsz box */
+    p_track->p_sample_size = NULL;
 }
 
 static int MP4_TrackSelect( demux_t *p_demux, mp4_track_t *p_track,
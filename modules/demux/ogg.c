@@ -294,6 +294,12 @@ static int Demux( demux_t * p_demux )
                 continue;
             }
 
+            /* Remember where this time is, for later seeks */
+            if( ogg_page_granulepos( &p_sys->current_page ) >= 0 )
+                oggseek_cache_add( p_stream, p_sys->i_page_position,
+                                   ogg_page_granulepos( &p_sys->current_page ),
+                                   true );
+
         }
 
         while( ogg_stream_packetout( &p_stream->os, &oggpacket ) > 0 )
@@ -424,7 +430,45 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             return VLC_SUCCESS;
 
         case DEMUX_SET_TIME:
-            return VLC_EGENERIC;
+        {
+            int64_t i_time = (int64_t)va_arg( args, int64_t );
+            logical_stream_t *p_ref = NULL;
+
+            if( p_sys->i_bos > 0 )
+                return VLC_EGENERIC;
+
+            /* Seek on the video stream if any, for its keyframes */
+            for( i = 0; i < p_sys->i_streams; i++ )
+            {
+                logical_stream_t *p_stream = p_sys->pp_stream[i];
+
+                if( p_stream->f_rate <= 0 )
+                    continue;
+                if( p_stream->fmt.i_codec == VLC_CODEC_THEORA )
+                {
+                    p_ref = p_stream;
+                    break;
+                }
+                if( p_stream->fmt.i_cat == AUDIO_ES && p_ref == NULL )
+                    p_ref = p_stream;
+            }
+            if( p_ref == NULL ||
+                oggseek_find_time( p_demux, p_ref, i_time ) != VLC_SUCCESS )
+                return VLC_EGENERIC;
+
+            for( i = 0; i < p_sys->i_streams; i++ )
+            {
+                logical_stream_t *p_stream = p_sys->pp_stream[i];
+
+                p_stream->b_reinit = true;
+                p_stream->i_pcr = -1;
+                p_stream->i_interpolated_pcr = -1;
+                ogg_stream_reset( &p_stream->os );
+            }
+            es_out_Control( p_demux->out, ES_OUT_SET_NEXT_DISPLAY_TIME,
+                            VLC_TS_0 + i_time );
+            return VLC_SUCCESS;
+        }
 
         case DEMUX_SET_POSITION:
             /* forbid seeking if we haven't initialized all logical bitstreams yet;
@@ -478,6 +522,10 @@ static int Ogg_ReadPage( demux_t *p_demux, ogg_page *p_oggpage )
         ogg_sync_wrote( &p_ogg->oy, i_read );
     }
 
+    /* The page ends before the data left in the sync buffer */
+    p_ogg->i_page_position = stream_Tell( p_demux->s )
+                           - ( p_ogg->oy.fill - p_ogg->oy.returned )
+                           - p_oggpage->header_len - p_oggpage->body_len;
     return VLC_SUCCESS;
 }
 
@@ -491,29 +539,8 @@ static void Ogg_UpdatePCR( logical_stream_t *p_stream,
     /* Convert the granulepos into a pcr */
     if( p_oggpacket->granulepos >= 0 )
     {
-        if( p_stream->fmt.i_codec == VLC_CODEC_THEORA ||
-            p_stream->fmt.i_codec == VLC_CODEC_KATE )
-        {
-            ogg_int64_t iframe = p_oggpacket->granulepos >>
-              p_stream->i_granule_shift;
-            ogg_int64_t pframe = p_oggpacket->granulepos -
-              ( iframe << p_stream->i_granule_shift );
-
-            p_stream->i_pcr = ( iframe + pframe - p_stream->i_keyframe_offset )
-              * INT64_C(1000000) / p_stream->f_rate;
-        }
-        else if( p_stream->fmt.i_codec == VLC_CODEC_DIRAC )
-        {
-            ogg_int64_t i_dts = p_oggpacket->granulepos >> 31;
-            /* NB, OggDirac granulepos values are in units of 2*picturerate */
-            p_stream->i_pcr = (i_dts/2) * INT64_C(1000000) / p_stream->f_rate;
-        }
-        else
-        {
-            p_stream->i_pcr = p_oggpacket->granulepos * INT64_C(1000000)
-                              / p_stream->f_rate;
-        }
-
+        p_stream->i_pcr = oggseek_granule_to_time( p_stream,
+                                                   p_oggpacket->granulepos );
         p_stream->i_pcr += 1;
         p_stream->i_interpolated_pcr = p_stream->i_pcr;
     }
@@ -1346,6 +1373,8 @@ static int Ogg_BeginningOfStream( demux_t *p_demux )
 
         /* initialise kframe index */
         p_stream->idx=NULL;
+        p_stream->p_points = NULL;
+        p_stream->i_points = 0;
 
         /* Try first to reuse an old ES */
         if( p_old_stream &&
@@ -1441,6 +1470,7 @@ static void Ogg_LogicalStreamDelete( demux_t *p_demux, logical_stream_t *p_strea
     {
         oggseek_index_entries_free( p_stream->idx );
     }
+    oggseek_cache_free( p_stream );
 
     free( p_stream );
 }
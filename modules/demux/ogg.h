@@ -35,6 +35,7 @@
 
 
 typedef struct oggseek_index_entry demux_index_entry_t;
+typedef struct oggseek_point oggseek_point_t;
 
 
 typedef struct logical_stream_s
@@ -72,6 +73,10 @@ typedef struct logical_stream_s
     /* keyframe index for seeking, created as we discover keyframes */
     demux_index_entry_t *idx;
 
+    /* granule positions found while demuxing and seeking, by page offset */
+    oggseek_point_t *p_points;
+    int             i_points;
+
     /* skip some frames after a seek */
     int i_skip_frames;
 
@@ -123,6 +128,9 @@ struct demux_sys_t
     /* offset position in file (for reading) */
     int64_t i_input_position;
 
+    /* offset of the last page read by Ogg_ReadPage */
+    int64_t i_page_position;
+
     /* current page being parsed */
     ogg_page current_page;
 
@@ -177,6 +177,110 @@ const demux_index_entry_t *oggseek_theora_index_entry_add ( logical_stream_t *p_
 
 
 
+/************************************************************
+* granule cache
+*************************************************************/
+
+/* convert a granulepos into a time, with the same rules as the pcr */
+
+mtime_t oggseek_granule_to_time( logical_stream_t *p_stream, int64_t i_granule )
+{
+    if( p_stream->fmt.i_codec == VLC_CODEC_THEORA ||
+        p_stream->fmt.i_codec == VLC_CODEC_KATE )
+    {
+        int64_t iframe = i_granule >> p_stream->i_granule_shift;
+        int64_t pframe = i_granule - ( iframe << p_stream->i_granule_shift );
+
+        return ( iframe + pframe - p_stream->i_keyframe_offset )
+                 * INT64_C(1000000) / p_stream->f_rate;
+    }
+    else if( p_stream->fmt.i_codec == VLC_CODEC_DIRAC )
+    {
+        int64_t i_dts = i_granule >> 31;
+        /* NB, OggDirac granulepos values are in units of 2*picturerate */
+        return (i_dts/2) * INT64_C(1000000) / p_stream->f_rate;
+    }
+
+    return i_granule * INT64_C(1000000) / p_stream->f_rate;
+}
+
+
+/* index of the first point at or after i_pagepos */
+
+static int cache_lookup( logical_stream_t *p_stream, int64_t i_pagepos )
+{
+    int i_low = 0;
+    int i_high = p_stream->i_points;
+
+    while ( i_low < i_high )
+    {
+        int i_mid = ( i_low + i_high ) / 2;
+
+        if ( p_stream->p_points[i_mid].i_pagepos < i_pagepos )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+    return i_low;
+}
+
+
+/* remember that the page at i_pagepos has granulepos i_granule. If b_sparse
+   is set, the point is dropped when a known one is close enough */
+
+void oggseek_cache_add( logical_stream_t *p_stream, int64_t i_pagepos,
+                        int64_t i_granule, bool b_sparse )
+{
+    oggseek_point_t *p_point;
+    int i = cache_lookup( p_stream, i_pagepos );
+
+    if ( p_stream->f_rate <= 0 ) return;
+
+    if ( i < p_stream->i_points && p_stream->p_points[i].i_pagepos == i_pagepos )
+    {
+        p_point = &p_stream->p_points[i];
+    }
+    else
+    {
+        if ( b_sparse &&
+             ( ( i > 0 && i_pagepos - p_stream->p_points[i - 1].i_pagepos
+                            < OGGSEEK_CACHE_SPACING ) ||
+               ( i < p_stream->i_points && p_stream->p_points[i].i_pagepos
+                                             - i_pagepos < OGGSEEK_CACHE_SPACING ) ) )
+            return;
+        if ( p_stream->i_points >= OGGSEEK_CACHE_MAX ) return;
+
+        if ( ( p_stream->i_points & 255 ) == 0 )
+        {
+            oggseek_point_t *p_points =
+                realloc( p_stream->p_points,
+                         ( p_stream->i_points + 256 ) * sizeof( *p_points ) );
+            if ( p_points == NULL ) return;
+            p_stream->p_points = p_points;
+        }
+
+        memmove( &p_stream->p_points[i + 1], &p_stream->p_points[i],
+                 ( p_stream->i_points - i ) * sizeof( *p_stream->p_points ) );
+        p_stream->i_points++;
+        p_point = &p_stream->p_points[i];
+        p_point->i_pagepos = i_pagepos;
+    }
+
+    p_point->i_granule = i_granule;
+    p_point->i_time = oggseek_granule_to_time( p_stream, i_granule );
+}
+
+
+void oggseek_cache_free( logical_stream_t *p_stream )
+{
+    free( p_stream->p_points );
+    p_stream->p_points = NULL;
+    p_stream->i_points = 0;
+}
+
+
+
+
 /*********************************************************************
  * private functions
  **********************************************************************/
@@ -711,6 +815,101 @@ static int64_t find_last_theora_frame ( demux_t *p_demux, logical_stream_t *p_st
 
 
 
+/* find the first page of p_stream with a granulepos, starting between i_pos
+   and i_end; return its offset, or -1 if there is none */
+
+static int64_t find_granule_page( demux_t *p_demux, logical_stream_t *p_stream,
+                                  int64_t i_pos, int64_t i_end,
+                                  int64_t *pi_granule )
+{
+    demux_sys_t *p_sys  = p_demux->p_sys;
+    ogg_page page;
+
+    seek_byte( p_demux, i_pos );
+
+    while ( i_pos < i_end )
+    {
+        long i_result = ogg_sync_pageseek( &p_sys->oy, &page );
+
+        if ( i_result == 0 )
+        {
+            /* need more data */
+            char *buf = ogg_sync_buffer( &p_sys->oy, OGGSEEK_BYTES_TO_READ );
+            int i_read = stream_Read( p_demux->s, buf, OGGSEEK_BYTES_TO_READ );
+
+            if ( i_read <= 0 ) return -1;
+            ogg_sync_wrote( &p_sys->oy, i_read );
+            continue;
+        }
+
+        if ( i_result > 0 &&
+             ogg_page_serialno( &page ) == p_stream->os.serialno &&
+             ogg_page_granulepos( &page ) >= 0 )
+        {
+            *pi_granule = ogg_page_granulepos( &page );
+            return i_pos;
+        }
+
+        /* skipped garbage or another page */
+        i_pos += labs( i_result );
+    }
+
+    return -1;
+}
+
+
+/* bisect the file for the last page of p_stream ending at or before i_time,
+   starting from the bounds given by the cache */
+
+static int64_t find_time_page( demux_t *p_demux, logical_stream_t *p_stream,
+                               mtime_t i_time )
+{
+    demux_sys_t *p_sys  = p_demux->p_sys;
+    int64_t i_lower = p_stream->i_data_start;
+    int64_t i_upper = p_sys->i_total_length;
+    int64_t i_granule;
+
+    for ( int i = 0; i < p_stream->i_points; i++ )
+    {
+        const oggseek_point_t *p_point = &p_stream->p_points[i];
+
+        if ( p_point->i_time <= i_time )
+        {
+            if ( p_point->i_pagepos > i_lower ) i_lower = p_point->i_pagepos;
+        }
+        else if ( p_point->i_pagepos > i_lower )
+        {
+            i_upper = p_point->i_pagepos;
+            break;
+        }
+    }
+
+    while ( i_upper - i_lower > OGGSEEK_BYTES_TO_READ )
+    {
+        int64_t i_mid = i_lower + ( i_upper - i_lower ) / 2;
+        int64_t i_pagepos = find_granule_page( p_demux, p_stream, i_mid,
+                                               i_upper, &i_granule );
+
+        if ( i_pagepos < 0 )
+        {
+            i_upper = i_mid;
+            continue;
+        }
+
+        oggseek_cache_add( p_stream, i_pagepos, i_granule, false );
+
+        if ( oggseek_granule_to_time( p_stream, i_granule ) <= i_time )
+            i_lower = i_pagepos;
+        else
+            i_upper = i_mid;
+    }
+
+    return i_lower;
+}
+
+
+
+
 /************************************************************************
  * public functions
  *************************************************************************/
@@ -718,6 +917,44 @@ static int64_t find_last_theora_frame ( demux_t *p_demux, logical_stream_t *p_st
 
 
 
+/* seek to the page from which the demuxing of p_stream reaches i_time; for
+ * theora, that is the page before its last keyframe */
+
+int oggseek_find_time( demux_t *p_demux, logical_stream_t *p_stream, mtime_t i_time )
+{
+    demux_sys_t *p_sys  = p_demux->p_sys;
+    int64_t i_pagepos;
+
+    if ( p_stream->f_rate <= 0 || p_sys->i_total_length <= 0 )
+        return VLC_EGENERIC;
+
+    i_pagepos = find_time_page( p_demux, p_stream, i_time );
+
+    if ( p_stream->fmt.i_codec == VLC_CODEC_THEORA &&
+         i_pagepos > p_stream->i_data_start )
+    {
+        /* the keyframe starts after the last page ending before it */
+        int i = cache_lookup( p_stream, i_pagepos );
+
+        if ( i < p_stream->i_points &&
+             p_stream->p_points[i].i_pagepos == i_pagepos &&
+             ( p_stream->p_points[i].i_granule >> p_stream->i_granule_shift ) > 0 )
+        {
+            int64_t i_kframe = p_stream->p_points[i].i_granule
+                                 >> p_stream->i_granule_shift;
+            mtime_t i_ktime = oggseek_granule_to_time( p_stream,
+                                   i_kframe << p_stream->i_granule_shift );
+            i_pagepos = find_time_page( p_demux, p_stream, i_ktime - 1 );
+        }
+    }
+
+    seek_byte( p_demux, i_pagepos );
+    return VLC_SUCCESS;
+}
+
+
+
+
 /* return highest frame number for p_stream (which must be a theora or dirac video stream) */
 
 int64_t oggseek_get_last_frame ( demux_t *p_demux, logical_stream_t *p_stream )
@@ -49,6 +49,18 @@ struct oggseek_index_entry
     int64_t i_pagepos_end;
 };
 
+/* Points found while demuxing are kept at least this far apart (bytes) */
+#define OGGSEEK_CACHE_SPACING (256 * 1024)
+#define OGGSEEK_CACHE_MAX     65536
+
+/* this is typedefed to oggseek_point_t in ogg.h */
+struct oggseek_point
+{
+    int64_t i_pagepos;   /* offset of the page */
+    int64_t i_granule;   /* granulepos of the page */
+    mtime_t i_time;      /* time of that granulepos */
+};
+
 
 
 
@@ -58,6 +70,15 @@ const demux_index_entry_t *oggseek_theora_index_entry_add ( logical_stream_t *,
 
 void oggseek_index_entries_free ( demux_index_entry_t * );
 
+mtime_t oggseek_granule_to_time ( logical_stream_t *, int64_t i_granule );
+
+void oggseek_cache_add ( logical_stream_t *, int64_t i_pagepos,
+                         int64_t i_granule, bool b_sparse );
+
+void oggseek_cache_free ( logical_stream_t * );
+
+int oggseek_find_time ( demux_t *, logical_stream_t *, mtime_t i_time );
+
 int64_t oggseek_get_last_frame ( demux_t *, logical_stream_t *);
 
 int oggseek_find_frame ( demux_t *, logical_stream_t *, int64_t i_tframe );
@@ -124,10 +124,20 @@ typedef struct
     int     i_line_count;
     int     i_line;
     char    **line;
+
+    /* Streaming mode: the lines are read from the stream on demand */
+    stream_t *s;
+    char     *psz_line;    /* Last line read */
+    uint64_t i_line_pos;   /* Position of the last line read */
+    bool     b_pushback;   /* The last line will be read again */
 } text_t;
 
 static int  TextLoad( text_t *, stream_t *s );
 static void TextUnload( text_t * );
+static void TextStreamInit( text_t *, stream_t *s );
+static void TextStreamSeek( text_t *, uint64_t i_pos );
+static uint64_t TextStreamTell( text_t * );
+static void TextStreamClean( text_t * );
 
 typedef struct
 {
@@ -137,6 +147,21 @@ typedef struct
     char    *psz_text;
 } subtitle_t;
 
+/* Entry of the time to offset index of the streaming mode */
+typedef struct
+{
+    int64_t  i_start;  /* Start time of the subtitle */
+    uint64_t i_offset; /* Position in the stream to parse it from */
+    int      i_idx;    /* Its index in the file */
+} subtitle_index_t;
+
+/* Files larger than this are not loaded in memory but parsed on the fly,
+ * if the format allows it */
+#define SUB_STREAM_MIN_SIZE (16 << 20)
+/* Number of subtitles parsed at once in streaming mode */
+#define SUB_STREAM_WINDOW   (128)
+/* One index entry every SUB_STREAM_INDEX_STEP subtitles */
+#define SUB_STREAM_INDEX_STEP (64)
 
 struct demux_sys_t
 {
@@ -154,6 +179,19 @@ struct demux_sys_t
 
     int64_t     i_length;
 
+    int  (*pf_read)( demux_t *, subtitle_t*, int );
+
+    /* Streaming mode: subtitle[] only holds the window being demuxed */
+    struct
+    {
+        bool b_enabled;
+        bool b_eof;
+        int  i_idx;     /* Index of the next subtitle to parse */
+
+        int              i_index;
+        subtitle_index_t *p_index;
+    } stream;
+
     /* */
     struct
     {
@@ -228,6 +266,13 @@ static int Control( demux_t *, int, va_list );
 
 static void Fix( demux_t * );
 
+static bool StreamIsSupported( demux_t * );
+static int  StreamScan( demux_t * );
+static void StreamSeek( demux_t *, int64_t i_time );
+static bool SubtitleAvailable( demux_t * );
+static void SubtitlesClean( demux_sys_t * );
+static void Rewind( demux_t *, int64_t i_time );
+
 /*****************************************************************************
  * Module initializer
  *****************************************************************************/
@@ -259,6 +304,10 @@ static int Open ( vlc_object_t *p_this )
     p_sys->subtitle           = NULL;
     p_sys->i_microsecperframe = 40000;
 
+    p_sys->stream.b_enabled   = false;
+    p_sys->stream.i_index     = 0;
+    p_sys->stream.p_index     = NULL;
+
     p_sys->jss.b_inited       = false;
     p_sys->mpsub.b_inited     = false;
 
@@ -470,6 +519,39 @@ static int Open ( vlc_object_t *p_this )
             break;
         }
     }
+    p_sys->pf_read = pf_read;
+
+    /* Large files are indexed, and then parsed around the playback
+     * position only */
+    if( StreamIsSupported( p_demux ) )
+    {
+        msg_Dbg( p_demux, "indexing subtitles..." );
+        if( !StreamScan( p_demux ) )
+        {
+            p_sys->subtitle = malloc( SUB_STREAM_WINDOW * sizeof(subtitle_t) );
+            if( !p_sys->subtitle )
+            {
+                TextStreamClean( &p_sys->txt );
+                free( p_sys->stream.p_index );
+                free( p_sys->psz_header );
+                free( p_sys );
+                return VLC_ENOMEM;
+            }
+            p_sys->stream.b_enabled = true;
+            StreamSeek( p_demux, 0 );
+            goto add_es;
+        }
+
+        /* Fall back to loading the whole file */
+        TextStreamClean( &p_sys->txt );
+        free( p_sys->stream.p_index );
+        p_sys->stream.p_index = NULL;
+        p_sys->stream.i_index = 0;
+        free( p_sys->psz_header );
+        p_sys->psz_header = NULL;
+        if( stream_Seek( p_demux->s, 0 ) )
+            msg_Warn( p_demux, "failed to rewind" );
+    }
 
     msg_Dbg( p_demux, "loading all subtitles..." );
 
@@ -514,11 +596,13 @@ static int Open ( vlc_object_t *p_this )
     }
 
     /* *** add subtitle ES *** */
+add_es:
     if( p_sys->i_type == SUB_TYPE_SSA1 ||
              p_sys->i_type == SUB_TYPE_SSA2_4 ||
              p_sys->i_type == SUB_TYPE_ASS )
     {
-        Fix( p_demux );
+        if( !p_sys->stream.b_enabled )
+            Fix( p_demux );
         es_format_Init( &fmt, SPU_ES, VLC_CODEC_SSA );
     }
     else
@@ -548,12 +632,16 @@ static void Close( vlc_object_t *p_this )
 {
     demux_t *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = p_demux->p_sys;
-    int i;
 
-    for( i = 0; i < p_sys->i_subtitles; i++ )
-        free( p_sys->subtitle[i].psz_text );
+    SubtitlesClean( p_sys );
     free( p_sys->subtitle );
 
+    if( p_sys->stream.b_enabled )
+    {
+        TextStreamClean( &p_sys->txt );
+        free( p_sys->stream.p_index );
+    }
+    free( p_sys->psz_header );
     free( p_sys );
 }
 
@@ -575,7 +663,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_GET_TIME:
             pi64 = (int64_t*)va_arg( args, int64_t * );
-            if( p_sys->i_subtitle < p_sys->i_subtitles )
+            if( SubtitleAvailable( p_demux ) )
             {
                 *pi64 = p_sys->subtitle[p_sys->i_subtitle].i_start;
                 return VLC_SUCCESS;
@@ -584,8 +672,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_SET_TIME:
             i64 = (int64_t)va_arg( args, int64_t );
-            p_sys->i_subtitle = 0;
-            while( p_sys->i_subtitle < p_sys->i_subtitles )
+            Rewind( p_demux, i64 );
+            while( SubtitleAvailable( p_demux ) )
             {
                 const subtitle_t *p_subtitle = &p_sys->subtitle[p_sys->i_subtitle];
 
@@ -603,7 +691,7 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         case DEMUX_GET_POSITION:
             pf = (double*)va_arg( args, double * );
-            if( p_sys->i_subtitle >= p_sys->i_subtitles )
+            if( !SubtitleAvailable( p_demux ) )
             {
                 *pf = 1.0;
             }
@@ -622,8 +710,8 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
             f = (double)va_arg( args, double );
             i64 = f * p_sys->i_length;
 
-            p_sys->i_subtitle = 0;
-            while( p_sys->i_subtitle < p_sys->i_subtitles &&
+            Rewind( p_demux, i64 );
+            while( SubtitleAvailable( p_demux ) &&
                    p_sys->subtitle[p_sys->i_subtitle].i_start < i64 )
             {
                 p_sys->i_subtitle++;
@@ -659,17 +747,17 @@ static int Demux( demux_t *p_demux )
     demux_sys_t *p_sys = p_demux->p_sys;
     int64_t i_maxdate;
 
-    if( p_sys->i_subtitle >= p_sys->i_subtitles )
+    if( !SubtitleAvailable( p_demux ) )
         return 0;
 
     i_maxdate = p_sys->i_next_demux_date - var_GetTime( p_demux->p_parent, "spu-delay" );;
-    if( i_maxdate <= 0 && p_sys->i_subtitle < p_sys->i_subtitles )
+    if( i_maxdate <= 0 )
     {
         /* Should not happen */
         i_maxdate = p_sys->subtitle[p_sys->i_subtitle].i_start + 1;
     }
 
-    while( p_sys->i_subtitle < p_sys->i_subtitles &&
+    while( SubtitleAvailable( p_demux ) &&
            p_sys->subtitle[p_sys->i_subtitle].i_start < i_maxdate )
     {
         const subtitle_t *p_subtitle = &p_sys->subtitle[p_sys->i_subtitle];
@@ -749,6 +837,9 @@ static int TextLoad( text_t *txt, stream_t *s )
 
     /* init txt */
     i_line_max          = 500;
+    txt->s              = NULL;
+    txt->psz_line       = NULL;
+    txt->b_pushback     = false;
     txt->i_line_count   = 0;
     txt->i_line         = 0;
     txt->line           = calloc( i_line_max, sizeof( char * ) );
@@ -796,6 +887,19 @@ static void TextUnload( text_t *txt )
 
 static char *TextGetLine( text_t *txt )
 {
+    if( txt->s != NULL )
+    {
+        if( txt->b_pushback )
+        {
+            txt->b_pushback = false;
+            return txt->psz_line;
+        }
+        free( txt->psz_line );
+        txt->i_line_pos = stream_Tell( txt->s );
+        txt->psz_line = stream_ReadLine( txt->s );
+        return txt->psz_line;
+    }
+
     if( txt->i_line >= txt->i_line_count )
         return( NULL );
 
@@ -803,10 +907,221 @@ static char *TextGetLine( text_t *txt )
 }
 static void TextPreviousLine( text_t *txt )
 {
+    if( txt->s != NULL )
+    {
+        if( txt->psz_line != NULL )
+            txt->b_pushback = true;
+        return;
+    }
+
     if( txt->i_line > 0 )
         txt->i_line--;
 }
 
+/* In streaming mode, the lines are read one at a time from the stream, and
+ * only the last one is kept (it can be read again with TextPreviousLine) */
+static void TextStreamInit( text_t *txt, stream_t *s )
+{
+    txt->i_line_count = 0;
+    txt->i_line       = 0;
+    txt->line         = NULL;
+    txt->s            = s;
+    txt->psz_line     = NULL;
+    txt->i_line_pos   = 0;
+    txt->b_pushback   = false;
+}
+static void TextStreamClean( text_t *txt )
+{
+    free( txt->psz_line );
+    txt->psz_line   = NULL;
+    txt->b_pushback = false;
+    txt->s          = NULL;
+}
+/* Returns the position of the next line to be read */
+static uint64_t TextStreamTell( text_t *txt )
+{
+    if( txt->b_pushback )
+        return txt->i_line_pos;
+    return stream_Tell( txt->s );
+}
+static void TextStreamSeek( text_t *txt, uint64_t i_pos )
+{
+    free( txt->psz_line );
+    txt->psz_line   = NULL;
+    txt->b_pushback = false;
+    stream_Seek( txt->s, i_pos );
+}
+
+/*****************************************************************************
+ * Streaming mode: instead of loading the whole file, it is scanned once to
+ * build a sparse time to offset index, and the subtitles are then parsed
+ * SUB_STREAM_WINDOW at a time, from the playback position.
+ *****************************************************************************/
+static bool StreamIsSupported( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    bool b_fast_seek;
+
+    /* Only the formats parsed subtitle by subtitle, without looking back */
+    switch( p_sys->i_type )
+    {
+        case SUB_TYPE_MICRODVD:
+        case SUB_TYPE_SUBRIP:
+        case SUB_TYPE_SUBRIP_DOT:
+        case SUB_TYPE_SUBVIEWER:
+        case SUB_TYPE_SSA1:
+        case SUB_TYPE_SSA2_4:
+        case SUB_TYPE_ASS:
+        case SUB_TYPE_MPL2:
+            break;
+        default:
+            return false;
+    }
+
+    if( stream_Control( p_demux->s, STREAM_CAN_FASTSEEK, &b_fast_seek ) ||
+        !b_fast_seek )
+        return false;
+    return stream_Size( p_demux->s ) >= SUB_STREAM_MIN_SIZE;
+}
+
+/* Parses the whole file once to build the index. It fails if the subtitles
+ * are not in chronological order, as they would need to be sorted. */
+static int StreamScan( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    text_t      *txt = &p_sys->txt;
+    subtitle_t  sub;
+    int64_t     i_last_start = INT64_MIN;
+    int64_t     i_last_stop = 0;
+    int         i_idx;
+
+    TextStreamInit( txt, p_demux->s );
+
+    for( i_idx = 0; ; i_idx++ )
+    {
+        const uint64_t i_offset = TextStreamTell( txt );
+
+        if( p_sys->pf_read( p_demux, &sub, i_idx ) )
+            break;
+        free( sub.psz_text );
+
+        if( sub.i_start < i_last_start )
+        {
+            msg_Dbg( p_demux, "subtitles are not ordered, cannot index them" );
+            return VLC_EGENERIC;
+        }
+        i_last_start = sub.i_start;
+        i_last_stop  = sub.i_stop;
+
+        if( i_idx % SUB_STREAM_INDEX_STEP == 0 )
+        {
+            subtitle_index_t *p_index =
+                realloc( p_sys->stream.p_index,
+                         (p_sys->stream.i_index + 1) * sizeof(*p_index) );
+            if( !p_index )
+                return VLC_ENOMEM;
+            p_index[p_sys->stream.i_index].i_start  = sub.i_start;
+            p_index[p_sys->stream.i_index].i_offset = i_offset;
+            p_index[p_sys->stream.i_index].i_idx    = i_idx;
+            p_sys->stream.p_index = p_index;
+            p_sys->stream.i_index++;
+        }
+    }
+
+    if( i_idx <= 0 )
+        return VLC_EGENERIC;
+
+    msg_Dbg( p_demux, "indexed %d subtitles (%d index entries)",
+             i_idx, p_sys->stream.i_index );
+
+    p_sys->i_length = i_last_stop;
+    /* +1 to avoid 0 */
+    if( p_sys->i_length <= 0 )
+        p_sys->i_length = i_last_start + 1;
+    return VLC_SUCCESS;
+}
+
+static void SubtitlesClean( demux_sys_t *p_sys )
+{
+    for( int i = 0; i < p_sys->i_subtitles; i++ )
+        free( p_sys->subtitle[i].psz_text );
+    p_sys->i_subtitles = 0;
+    p_sys->i_subtitle  = 0;
+}
+
+/* Moves the reading position before the subtitles starting at i_time,
+ * far enough back to catch most of the ones still displayed at that time */
+static void StreamSeek( demux_t *p_demux, int64_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const subtitle_index_t *p_index = p_sys->stream.p_index;
+    int i_low = 0;
+    int i_high = p_sys->stream.i_index - 1;
+
+    /* Last entry starting at or before i_time */
+    while( i_low < i_high )
+    {
+        const int i_mid = ( i_low + i_high + 1 ) / 2;
+
+        if( p_index[i_mid].i_start <= i_time )
+            i_low = i_mid;
+        else
+            i_high = i_mid - 1;
+    }
+    if( i_low > 0 )
+        i_low--;
+
+    SubtitlesClean( p_sys );
+    TextStreamSeek( &p_sys->txt, p_index[i_low].i_offset );
+    p_sys->stream.i_idx = p_index[i_low].i_idx;
+    p_sys->stream.b_eof = false;
+}
+
+/* Parses the next window of subtitles */
+static void StreamLoad( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    SubtitlesClean( p_sys );
+    while( p_sys->i_subtitles < SUB_STREAM_WINDOW )
+    {
+        if( p_sys->pf_read( p_demux, &p_sys->subtitle[p_sys->i_subtitles],
+                            p_sys->stream.i_idx ) )
+        {
+            p_sys->stream.b_eof = true;
+            break;
+        }
+        p_sys->i_subtitles++;
+        p_sys->stream.i_idx++;
+    }
+}
+
+/* Returns whether p_sys->subtitle[p_sys->i_subtitle] is valid, parsing the
+ * next subtitles in streaming mode */
+static bool SubtitleAvailable( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->i_subtitle < p_sys->i_subtitles )
+        return true;
+    if( !p_sys->stream.b_enabled || p_sys->stream.b_eof )
+        return false;
+
+    StreamLoad( p_demux );
+    return p_sys->i_subtitle < p_sys->i_subtitles;
+}
+
+/* Restarts the demuxing from the subtitles around i_time */
+static void Rewind( demux_t *p_demux, int64_t i_time )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->stream.b_enabled )
+        StreamSeek( p_demux, i_time );
+    else
+        p_sys->i_subtitle = 0;
+}
+
 /*****************************************************************************
  * Specific Subtitle function
  *****************************************************************************/
@@ -1064,7 +1379,10 @@ static int  ParseSSA( demux_t *p_demux, subtitle_t *p_subtitle,
         }
         free( psz_text );
 
-        /* All the other stuff we add to the header field */
+        /* All the other stuff we add to the header field, once */
+        if( p_sys->stream.b_enabled )
+            continue;
+
         char *psz_header;
         if( asprintf( &psz_header, "%s%s\n",
                        p_sys->psz_header ? p_sys->psz_header : "", s ) == -1 )
@@ -292,6 +292,8 @@ typedef struct
     int         i_pes_gathered;
     block_t     *p_pes;
     block_t     **pp_last;
+    block_t     *p_pes_last;    /* last block of p_pes */
+    size_t      i_pes_room;     /* free space at the end of p_pes_last */
 
     es_mpeg4_descriptor_t *p_mpeg4desc;
     int         b_gather;
@@ -389,14 +391,14 @@ static void PSINewTableCallBack( demux_t *, dvbpsi_handle,
                                  uint8_t  i_table_id, uint16_t i_extension );
 static int ChangeKeyCallback( vlc_object_t *, char const *, vlc_value_t, vlc_value_t, void * );
 
-static inline int PIDGet( block_t *p )
+static inline int PIDGet( const uint8_t *p )
 {
-    return ( (p->p_buffer[1]&0x1f)<<8 )|p->p_buffer[2];
+    return ( (p[1]&0x1f)<<8 )|p[2];
 }
 
-static bool GatherPES( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk );
+static bool GatherPES( demux_t *p_demux, ts_pid_t *pid, const uint8_t *p );
 
-static void PCRHandle( demux_t *p_demux, ts_pid_t *, block_t * );
+static void PCRHandle( demux_t *p_demux, ts_pid_t *, const uint8_t * );
 
 static iod_descriptor_t *IODNew( int , uint8_t * );
 static void              IODFree( iod_descriptor_t * );
@@ -413,6 +415,10 @@ static void SetPrgFilter( demux_t *, int i_prg, bool b_selected );
 #define TS_PACKET_SIZE_MAX 204
 #define TS_TOPFIELD_HEADER 1320
 
+/* Bounds of the size of the blocks PES payloads are gathered in */
+#define TS_PES_BLOCK_MIN (16 * 184)
+#define TS_PES_BLOCK_MAX (1024 * 1024)
+
 /*****************************************************************************
  * Open
  *****************************************************************************/
@@ -1011,111 +1017,121 @@ static int DemuxFile( demux_t *p_demux )
 /*****************************************************************************
  * Demux:
  *****************************************************************************/
-static int Demux( demux_t *p_demux )
+/* Skips garbage up to the next TS packet, returns false at end of stream */
+static bool Resync( demux_t *p_demux )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    bool b_wait_es = p_sys->i_pmt_es <= 0;
 
-    /* We read at most 100 TS packet or until a frame is completed */
-    for( int i_pkt = 0; i_pkt < p_sys->i_ts_read; i_pkt++ )
+    msg_Warn( p_demux, "lost synchro" );
+
+    while( vlc_object_alive (p_demux) )
     {
-        bool         b_frame = false;
-        block_t     *p_pkt;
+        const uint8_t *p_peek;
+        int i_peek, i_skip = 0;
 
-        /* Get a new TS packet */
-        if( !( p_pkt = stream_Block( p_demux->s, p_sys->i_packet_size ) ) )
+        i_peek = stream_Peek( p_demux->s, &p_peek,
+                              p_sys->i_packet_size * 10 );
+        if( i_peek < p_sys->i_packet_size + 1 )
         {
             msg_Dbg( p_demux, "eof ?" );
-            return 0;
+            return false;
         }
 
-        /* Check sync byte and re-sync if needed */
-        if( p_pkt->p_buffer[0] != 0x47 )
+        while( i_skip < i_peek - p_sys->i_packet_size )
         {
-            msg_Warn( p_demux, "lost synchro" );
-            block_Release( p_pkt );
-
-            while( vlc_object_alive (p_demux) )
+            if( p_peek[i_skip] == 0x47 &&
+                p_peek[i_skip + p_sys->i_packet_size] == 0x47 )
             {
-                const uint8_t *p_peek;
-                int i_peek, i_skip = 0;
+                break;
+            }
+            i_skip++;
+        }
 
-                i_peek = stream_Peek( p_demux->s, &p_peek,
-                                      p_sys->i_packet_size * 10 );
-                if( i_peek < p_sys->i_packet_size + 1 )
-                {
-                    msg_Dbg( p_demux, "eof ?" );
-                    return 0;
-                }
+        msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
+        stream_Read( p_demux->s, NULL, i_skip );
 
-                while( i_skip < i_peek - p_sys->i_packet_size )
-                {
-                    if( p_peek[i_skip] == 0x47 &&
-                        p_peek[i_skip + p_sys->i_packet_size] == 0x47 )
-                    {
-                        break;
-                    }
-                    i_skip++;
-                }
+        if( i_skip < i_peek - p_sys->i_packet_size )
+        {
+            break;
+        }
+    }
+    return true;
+}
 
-                msg_Dbg( p_demux, "skipping %d bytes of garbage", i_skip );
-                stream_Read( p_demux->s, NULL, i_skip );
+static int Demux( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    const int i_packet_size = p_sys->i_packet_size;
+    bool b_wait_es = p_sys->i_pmt_es <= 0;
+    const uint8_t *p_peek;
+    int i_peek;
+    int i_pkt;
+
+    /* We parse at most i_ts_read TS packets or until a frame is completed.
+     * The packets are peeked all at once, and consumed with a single read
+     * once parsed, instead of going through the stream for each of them.
+     * Only the payloads of the PES being gathered are copied. The PSI
+     * handlers may control the stream (the PMT one sets the access private
+     * IDs), so a PSI packet ends the batch and is only pushed once the
+     * batch is consumed. */
+    uint8_t psi_packet[TS_PACKET_SIZE_188];
+    ts_pid_t *p_psi_pid = NULL;
+
+    i_peek = stream_Peek( p_demux->s, &p_peek,
+                          i_packet_size * p_sys->i_ts_read );
+    if( i_peek < i_packet_size )
+    {
+        msg_Dbg( p_demux, "eof ?" );
+        return 0;
+    }
 
-                if( i_skip < i_peek - p_sys->i_packet_size )
-                {
-                    break;
-                }
-            }
+    /* Check sync byte and re-sync if needed */
+    if( p_peek[0] != 0x47 )
+        return Resync( p_demux ) ? 1 : 0;
 
-            if( !( p_pkt = stream_Block( p_demux->s, p_sys->i_packet_size ) ) )
-            {
-                msg_Dbg( p_demux, "eof ?" );
-                return 0;
-            }
-        }
+    if( p_sys->b_start_record )
+    {
+        /* Enable recording once synchronized */
+        stream_Control( p_demux->s, STREAM_SET_RECORD_STATE, true, "ts" );
+        p_sys->b_start_record = false;
+        return 1;
+    }
 
-        if( p_sys->b_start_record )
-        {
-            /* Enable recording once synchronized */
-            stream_Control( p_demux->s, STREAM_SET_RECORD_STATE, true, "ts" );
-            p_sys->b_start_record = false;
-        }
+    for( i_pkt = 0; i_pkt < i_peek / i_packet_size; )
+    {
+        const uint8_t *p = &p_peek[i_pkt * i_packet_size];
+        bool b_frame = false;
+
+        /* Lost synchro will be handled by the next call */
+        if( p[0] != 0x47 )
+            break;
 
         if( p_sys->b_udp_out )
         {
-            memcpy( &p_sys->buffer[i_pkt * p_sys->i_packet_size],
-                    p_pkt->p_buffer, p_sys->i_packet_size );
+            memcpy( &p_sys->buffer[i_pkt * i_packet_size], p,
+                    i_packet_size );
         }
+        i_pkt++;
 
         /* Parse the TS packet */
-        ts_pid_t *p_pid = &p_sys->pid[PIDGet( p_pkt )];
+        ts_pid_t *p_pid = &p_sys->pid[PIDGet( p )];
 
         if( p_pid->b_valid )
         {
             if( p_pid->psi )
             {
-                if( p_pid->i_pid == 0 || ( p_sys->b_dvb_meta && ( p_pid->i_pid == 0x11 || p_pid->i_pid == 0x12 || p_pid->i_pid == 0x14 ) ) )
-                {
-                    dvbpsi_PushPacket( p_pid->psi->handle, p_pkt->p_buffer );
-                }
-                else
-                {
-                    for( int i_prg = 0; i_prg < p_pid->psi->i_prg; i_prg++ )
-                    {
-                        dvbpsi_PushPacket( p_pid->psi->prg[i_prg]->handle,
-                                           p_pkt->p_buffer );
-                    }
-                }
-                block_Release( p_pkt );
+                memcpy( psi_packet, p, TS_PACKET_SIZE_188 );
+                p_psi_pid = p_pid;
+                p_pid->b_seen = true;
+                break;
             }
             else if( !p_sys->b_udp_out )
             {
-                b_frame = GatherPES( p_demux, p_pid, p_pkt );
+                b_frame = GatherPES( p_demux, p_pid, p );
             }
             else
             {
-                PCRHandle( p_demux, p_pid, p_pkt );
-                block_Release( p_pkt );
+                PCRHandle( p_demux, p_pid, p );
             }
         }
         else
@@ -1125,8 +1141,7 @@ static int Demux( demux_t *p_demux )
                 msg_Dbg( p_demux, "pid[%d] unknown", p_pid->i_pid );
             }
             /* We have to handle PCR if present */
-            PCRHandle( p_demux, p_pid, p_pkt );
-            block_Release( p_pkt );
+            PCRHandle( p_demux, p_pid, p );
         }
         p_pid->b_seen = true;
 
@@ -1134,11 +1149,29 @@ static int Demux( demux_t *p_demux )
             break;
     }
 
+    stream_Read( p_demux->s, NULL, i_pkt * i_packet_size );
+
     if( p_sys->b_udp_out )
     {
         /* Send the complete block */
         net_Write( p_demux, p_sys->fd, NULL, p_sys->buffer,
-                   p_sys->i_ts_read * p_sys->i_packet_size );
+                   i_pkt * i_packet_size );
+    }
+
+    if( p_psi_pid != NULL )
+    {
+        if( p_psi_pid->i_pid == 0 || ( p_sys->b_dvb_meta && ( p_psi_pid->i_pid == 0x11 || p_psi_pid->i_pid == 0x12 || p_psi_pid->i_pid == 0x14 ) ) )
+        {
+            dvbpsi_PushPacket( p_psi_pid->psi->handle, psi_packet );
+        }
+        else
+        {
+            for( int i_prg = 0; i_prg < p_psi_pid->psi->i_prg; i_prg++ )
+            {
+                dvbpsi_PushPacket( p_psi_pid->psi->prg[i_prg]->handle,
+                                   psi_packet );
+            }
+        }
     }
 
     return 1;
@@ -1564,6 +1597,8 @@ static void PIDInit( ts_pid_t *pid, bool b_psi, ts_psi_t *p_owner )
             pid->es->i_pes_size= 0;
             pid->es->i_pes_gathered= 0;
             pid->es->pp_last = &pid->es->p_pes;
+            pid->es->p_pes_last = NULL;
+            pid->es->i_pes_room = 0;
             pid->es->p_mpeg4desc = NULL;
             pid->es->b_gather = false;
         }
@@ -1645,6 +1680,8 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid )
     pid->es->i_pes_size= 0;
     pid->es->i_pes_gathered= 0;
     pid->es->pp_last = &pid->es->p_pes;
+    pid->es->p_pes_last = NULL;
+    pid->es->i_pes_room = 0;
 
     /* FIXME find real max size */
     /* const int i_max = */ block_ChainExtract( p_pes, header, 34 );
@@ -1840,10 +1877,9 @@ static void ParsePES( demux_t *p_demux, ts_pid_t *pid )
     }
 }
 
-static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
+static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, const uint8_t *p )
 {
     demux_sys_t   *p_sys = p_demux->p_sys;
-    const uint8_t *p = p_bk->p_buffer;
 
     if( p_sys->i_pmt_es <= 0 )
         return;
@@ -1875,9 +1911,65 @@ static void PCRHandle( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
     }
 }
 
-static bool GatherPES( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
+/* Appends a TS payload to the PES being gathered. Payloads are copied in
+ * blocks with room for the following ones (the whole PES when its size is
+ * known), instead of using one block per TS packet. */
+static void PESAppend( ts_es_t *es, const uint8_t *p_data, size_t i_data )
 {
-    const uint8_t *p = p_bk->p_buffer;
+    if( es->i_pes_room < i_data )
+    {
+        size_t i_size;
+
+        if( es->i_pes_size > es->i_pes_gathered )
+            i_size = es->i_pes_size - es->i_pes_gathered;
+        else
+            i_size = __MIN( __MAX( (size_t)es->i_pes_gathered,
+                                   TS_PES_BLOCK_MIN ), TS_PES_BLOCK_MAX );
+        if( i_size < i_data )
+            i_size = i_data;
+
+        block_t *p_block = block_Alloc( i_size );
+        if( p_block == NULL )
+        {
+            if( es->p_pes )
+                es->p_pes->i_flags |= BLOCK_FLAG_CORRUPTED;
+            return;
+        }
+        p_block->i_buffer = 0;
+        block_ChainLastAppend( &es->pp_last, p_block );
+        es->p_pes_last = p_block;
+        es->i_pes_room = i_size;
+    }
+
+    block_t *p_last = es->p_pes_last;
+    memcpy( &p_last->p_buffer[p_last->i_buffer], p_data, i_data );
+    p_last->i_buffer += i_data;
+    es->i_pes_room -= i_data;
+    es->i_pes_gathered += i_data;
+}
+
+static bool GatherPES( demux_t *p_demux, ts_pid_t *pid, const uint8_t *p )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    ts_es_t     *es = pid->es;
+
+    /* Fast path for the bulk of the packets of a multiplex: continuation
+     * of a PES being gathered, in sequence, without adaptation field,
+     * error nor scrambling */
+    if( ( p[1]&0xc0 ) == 0x00 && ( p[3]&0xf0 ) == 0x10 &&
+        ( p[3]&0x0f ) == ( ( pid->i_cc + 1 )&0x0f ) &&
+        es->p_pes != NULL && !pid->b_scrambled && p_sys->csa == NULL )
+    {
+        pid->i_cc = p[3]&0x0f;
+        PESAppend( es, &p[4], TS_PACKET_SIZE_188 - 4 );
+        if( es->i_pes_size > 0 && es->i_pes_gathered >= es->i_pes_size )
+        {
+            ParsePES( p_demux, pid );
+            return true;
+        }
+        return false;
+    }
+
     const bool b_unit_start = p[1]&0x40;
     const bool b_scrambled  = p[3]&0x80;
     const bool b_adaptation = p[3]&0x20;
@@ -1885,6 +1977,17 @@ static bool GatherPES( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
     const int  i_cc         = p[3]&0x0f; /* continuity counter */
     bool       b_discontinuity = false;  /* discontinuity */
 
+    /* Decrypt a copy of the packet, the header is left untouched */
+    uint8_t     decrypted[TS_PACKET_SIZE_188];
+    if( p_sys->csa )
+    {
+        memcpy( decrypted, p, TS_PACKET_SIZE_188 );
+        vlc_mutex_lock( &p_sys->csa_lock );
+        csa_Decrypt( p_sys->csa, decrypted, p_sys->i_csa_pkt_size );
+        vlc_mutex_unlock( &p_sys->csa_lock );
+        p = decrypted;
+    }
+
     /* transport_scrambling_control is ignored */
     int         i_skip = 0;
     bool        i_ret  = false;
@@ -1897,7 +2000,6 @@ static bool GatherPES( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
 
     /* For now, ignore additional error correction
      * TODO: handle Reed-Solomon 204,188 error correction */
-    p_bk->i_buffer = TS_PACKET_SIZE_188;
 
     if( p[1]&0x80 )
     {
@@ -1907,13 +2009,6 @@ static bool GatherPES( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
             pid->es->p_pes->i_flags |= BLOCK_FLAG_CORRUPTED;
     }
 
-    if( p_demux->p_sys->csa )
-    {
-        vlc_mutex_lock( &p_demux->p_sys->csa_lock );
-        csa_Decrypt( p_demux->p_sys->csa, p_bk->p_buffer, p_demux->p_sys->i_csa_pkt_size );
-        vlc_mutex_unlock( &p_demux->p_sys->csa_lock );
-    }
-
     if( !b_adaptation )
     {
         /* We don't have any adaptation_field, so payload starts
@@ -1976,13 +2071,10 @@ static bool GatherPES( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
         }
     }
 
-    PCRHandle( p_demux, pid, p_bk );
+    PCRHandle( p_demux, pid, p );
 
-    if( i_skip >= 188 || pid->es->id == NULL || p_demux->p_sys->b_udp_out )
-    {
-        block_Release( p_bk );
+    if( i_skip >= 188 || pid->es->id == NULL || p_sys->b_udp_out )
         return i_ret;
-    }
 
     /* */
     if( !pid->b_scrambled != !b_scrambled )
@@ -2002,52 +2094,41 @@ static bool GatherPES( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk )
     }
 
     /* We have to gather it */
-    p_bk->p_buffer += i_skip;
-    p_bk->i_buffer -= i_skip;
+    const uint8_t *p_data = &p[i_skip];
+    const size_t   i_data = TS_PACKET_SIZE_188 - i_skip;
 
     if( b_unit_start )
     {
-        if( pid->es->p_pes )
+        if( es->p_pes )
         {
             ParsePES( p_demux, pid );
             i_ret = true;
         }
 
-        block_ChainLastAppend( &pid->es->pp_last, p_bk );
-        if( p_bk->i_buffer > 6 )
+        if( i_data > 6 )
         {
-            pid->es->i_pes_size = GetWBE( &p_bk->p_buffer[4] );
-            if( pid->es->i_pes_size > 0 )
+            es->i_pes_size = GetWBE( &p_data[4] );
+            if( es->i_pes_size > 0 )
             {
-                pid->es->i_pes_size += 6;
+                es->i_pes_size += 6;
             }
         }
-        pid->es->i_pes_gathered += p_bk->i_buffer;
-        if( pid->es->i_pes_size > 0 &&
-            pid->es->i_pes_gathered >= pid->es->i_pes_size )
-        {
-            ParsePES( p_demux, pid );
-            i_ret = true;
-        }
+        PESAppend( es, p_data, i_data );
+    }
+    else if( es->p_pes == NULL )
+    {
+        /* msg_Dbg( p_demux, "broken packet" ); */
+        return i_ret;
     }
     else
     {
-        if( pid->es->p_pes == NULL )
-        {
-            /* msg_Dbg( p_demux, "broken packet" ); */
-            block_Release( p_bk );
-        }
-        else
-        {
-            block_ChainLastAppend( &pid->es->pp_last, p_bk );
-            pid->es->i_pes_gathered += p_bk->i_buffer;
-            if( pid->es->i_pes_size > 0 &&
-                pid->es->i_pes_gathered >= pid->es->i_pes_size )
-            {
-                ParsePES( p_demux, pid );
-                i_ret = true;
-            }
-        }
+        PESAppend( es, p_data, i_data );
+    }
+
+    if( es->i_pes_size > 0 && es->i_pes_gathered >= es->i_pes_size )
+    {
+        ParsePES( p_demux, pid );
+        i_ret = true;
     }
 
     return i_ret;
@@ -3278,6 +3359,8 @@ static void PMTSetupEsTeletext( demux_t *p_demux, ts_pid_t *pid,
                 p_es->i_pes_size = 0;
                 p_es->i_pes_gathered = 0;
                 p_es->pp_last = &p_es->p_pes;
+                p_es->p_pes_last = NULL;
+                p_es->i_pes_room = 0;
                 p_es->p_mpeg4desc = NULL;
                 p_es->b_gather = false;
 
@@ -3365,6 +3448,8 @@ static void PMTSetupEsDvbSubtitle( demux_t *p_demux, ts_pid_t *pid,
                 p_es->i_pes_size = 0;
                 p_es->i_pes_gathered = 0;
                 p_es->pp_last = &p_es->p_pes;
+                p_es->p_pes_last = NULL;
+                p_es->i_pes_room = 0;
                 p_es->p_mpeg4desc = NULL;
                 p_es->b_gather = false;
 
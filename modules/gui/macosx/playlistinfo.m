@@ -252,7 +252,7 @@ static VLCInfo *_o_sharedInstance = nil;
     {
         if( !input_item_IsPreparsed( p_item ) )
         {
-            playlist_PreparseEnqueue( pl_Get( VLCIntf ), p_item );
+            playlist_PreparsePrioritize( pl_Get( VLCIntf ), p_item );
         }
 
         /* fill uri info */
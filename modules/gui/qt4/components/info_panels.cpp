@@ -519,6 +519,10 @@ InputStatsPanel::InputStatsPanel( QWidget *parent,
                            "0", input , "KiB" );
     CREATE_AND_ADD_TO_CAT( input_bitrate_stat, qtr("Input bitrate"),
                            "0", input, "kb/s" );
+    CREATE_AND_ADD_TO_CAT( cache_hits_stat, qtr("Cache hits"),
+                           "0", input, "" );
+    CREATE_AND_ADD_TO_CAT( cache_misses_stat, qtr("Cache misses"),
+                           "0", input, "" );
     CREATE_AND_ADD_TO_CAT( demuxed_stat, qtr("Demuxed data size"), "0", input, "KiB") ;
     CREATE_AND_ADD_TO_CAT( stream_bitrate_stat, qtr("Content bitrate"),
                            "0", input, "kb/s" );
@@ -526,6 +530,12 @@ InputStatsPanel::InputStatsPanel( QWidget *parent,
                            "0", input, "" );
     CREATE_AND_ADD_TO_CAT( discontinuity_stat, qtr("Dropped (discontinued)"),
                            "0", input, "" );
+    CREATE_AND_ADD_TO_CAT( clock_drift_stat, qtr("Clock drift"),
+                           "0", input, "ms" );
+    CREATE_AND_ADD_TO_CAT( clock_jitter_stat, qtr("Clock jitter"),
+                           "0", input, "ms" );
+    CREATE_AND_ADD_TO_CAT( clock_buffering_stat, qtr("Buffering margin"),
+                           "0", input, "ms" );
 
     CREATE_AND_ADD_TO_CAT( vdecoded_stat, qtr("Decoded"),
                            "0", video, qtr("blocks") );
@@ -577,10 +587,15 @@ void InputStatsPanel::update( input_item_t *p_item )
 
     UPDATE_INT( read_media_stat, (p_item->p_stats->i_read_bytes / 1024 ) );
     UPDATE_FLOAT( input_bitrate_stat,  "%6.0f", (float)(p_item->p_stats->f_input_bitrate *  8000  ));
+    UPDATE_INT( cache_hits_stat,   p_item->p_stats->i_read_cache_hits );
+    UPDATE_INT( cache_misses_stat, p_item->p_stats->i_read_cache_misses );
     UPDATE_INT( demuxed_stat,    (p_item->p_stats->i_demux_read_bytes / 1024 ) );
     UPDATE_FLOAT( stream_bitrate_stat, "%6.0f", (float)(p_item->p_stats->f_demux_bitrate *  8000  ));
     UPDATE_INT( corrupted_stat,      p_item->p_stats->i_demux_corrupted );
     UPDATE_INT( discontinuity_stat,  p_item->p_stats->i_demux_discontinuity );
+    UPDATE_FLOAT( clock_drift_stat,     "%6.1f", (float)p_item->p_stats->i_clock_drift / 1000 );
+    UPDATE_FLOAT( clock_jitter_stat,    "%6.1f", (float)p_item->p_stats->i_clock_jitter / 1000 );
+    UPDATE_FLOAT( clock_buffering_stat, "%6.1f", (float)p_item->p_stats->i_clock_buffering / 1000 );
 
     /* Video */
     UPDATE_INT( vdecoded_stat,     p_item->p_stats->i_decoded_video );
@@ -125,10 +125,15 @@ private:
     QTreeWidgetItem *input;
     QTreeWidgetItem *read_media_stat;
     QTreeWidgetItem *input_bitrate_stat;
+    QTreeWidgetItem *cache_hits_stat;
+    QTreeWidgetItem *cache_misses_stat;
     QTreeWidgetItem *demuxed_stat;
     QTreeWidgetItem *stream_bitrate_stat;
     QTreeWidgetItem *corrupted_stat;
     QTreeWidgetItem *discontinuity_stat;
+    QTreeWidgetItem *clock_drift_stat;
+    QTreeWidgetItem *clock_jitter_stat;
+    QTreeWidgetItem *clock_buffering_stat;
 
     QTreeWidgetItem *video;
     QTreeWidgetItem *vdecoded_stat;
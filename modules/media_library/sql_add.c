@@ -27,6 +27,98 @@
 
 #include "sql_media_library.h"
 
+/*****************************************************************************
+ * PREPARED STATEMENTS
+ *****************************************************************************/
+
+static const char *ppsz_statements[ ML_STMT_COUNT ] =
+{
+    [ML_STMT_INSERT_MEDIA] =
+        "INSERT INTO media ( uri, title, original_title, genre, type, "
+        "comment, cover, preview, year, track, disc, album_id, vote, score, "
+        "duration, first_played, played_count, last_played, "
+        "skipped_count, last_skipped, import_time, filesize ) "
+        "VALUES ( ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, "
+        "?, ?, ? )",
+    [ML_STMT_INSERT_MEDIA_PEOPLE] =
+        "INSERT INTO media_to_people ( media_id, people_id ) VALUES ( ?, ? )",
+    [ML_STMT_INSERT_EXTRA] =
+        "INSERT INTO extra ( id, extra, language, bitrate, samplerate, bpm ) "
+        "VALUES ( ?, ?, ?, ?, ?, ? )",
+    [ML_STMT_MEDIA_ID_OF_URI] =
+        "SELECT id FROM media WHERE uri = ? LIMIT 1",
+    [ML_STMT_SET_MEDIA_DIRECTORY] =
+        "UPDATE media SET directory_id = ?, timestamp = ? WHERE uri = ?",
+};
+
+/**
+ * @brief Get a prepared statement, preparing it on first use
+ * @param p_ml This media_library_t object
+ * @param i_stmt The statement
+ * @return The statement or NULL on error
+ * @note The statements are shared: they must only be used within a
+ * transaction, and be reset before it ends.
+ */
+sql_stmt_t *GetStatement( media_library_t *p_ml, ml_statement_e i_stmt )
+{
+    sql_stmt_t **pp_stmt = &p_ml->p_sys->pp_stmts[i_stmt];
+
+    if( *pp_stmt == NULL )
+        *pp_stmt = sql_Prepare( p_ml->p_sys->p_sql,
+                                ppsz_statements[i_stmt], -1 );
+    return *pp_stmt;
+}
+
+/**
+ * @brief Destroy the prepared statements
+ * @param p_ml This media_library_t object
+ */
+void FinalizeStatements( media_library_t *p_ml )
+{
+    for( int i = 0; i < ML_STMT_COUNT; i++ )
+    {
+        if( p_ml->p_sys->pp_stmts[i] )
+            sql_Finalize( p_ml->p_sys->p_sql, p_ml->p_sys->pp_stmts[i] );
+        p_ml->p_sys->pp_stmts[i] = NULL;
+    }
+}
+
+/**
+ * @brief Run a prepared statement returning no row, and reset it
+ * @param p_ml This media_library_t object
+ * @param p_stmt The statement, with its values bound
+ * @return VLC_SUCCESS or VLC_EGENERIC
+ */
+int RunStatement( media_library_t *p_ml, sql_stmt_t *p_stmt )
+{
+    int i_ret = sql_Run( p_ml->p_sys->p_sql, p_stmt ) == VLC_SQL_DONE
+              ? VLC_SUCCESS : VLC_EGENERIC;
+    sql_Reset( p_ml->p_sys->p_sql, p_stmt );
+    return i_ret;
+}
+
+/**
+ * @brief Get the ID of the media with the given URI, within a transaction
+ * @param p_ml This media_library_t object
+ * @param psz_uri URI to look for
+ * @return The ID, or VLC_EGENERIC
+ */
+static int GetMediaIdOfURIPrepared( media_library_t *p_ml, char *psz_uri )
+{
+    sql_t *p_sql = p_ml->p_sys->p_sql;
+    sql_stmt_t *p_stmt = GetStatement( p_ml, ML_STMT_MEDIA_ID_OF_URI );
+    int i_id = VLC_EGENERIC;
+
+    if( !p_stmt )
+        return VLC_EGENERIC;
+    if( sql_BindText( p_sql, p_stmt, 1, psz_uri, -1 ) == VLC_SUCCESS
+     && sql_Run( p_sql, p_stmt ) == VLC_SQL_ROW
+     && sql_GetColumnInteger( p_sql, p_stmt, 0, &i_id ) != VLC_SUCCESS )
+        i_id = VLC_EGENERIC;
+    sql_Reset( p_sql, p_stmt );
+    return i_id;
+}
+
 /*****************************************************************************
  * ADD FUNCTIONS
  *****************************************************************************/
@@ -40,10 +132,14 @@
  */
 int AddMedia( media_library_t *p_ml, ml_media_t *p_media )
 {
+    sql_t *p_sql = p_ml->p_sys->p_sql;
+    sql_stmt_t *p_stmt;
     int i_ret = VLC_SUCCESS;
     int i_album_artist = 0;
+    int id = 0;
 
-    Begin( p_ml );
+    if( Begin( p_ml ) != VLC_SUCCESS )
+        return VLC_EGENERIC;
     ml_LockMedia( p_media );
     assert( p_media->i_id == 0 );
     /* Add any people */
@@ -86,10 +182,13 @@ int AddMedia( media_library_t *p_ml, ml_media_t *p_media )
                 i_ret = AddAlbum( p_ml, p_media->psz_album, p_media->psz_cover,
                                     i_album_artist );
                 if( i_ret != VLC_SUCCESS )
-                    return i_ret;
+                    goto quit_addmedia;
                 i_album_id = ml_GetAlbumId( p_ml, p_media->psz_album );
                 if( i_album_id <= 0 )
-                    return i_ret;
+                {
+                    i_ret = VLC_EGENERIC;
+                    goto quit_addmedia;
+                }
             }
             p_media->i_album_id = i_album_id;
         }
@@ -99,42 +198,43 @@ int AddMedia( media_library_t *p_ml, ml_media_t *p_media )
     if( !p_media->psz_uri || !*p_media->psz_uri )
     {
         msg_Dbg( p_ml, "cannot add a media without uri (%s)", __func__ );
-        return VLC_EGENERIC;
+        i_ret = VLC_EGENERIC;
+        goto quit_addmedia;
     }
 
-    i_ret = QuerySimple( p_ml,
-            "INSERT INTO media ( uri, title, original_title, genre, type, "
-            "comment, cover, preview, year, track, disc, album_id, vote, score, "
-            "duration, first_played, played_count, last_played, "
-            "skipped_count, last_skipped, import_time, filesize ) "
-            "VALUES ( %Q, %Q, %Q, %Q, '%d',%Q, %Q, %Q, '%d', '%d', '%d', '%d',"
-            "'%d', '%d', '%d', '%d', '%d', '%d', '%d', '%d', '%d', '%d' )",
-                p_media->psz_uri,
-                p_media->psz_title,
-                p_media->psz_orig_title,
-                p_media->psz_genre,
-                (int)p_media->i_type,
-                p_media->psz_comment,
-                p_media->psz_cover,
-                p_media->psz_preview,
-                (int)p_media->i_year,
-                (int)p_media->i_track_number,
-                (int)p_media->i_disc_number,
-                (int)p_media->i_album_id,
-                (int)p_media->i_vote,
-                (int)p_media->i_score,
-                (int)p_media->i_duration,
-                (int)p_media->i_first_played,
-                (int)p_media->i_played_count,
-                (int)p_media->i_last_played,
-                (int)p_media->i_skipped_count,
-                (int)p_media->i_last_skipped,
-                (int)p_media->i_import_time,
-                (int)p_media->i_filesize );
+    p_stmt = GetStatement( p_ml, ML_STMT_INSERT_MEDIA );
+    if( !p_stmt )
+    {
+        i_ret = VLC_EGENERIC;
+        goto quit_addmedia;
+    }
+    sql_BindText( p_sql, p_stmt, 1, p_media->psz_uri, -1 );
+    sql_BindText( p_sql, p_stmt, 2, p_media->psz_title, -1 );
+    sql_BindText( p_sql, p_stmt, 3, p_media->psz_orig_title, -1 );
+    sql_BindText( p_sql, p_stmt, 4, p_media->psz_genre, -1 );
+    sql_BindInteger( p_sql, p_stmt, 5, (int)p_media->i_type );
+    sql_BindText( p_sql, p_stmt, 6, p_media->psz_comment, -1 );
+    sql_BindText( p_sql, p_stmt, 7, p_media->psz_cover, -1 );
+    sql_BindText( p_sql, p_stmt, 8, p_media->psz_preview, -1 );
+    sql_BindInteger( p_sql, p_stmt, 9, (int)p_media->i_year );
+    sql_BindInteger( p_sql, p_stmt, 10, (int)p_media->i_track_number );
+    sql_BindInteger( p_sql, p_stmt, 11, (int)p_media->i_disc_number );
+    sql_BindInteger( p_sql, p_stmt, 12, (int)p_media->i_album_id );
+    sql_BindInteger( p_sql, p_stmt, 13, (int)p_media->i_vote );
+    sql_BindInteger( p_sql, p_stmt, 14, (int)p_media->i_score );
+    sql_BindInteger( p_sql, p_stmt, 15, (int)p_media->i_duration );
+    sql_BindInteger( p_sql, p_stmt, 16, (int)p_media->i_first_played );
+    sql_BindInteger( p_sql, p_stmt, 17, (int)p_media->i_played_count );
+    sql_BindInteger( p_sql, p_stmt, 18, (int)p_media->i_last_played );
+    sql_BindInteger( p_sql, p_stmt, 19, (int)p_media->i_skipped_count );
+    sql_BindInteger( p_sql, p_stmt, 20, (int)p_media->i_last_skipped );
+    sql_BindInteger( p_sql, p_stmt, 21, (int)p_media->i_import_time );
+    sql_BindInteger( p_sql, p_stmt, 22, (int)p_media->i_filesize );
+    i_ret = RunStatement( p_ml, p_stmt );
     if( i_ret != VLC_SUCCESS )
         goto quit_addmedia;
 
-    int id = GetMediaIdOfURI( p_ml, p_media->psz_uri );
+    id = GetMediaIdOfURIPrepared( p_ml, p_media->psz_uri );
     if( id <= 0 )
     {
         i_ret = VLC_EGENERIC;
@@ -142,31 +242,39 @@ int AddMedia( media_library_t *p_ml, ml_media_t *p_media )
     }
 
     p_media->i_id = id;
+    p_stmt = GetStatement( p_ml, ML_STMT_INSERT_MEDIA_PEOPLE );
+    if( !p_stmt )
+    {
+        i_ret = VLC_EGENERIC;
+        goto quit_addmedia;
+    }
     person = p_media->p_people;
-    if( !person )
+    do
     {
         /* If there is no person, set it to "Unknown", ie. people_id=0 */
-        i_ret = QuerySimple( p_ml, "INSERT into media_to_people ( media_id, "
-                                     "people_id ) VALUES ( %d, %d )",
-                                     id, 0 );
+        sql_BindInteger( p_sql, p_stmt, 1, id );
+        sql_BindInteger( p_sql, p_stmt, 2, person ? person->i_id : 0 );
+        i_ret = RunStatement( p_ml, p_stmt );
         if( i_ret != VLC_SUCCESS )
             goto quit_addmedia;
-    } else {
-        while( person )
-        {
-            i_ret = QuerySimple( p_ml, "INSERT into media_to_people ( media_id, "
-                                         "people_id ) VALUES ( %d, %d )",
-                                         id, person->i_id );
-            if( i_ret != VLC_SUCCESS )
-                goto quit_addmedia;
+        if( person )
             person = person->p_next;
-        }
     }
+    while( person );
 
-    i_ret = QuerySimple( p_ml, "INSERT into extra ( id, extra, language, bitrate, "
-            "samplerate, bpm ) VALUES ( '%d', %Q, %Q, '%d', '%d', '%d' )",
-            id, p_media->psz_extra, p_media->psz_language,
-            p_media->i_bitrate, p_media->i_samplerate, p_media->i_bpm );
+    p_stmt = GetStatement( p_ml, ML_STMT_INSERT_EXTRA );
+    if( !p_stmt )
+    {
+        i_ret = VLC_EGENERIC;
+        goto quit_addmedia;
+    }
+    sql_BindInteger( p_sql, p_stmt, 1, id );
+    sql_BindText( p_sql, p_stmt, 2, p_media->psz_extra, -1 );
+    sql_BindText( p_sql, p_stmt, 3, p_media->psz_language, -1 );
+    sql_BindInteger( p_sql, p_stmt, 4, p_media->i_bitrate );
+    sql_BindInteger( p_sql, p_stmt, 5, p_media->i_samplerate );
+    sql_BindInteger( p_sql, p_stmt, 6, p_media->i_bpm );
+    i_ret = RunStatement( p_ml, p_stmt );
     if( i_ret != VLC_SUCCESS )
         goto quit_addmedia;
     i_ret = pool_InsertMedia( p_ml, p_media, true );
@@ -179,10 +179,20 @@ static int load( vlc_object_t *obj )
 
     p_mon->p_ml = p_ml;
 
+    if( InitMonitorQueue( p_mon ) )
+    {
+        vlc_mutex_destroy( &p_ml->p_sys->lock );
+        sql_Destroy( p_ml->p_sys->p_sql );
+        free( p_ml->p_sys );
+        vlc_object_release( p_mon );
+        return VLC_EGENERIC;
+    }
+
     if( vlc_clone( &p_mon->thread, RunMonitoringThread, p_mon,
                 VLC_THREAD_PRIORITY_LOW ) )
     {
         msg_Err( p_ml, "cannot spawn the media library monitoring thread" );
+        CloseMonitorQueue( p_mon );
         vlc_mutex_destroy( &p_ml->p_sys->lock );
         sql_Destroy( p_ml->p_sys->p_sql );
         free( p_ml->p_sys );
@@ -208,14 +218,16 @@ static void unload( vlc_object_t *obj )
 {
     media_library_t *p_ml = ( media_library_t* ) obj;
 
-    /* Stopping the watching system */
-    watch_Close( p_ml );
-
     /* Stop the monitoring thread */
     vlc_cancel( p_ml->p_sys->p_mon->thread );
     vlc_join( p_ml->p_sys->p_mon->thread, NULL );
+    /* The last scanned items are watched once added */
+    CloseMonitorQueue( p_ml->p_sys->p_mon );
     vlc_object_release( p_ml->p_sys->p_mon );
 
+    /* Stopping the watching system */
+    watch_Close( p_ml );
+
     /* Destroy the variable */
     var_Destroy( p_ml, "media-meta-change" );
     var_Destroy( p_ml, "media-deleted" );
@@ -228,6 +240,7 @@ static void unload( vlc_object_t *obj )
     FOREACH_END()
     vlc_mutex_destroy( &p_ml->p_sys->pool_mutex );
 
+    FinalizeStatements( p_ml );
     sql_Destroy( p_ml->p_sys->p_sql );
 
     vlc_mutex_destroy( &p_ml->p_sys->lock );
@@ -67,12 +67,26 @@
 #define ITEM_LOOP_MAX_AGE   10  /* An item is deleted after 10 loops */
 #define ML_DBVERSION         1  /* The current version of the database */
 #define ML_MEDIAPOOL_HASH_LENGTH 100 /* The length of the media pool hash */
+#define ML_INGEST_BATCH    100  /* Scanned items added per transaction */
+#define ML_INGEST_DELAY      2  /* Delay before adding an incomplete batch */
 
 /*****************************************************************************
  * Structures and types definitions
  *****************************************************************************/
 typedef struct monitoring_thread_t monitoring_thread_t;
 typedef struct ml_poolobject_t     ml_poolobject_t;
+typedef struct preparsed_item_t    preparsed_item_t;
+
+/* Statements prepared once, and used within transactions only */
+typedef enum
+{
+    ML_STMT_INSERT_MEDIA,
+    ML_STMT_INSERT_MEDIA_PEOPLE,
+    ML_STMT_INSERT_EXTRA,
+    ML_STMT_MEDIA_ID_OF_URI,
+    ML_STMT_SET_MEDIA_DIRECTORY,
+    ML_STMT_COUNT
+} ml_statement_e;
 
 struct ml_poolobject_t
 {
@@ -87,6 +101,7 @@ struct media_library_sys_t
 
     /* SQL object */
     sql_t *p_sql;
+    sql_stmt_t *pp_stmts[ ML_STMT_COUNT ];
 
     /* Monitoring thread */
     monitoring_thread_t *p_mon;
@@ -113,6 +128,12 @@ struct monitoring_thread_t
     vlc_mutex_t lock;
     vlc_thread_t thread;
     media_library_t *p_ml;
+
+    /* Preparsed items, waiting to be added in one transaction */
+    preparsed_item_t **pp_queue;
+    int i_queue;
+    vlc_mutex_t queue_lock;
+    vlc_timer_t queue_timer;
 };
 
 /* Media status Watching thread */
@@ -160,6 +181,12 @@ int AddPlaylistItem( media_library_t *p_ml,
 int AddInputItem( media_library_t *p_ml,
                   input_item_t *p_input );
 
+/* Prepared statements */
+sql_stmt_t *GetStatement( media_library_t *p_ml,
+                          ml_statement_e i_stmt );
+void FinalizeStatements( media_library_t *p_ml );
+int RunStatement( media_library_t *p_ml, sql_stmt_t *p_stmt );
+
 /* Create and Copy functions */
 ml_media_t* GetMedia( media_library_t* p_ml, int id,
                         ml_select_e select, bool reload );
@@ -265,7 +292,8 @@ int SQLToResultArray( media_library_t *p_ml,
  * @param p_ml The Media Library object
  * @return VLC_SUCCESS and VLC_EGENERIC
  * @note This creates a SHARED lock in SQLITE. All queries made between
- * a Begin and Commit/Rollback will be transactional.
+ * a Begin and Commit/Rollback will be transactional. A transaction begun
+ * within another one can be rolled back alone.
  */
 static inline int Begin( media_library_t* p_ml )
 {
@@ -275,10 +303,11 @@ static inline int Begin( media_library_t* p_ml )
 /**
  * @brief Commits the transaction
  * @param p_ml The Media Library object
+ * @return VLC_SUCCESS and VLC_EGENERIC
  */
-static inline void Commit( media_library_t* p_ml )
+static inline int Commit( media_library_t* p_ml )
 {
-    sql_CommitTransaction( p_ml->p_sys->p_sql );
+    return sql_CommitTransaction( p_ml->p_sys->p_sql );
 }
 
 /**
@@ -294,6 +323,8 @@ static inline void Rollback( media_library_t* p_ml )
  * Scanning/monitoring functions
  *****************************************************************************/
 void *RunMonitoringThread( void *p_mon );
+int InitMonitorQueue( monitoring_thread_t *p_mon );
+void CloseMonitorQueue( monitoring_thread_t *p_mon );
 int AddDirToMonitor( media_library_t *p_ml,
                      const char *psz_dir );
 int ListMonitoredDirs( media_library_t *p_ml,
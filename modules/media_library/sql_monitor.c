@@ -43,7 +43,6 @@ static const char* ppsz_MediaExtensions[] =
 
 /* Monitoring and directory scanning private functions */
 typedef struct stat_list_t stat_list_t;
-typedef struct preparsed_item_t preparsed_item_t;
 static void UpdateLibrary( monitoring_thread_t *p_mon );
 static void ScanFiles( monitoring_thread_t *, int, bool, stat_list_t *stparent );
 static int Sort( const char **, const char ** );
@@ -58,6 +57,7 @@ struct stat_list_t
 struct preparsed_item_t
 {
     monitoring_thread_t *p_mon;
+    input_item_t *p_input;
     char* psz_uri;
     int i_dir_id;
     int i_mtime;
@@ -289,15 +289,17 @@ static void UpdateLibrary( monitoring_thread_t *p_mon )
 }
 
 /**
- * @brief Callback for input item preparser to directory monitor
+ * @brief Add or update a preparsed item in the database
  */
-static void PreparseComplete( const vlc_event_t * p_event, void *p_data )
+static void AddPreparsedItem( monitoring_thread_t *p_mon,
+                              preparsed_item_t *p_itemobject )
 {
     int i_ret = VLC_SUCCESS;
-    preparsed_item_t* p_itemobject = (preparsed_item_t*) p_data;
-    monitoring_thread_t *p_mon = p_itemobject->p_mon;
     media_library_t *p_ml = (media_library_t *)p_mon->p_ml;
-    input_item_t *p_input = (input_item_t*) p_event->p_obj;
+    input_item_t *p_input = p_itemobject->p_input;
+
+    if( Begin( p_ml ) != VLC_SUCCESS )
+        return;
 
     if( input_item_IsPreparsed( p_input ) )
     {
@@ -317,14 +319,105 @@ static void PreparseComplete( const vlc_event_t * p_event, void *p_data )
     if( i_ret != VLC_SUCCESS )
         msg_Dbg( p_mon, "Item could not be correctly added"
                 " or updated during scan: %s", p_input->psz_uri );
-    QuerySimple( p_ml, "UPDATE media SET directory_id=%d, timestamp=%d "
-                          "WHERE id=%d",
-                    p_itemobject->i_dir_id, p_itemobject->i_mtime,
-                    GetMediaIdOfURI( p_ml, p_input->psz_uri ) );
+
+    sql_stmt_t *p_stmt = GetStatement( p_ml, ML_STMT_SET_MEDIA_DIRECTORY );
+    if( p_stmt )
+    {
+        sql_t *p_sql = p_ml->p_sys->p_sql;
+        sql_BindInteger( p_sql, p_stmt, 1, p_itemobject->i_dir_id );
+        sql_BindInteger( p_sql, p_stmt, 2, p_itemobject->i_mtime );
+        sql_BindText( p_sql, p_stmt, 3, p_input->psz_uri, -1 );
+        RunStatement( p_ml, p_stmt );
+    }
+    Commit( p_ml );
+}
+
+/**
+ * @brief Add the queued preparsed items, in a single transaction
+ */
+static void FlushPreparsedItems( void *p_data )
+{
+    monitoring_thread_t *p_mon = p_data;
+    media_library_t *p_ml = (media_library_t *)p_mon->p_ml;
+    preparsed_item_t **pp_items;
+    int i_items;
+
+    vlc_mutex_lock( &p_mon->queue_lock );
+    pp_items = p_mon->pp_queue;
+    i_items = p_mon->i_queue;
+    TAB_INIT( p_mon->i_queue, p_mon->pp_queue );
+    vlc_mutex_unlock( &p_mon->queue_lock );
+
+    if( i_items == 0 )
+        return;
+
+    /* Each item is added in a transaction of its own, nested in the batch
+     * one if it could be begun, so that a failed item does not cancel the
+     * others */
+    bool b_batch = Begin( p_ml ) == VLC_SUCCESS;
+    for( int i = 0; i < i_items; i++ )
+    {
+        preparsed_item_t *p_itemobject = pp_items[i];
+
+        AddPreparsedItem( p_mon, p_itemobject );
+        vlc_gc_decref( p_itemobject->p_input );
+        free( p_itemobject->psz_uri );
+        free( p_itemobject );
+    }
+    if( b_batch && Commit( p_ml ) != VLC_SUCCESS )
+        Rollback( p_ml );
+    free( pp_items );
+
+    msg_Dbg( p_mon, "%d scanned items added", i_items );
+}
+
+/**
+ * @brief Callback for input item preparser to directory monitor
+ */
+static void PreparseComplete( const vlc_event_t * p_event, void *p_data )
+{
+    preparsed_item_t* p_itemobject = (preparsed_item_t*) p_data;
+    monitoring_thread_t *p_mon = p_itemobject->p_mon;
+    input_item_t *p_input = (input_item_t*) p_event->p_obj;
+
     vlc_event_detach( &p_input->event_manager, vlc_InputItemPreparsedChanged,
                   PreparseComplete, p_itemobject );
-    vlc_gc_decref( p_input );
-    free( p_itemobject->psz_uri );
+
+    /* The reference of the scan is kept until the item is added */
+    p_itemobject->p_input = p_input;
+
+    vlc_mutex_lock( &p_mon->queue_lock );
+    TAB_APPEND( p_mon->i_queue, p_mon->pp_queue, p_itemobject );
+    const bool b_full = p_mon->i_queue >= ML_INGEST_BATCH;
+    if( p_mon->i_queue == 1 )
+        vlc_timer_schedule( p_mon->queue_timer, false,
+                            ML_INGEST_DELAY * CLOCK_FREQ, 0 );
+    vlc_mutex_unlock( &p_mon->queue_lock );
+
+    if( b_full )
+        FlushPreparsedItems( p_mon );
+}
+
+/**
+ * @brief Initialize the queue of the preparsed items
+ */
+int InitMonitorQueue( monitoring_thread_t *p_mon )
+{
+    if( vlc_timer_create( &p_mon->queue_timer, FlushPreparsedItems, p_mon ) )
+        return VLC_EGENERIC;
+    vlc_mutex_init( &p_mon->queue_lock );
+    TAB_INIT( p_mon->i_queue, p_mon->pp_queue );
+    return VLC_SUCCESS;
+}
+
+/**
+ * @brief Add the items still queued, and destroy the queue
+ */
+void CloseMonitorQueue( monitoring_thread_t *p_mon )
+{
+    vlc_timer_destroy( p_mon->queue_timer );
+    FlushPreparsedItems( p_mon );
+    vlc_mutex_destroy( &p_mon->queue_lock );
 }
 
 /**
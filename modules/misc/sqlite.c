@@ -46,6 +46,7 @@ struct sql_sys_t
     sqlite3 *db;              /**< Database connection. */
     vlc_mutex_t lock;         /**< SQLite mutex. Threads are evil here. */
     vlc_mutex_t trans_lock;   /**< Mutex for running transactions */
+    unsigned i_trans_depth;   /**< Nesting level of the transaction */
 };
 
 struct sql_stmt_t
@@ -134,7 +135,7 @@ static int load( vlc_object_t *p_this )
         return VLC_ENOMEM;
 
     vlc_mutex_init( &p_sql->p_sys->lock );
-    vlc_mutex_init( &p_sql->p_sys->trans_lock );
+    vlc_mutex_init_recursive( &p_sql->p_sys->trans_lock );
 
     /* Open Database */
     if( OpenDatabase( p_sql ) == VLC_SUCCESS )
@@ -401,6 +402,8 @@ static char* VMSprintf( const char* psz_fmt, va_list args )
  * @note This function locks the transactions on the database.
  * Within the period of the transaction, only the calling thread may
  * execute sql statements provided all threads use these transaction fns.
+ * A transaction started by the thread already in a transaction is nested in
+ * it, as a savepoint.
  */
 static int BeginTransaction( sql_t* p_sql )
 {
@@ -409,19 +412,22 @@ static int BeginTransaction( sql_t* p_sql )
     vlc_mutex_lock( &p_sql->p_sys->lock );
     assert( p_sql->p_sys->db );
 
-    sqlite3_exec( p_sql->p_sys->db, "BEGIN;", NULL, NULL, NULL );
+    const char *psz_query = p_sql->p_sys->i_trans_depth == 0
+                          ? "BEGIN;" : "SAVEPOINT nested;";
+    sqlite3_exec( p_sql->p_sys->db, psz_query, NULL, NULL, NULL );
 #ifndef NDEBUG
-    msg_Dbg( p_sql, "Transaction Query: BEGIN;" );
+    msg_Dbg( p_sql, "Transaction Query: %s", psz_query );
 #endif
     if( sqlite3_errcode( p_sql->p_sys->db ) != SQLITE_OK )
     {
-        vlc_mutex_unlock( &p_sql->p_sys->trans_lock );
-        vlc_mutex_unlock( &p_sql->p_sys->lock );
         msg_Warn( p_sql, "sqlite3 error: %d: %s",
                   sqlite3_errcode( p_sql->p_sys->db ),
                   sqlite3_errmsg( p_sql->p_sys->db ) );
+        vlc_mutex_unlock( &p_sql->p_sys->trans_lock );
         i_ret = VLC_EGENERIC;
     }
+    else
+        p_sql->p_sys->i_trans_depth++;
     vlc_mutex_unlock( &p_sql->p_sys->lock );
     return i_ret;
 }
@@ -433,18 +439,22 @@ static int BeginTransaction( sql_t* p_sql )
  * Only the calling thread of "BeginTransaction" is allowed to call this method
  * If the commit fails, the transaction lock is still held by the thread
  * and this function may be retried or RollbackTransaction can be called
+ * A nested transaction is only committed with the outermost one.
  * @return VLC_SUCCESS or VLC_EGENERIC
  */
 static int CommitTransaction( sql_t* p_sql )
 {
     int i_ret = VLC_SUCCESS;
     assert( p_sql->p_sys->db );
+    assert( p_sql->p_sys->i_trans_depth > 0 );
     vlc_mutex_lock( &p_sql->p_sys->lock );
 
     /** This turns the auto commit on. */
-    sqlite3_exec( p_sql->p_sys->db, "COMMIT;", NULL, NULL, NULL );
+    const char *psz_query = p_sql->p_sys->i_trans_depth == 1
+                          ? "COMMIT;" : "RELEASE nested;";
+    sqlite3_exec( p_sql->p_sys->db, psz_query, NULL, NULL, NULL );
 #ifndef NDEBUG
-    msg_Dbg( p_sql, "Transaction Query: COMMIT;" );
+    msg_Dbg( p_sql, "Transaction Query: %s", psz_query );
 #endif
     if( sqlite3_errcode( p_sql->p_sys->db ) != SQLITE_OK )
     {
@@ -454,7 +464,10 @@ static int CommitTransaction( sql_t* p_sql )
         i_ret = VLC_EGENERIC;
     }
     else
+    {
+        p_sql->p_sys->i_trans_depth--;
         vlc_mutex_unlock( &p_sql->p_sys->trans_lock );
+    }
     vlc_mutex_unlock( &p_sql->p_sys->lock );
     return i_ret;
 }
@@ -469,15 +482,20 @@ static int CommitTransaction( sql_t* p_sql )
  * the transaction was automatically rolled back
  * If failed otherwise, the engine is busy executing some queries and you must
  * try again
+ * A nested transaction is rolled back alone.
  */
 static void RollbackTransaction( sql_t* p_sql )
 {
     assert( p_sql->p_sys->db );
+    assert( p_sql->p_sys->i_trans_depth > 0 );
     vlc_mutex_lock( &p_sql->p_sys->lock );
 
-    sqlite3_exec( p_sql->p_sys->db, "ROLLBACK;", NULL, NULL, NULL );
+    const char *psz_query = p_sql->p_sys->i_trans_depth == 1
+                          ? "ROLLBACK;"
+                          : "ROLLBACK TO nested; RELEASE nested;";
+    sqlite3_exec( p_sql->p_sys->db, psz_query, NULL, NULL, NULL );
 #ifndef NDEBUG
-    msg_Dbg( p_sql, "Transaction Query: ROLLBACK;" );
+    msg_Dbg( p_sql, "Transaction Query: %s", psz_query );
 #endif
     if( sqlite3_errcode( p_sql->p_sys->db ) != SQLITE_OK )
     {
@@ -485,6 +503,7 @@ static void RollbackTransaction( sql_t* p_sql )
                   sqlite3_errcode( p_sql->p_sys->db ),
                   sqlite3_errmsg( p_sql->p_sys->db ) );
     }
+    p_sql->p_sys->i_trans_depth--;
     vlc_mutex_unlock( &p_sql->p_sys->trans_lock );
     vlc_mutex_unlock( &p_sql->p_sys->lock );
 }
@@ -584,7 +603,7 @@ static int StatementStep( sql_t* p_sql, sql_stmt_t* p_stmt )
     int i_ret = VLC_EGENERIC;
     if( i_sqlret == SQLITE_ROW )
         i_ret = VLC_SQL_ROW;
-    else if( i_ret == SQLITE_DONE )
+    else if( i_sqlret == SQLITE_DONE )
         i_ret = VLC_SQL_DONE;
     else
     {
@@ -610,6 +629,7 @@ static int StatementReset( sql_t* p_sql, sql_stmt_t* p_stmt )
     assert( p_stmt->p_sqlitestmt );
     int i_ret = VLC_SUCCESS;
     vlc_mutex_lock( &p_sql->p_sys->lock );
+    sqlite3_clear_bindings( p_stmt->p_sqlitestmt );
     if( sqlite3_reset( p_stmt->p_sqlitestmt ) != SQLITE_OK )
     {
         msg_Warn( p_sql, "sqlite3 error: %d: %s",
@@ -0,0 +1,151 @@
+/*****************************************************************************
+ * startcode_helper.h: Fast 00 00 01 start code search
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_STARTCODE_HELPER_H_
+#define VLC_STARTCODE_HELPER_H_
+
+#include <vlc_cpu.h>
+
+#ifdef __ARM_NEON__
+# include <arm_neon.h>
+#endif
+
+/*
+ * A start code begins with a zero byte, and zero bytes are rare in
+ * compressed data. The search therefore only looks closely at the words
+ * (or vectors) that contain at least one zero byte.
+ *
+ * The search functions return the first 00 00 01 start code lying entirely
+ * in [p, end), or NULL if there is none.
+ */
+#define STARTCODE_AT( p, end ) \
+    ( (p) + 2 < (end) && (p)[0] == 0 && (p)[1] == 0 && (p)[2] == 1 )
+
+static inline const uint8_t *startcode_FindAnnexB_C( const uint8_t *p,
+                                                     const uint8_t *end )
+{
+    /* Align on 4 bytes */
+    for( ; ((uintptr_t)p & 3) && p < end; p++ )
+        if( STARTCODE_AT( p, end ) )
+            return p;
+
+    for( ; p + 4 <= end; p += 4 )
+    {
+        uint32_t x;
+        memcpy( &x, p, 4 );
+        if( !((x - 0x01010101) & ~x & 0x80808080) )
+            continue; /* No zero byte */
+
+        for( int i = 0; i < 4; i++ )
+            if( STARTCODE_AT( &p[i], end ) )
+                return &p[i];
+    }
+
+    for( ; p < end; p++ )
+        if( STARTCODE_AT( p, end ) )
+            return p;
+    return NULL;
+}
+
+#ifdef CAN_COMPILE_SSE2
+static inline const uint8_t *startcode_FindAnnexB_SSE2( const uint8_t *p,
+                                                        const uint8_t *end )
+{
+    /* Align on 16 bytes */
+    for( ; ((uintptr_t)p & 15) && p < end; p++ )
+        if( STARTCODE_AT( p, end ) )
+            return p;
+
+    for( ; p + 16 <= end; p += 16 )
+    {
+        unsigned i_zero;
+        asm volatile (
+            "pxor     %%xmm0, %%xmm0\n"
+            "pcmpeqb  (%[p]), %%xmm0\n"
+            "pmovmskb %%xmm0, %[zero]\n"
+            : [zero]"=r"(i_zero)
+            : [p]"r"(p), "m"(*(const uint8_t (*)[16])p)
+            : "xmm0" );
+
+        /* Candidates are two consecutive zero bytes, the last byte of the
+         * vector is checked against the next vector */
+        unsigned i_candidate = i_zero & ((i_zero >> 1) | 0x8000);
+        while( i_candidate )
+        {
+            const unsigned i = popcount( (i_candidate & -i_candidate) - 1 );
+            if( STARTCODE_AT( &p[i], end ) )
+                return &p[i];
+            i_candidate &= i_candidate - 1;
+        }
+    }
+
+    for( ; p < end; p++ )
+        if( STARTCODE_AT( p, end ) )
+            return p;
+    return NULL;
+}
+#endif
+
+#ifdef __ARM_NEON__
+static inline const uint8_t *startcode_FindAnnexB_NEON( const uint8_t *p,
+                                                        const uint8_t *end )
+{
+    for( ; p + 16 <= end; p += 16 )
+    {
+        const uint8x16_t zero = vceqq_u8( vld1q_u8( p ), vdupq_n_u8( 0 ) );
+        const uint64x2_t zero64 = vreinterpretq_u64_u8( zero );
+        if( !( vgetq_lane_u64( zero64, 0 ) | vgetq_lane_u64( zero64, 1 ) ) )
+            continue; /* No zero byte */
+
+        for( int i = 0; i < 16; i++ )
+            if( STARTCODE_AT( &p[i], end ) )
+                return &p[i];
+    }
+
+    for( ; p < end; p++ )
+        if( STARTCODE_AT( p, end ) )
+            return p;
+    return NULL;
+}
+#endif
+
+/**
+ * Finds the first 00 00 01 start code in [p, end), using the fastest
+ * implementation for the CPU.
+ *
+ * It can be given to block_FindStartcodeFromOffset() as helper, for start
+ * codes beginning with 00 00 01.
+ */
+static inline const uint8_t *startcode_FindAnnexB( const uint8_t *p,
+                                                   const uint8_t *end )
+{
+#if defined(CAN_COMPILE_SSE2)
+    if( vlc_CPU() & CPU_CAPABILITY_SSE2 )
+        return startcode_FindAnnexB_SSE2( p, end );
+#elif defined(__ARM_NEON__)
+    return startcode_FindAnnexB_NEON( p, end );
+#endif
+    return startcode_FindAnnexB_C( p, end );
+}
+
+#undef STARTCODE_AT
+
+#endif
@@ -0,0 +1,206 @@
+/*****************************************************************************
+ * memcpy.c : SSE2 streaming memcpy module
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*
+ * Small copies are left to the C library, which is hard to beat on any
+ * recent CPU. Copies larger than the last level cache would only evict
+ * useful data (the destination picture is hardly ever read back by the
+ * CPU before it is displayed), so they are done with non-temporal stores
+ * that bypass the cache hierarchy.
+ *
+ * Whether non-temporal stores actually pay off depends on the memory
+ * subsystem, so both strategies are timed once when the module is loaded.
+ * The benchmark would cost too much time and memory with large caches:
+ * streaming copies are then used above the cache size without timing.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_cpu.h>
+
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int Activate( vlc_object_t * );
+
+#define THRESHOLD_TEXT N_("Streaming copy threshold")
+#define THRESHOLD_LONGTEXT N_( \
+    "Copies of at least this many kilobytes bypass the CPU caches. " \
+    "0 means to use the size of the last level cache, -1 means to " \
+    "benchmark at startup whether streaming copies are worth it " \
+    "(with small caches only).")
+
+vlc_module_begin ()
+    set_category( CAT_ADVANCED )
+    set_subcategory( SUBCAT_ADVANCED_MISC )
+    set_description( N_("SSE2 memcpy") )
+    add_shortcut( "sse2", "memcpysse2" )
+    add_integer( "memcpy-sse2-threshold", -1, THRESHOLD_TEXT,
+                 THRESHOLD_LONGTEXT, true )
+    set_capability( "memcpy", 300 )
+    set_callbacks( Activate, NULL )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Local prototypes
+ *****************************************************************************/
+/* Minimum size for non-temporal copies, SIZE_MAX disables them */
+static size_t stream_threshold = SIZE_MAX;
+
+/* Copy with non-temporal stores, the destination must be 16-bytes aligned
+ * and size a multiple of 64 */
+static void StreamCopy( uint8_t *dst, const uint8_t *src, size_t size )
+{
+    for( size_t i = 0; i < size; i += 64 )
+    {
+        asm volatile (
+            "prefetchnta 256(%1)\n"
+            "movdqu    0(%1), %%xmm0\n"
+            "movdqu   16(%1), %%xmm1\n"
+            "movdqu   32(%1), %%xmm2\n"
+            "movdqu   48(%1), %%xmm3\n"
+            "movntdq  %%xmm0,  0(%0)\n"
+            "movntdq  %%xmm1, 16(%0)\n"
+            "movntdq  %%xmm2, 32(%0)\n"
+            "movntdq  %%xmm3, 48(%0)\n"
+            :
+            : "r"(&dst[i]), "r"(&src[i])
+            : "memory", "xmm0", "xmm1", "xmm2", "xmm3" );
+    }
+    asm volatile ( "sfence" ::: "memory" );
+}
+
+static void *sse2_memcpy( void *to, const void *from, size_t len )
+{
+    if( len < stream_threshold || len < 64 )
+        return memcpy( to, from, len );
+
+    uint8_t *dst = to;
+    const uint8_t *src = from;
+
+    /* Align the destination */
+    const size_t head = (16 - ((uintptr_t)dst & 15)) & 15;
+    memcpy( dst, src, head );
+    dst += head;
+    src += head;
+    len -= head;
+
+    const size_t body = len & ~(size_t)63;
+    StreamCopy( dst, src, body );
+    memcpy( dst + body, src + body, len - body );
+    return to;
+}
+
+/*****************************************************************************
+ * Cache size and benchmark
+ *****************************************************************************/
+/* Largest copy timed at startup, in bytes */
+#define BENCH_SIZE_MAX (8 << 20)
+
+static size_t GetCacheSize( void )
+{
+    long size = -1;
+#if defined(_SC_LEVEL3_CACHE_SIZE)
+    size = sysconf( _SC_LEVEL3_CACHE_SIZE );
+    if( size <= 0 )
+        size = sysconf( _SC_LEVEL2_CACHE_SIZE );
+#endif
+    if( size <= 0 )
+        size = 2 * 1024 * 1024; /* Reasonable guess for a desktop CPU */
+    return size;
+}
+
+static mtime_t Bench( void *(*cpy)(void *, const void *, size_t),
+                      uint8_t *dst, const uint8_t *src, size_t size )
+{
+    mtime_t best = INT64_MAX;
+
+    for( int i = 0; i < 4; i++ )
+    {
+        const mtime_t start = mdate();
+        cpy( dst, src, size );
+        const mtime_t duration = mdate() - start;
+        if( duration < best )
+            best = duration;
+    }
+    return best;
+}
+
+/* Returns true if streaming copies of the given size are faster than the
+ * C library memcpy() */
+static bool StreamIsFaster( vlc_object_t *obj, size_t size )
+{
+    void *base;
+    uint8_t *buffer = vlc_memalign( &base, 64, 2 * size );
+    if( !buffer )
+        return false;
+
+    uint8_t *dst = buffer;
+    const uint8_t *src = buffer + size;
+    memset( buffer, 0, 2 * size );
+
+    stream_threshold = 0;
+    const mtime_t stream = Bench( sse2_memcpy, dst, src, size );
+    const mtime_t libc = Bench( memcpy, dst, src, size );
+    stream_threshold = SIZE_MAX;
+    free( base );
+
+    msg_Dbg( obj, "%zu kB copy: %"PRId64" us streaming, %"PRId64" us libc",
+             size / 1024, stream, libc );
+    return stream < libc;
+}
+
+/*****************************************************************************
+ * Activate
+ *****************************************************************************/
+static int Activate( vlc_object_t *obj )
+{
+    if( !(vlc_CPU() & CPU_CAPABILITY_SSE2) )
+        return VLC_EGENERIC;
+
+    const int64_t threshold = var_InheritInteger( obj,
+                                                  "memcpy-sse2-threshold" );
+    if( threshold > 0 )
+        stream_threshold = threshold * 1024;
+    else
+    {
+        const size_t cache = GetCacheSize();
+        if( threshold == 0 || 2 * cache > BENCH_SIZE_MAX
+         || StreamIsFaster( obj, 2 * cache ) )
+            stream_threshold = cache;
+        else
+            stream_threshold = SIZE_MAX;
+    }
+
+    if( stream_threshold != SIZE_MAX )
+        msg_Dbg( obj, "streaming copies above %zu kB",
+                 stream_threshold / 1024 );
+    vlc_fastmem_register( sse2_memcpy );
+    return VLC_SUCCESS;
+}
@@ -0,0 +1,539 @@
+/*****************************************************************************
+ * prefetch.c: background read-ahead stream filter
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_stream.h>
+#include <vlc_access.h>
+#include <vlc_input.h>
+#include <vlc_modules.h>
+
+#include <assert.h>
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+static int  Open ( vlc_object_t * );
+static void Close( vlc_object_t * );
+
+#define BUFFER_TEXT N_("Read-ahead window (kB)")
+#define BUFFER_LONGTEXT N_( \
+    "Amount of data read in advance from slow sources, such as files on " \
+    "network shares, by a background thread.")
+
+#define READ_TEXT N_("Minimum read size (kB)")
+#define READ_LONGTEXT N_( \
+    "Smallest amount of data requested at once from the source. The " \
+    "actual read size grows with the measured source bandwidth.")
+
+vlc_module_begin()
+    set_category( CAT_INPUT )
+    set_subcategory( SUBCAT_INPUT_STREAM_FILTER )
+    set_description( N_("Read-ahead stream filter") )
+    set_shortname( N_("Prefetch") )
+    add_shortcut( "prefetch" )
+    add_integer( "prefetch-buffer-size", 16384, BUFFER_TEXT,
+                 BUFFER_LONGTEXT, true )
+        change_integer_range( 256, 1024 * 1024 )
+    add_integer( "prefetch-read-size", 16, READ_TEXT, READ_LONGTEXT, true )
+        change_integer_range( 1, 16 * 1024 )
+    set_capability( "stream_filter", 5 )
+    set_callbacks( Open, Close )
+vlc_module_end()
+
+/*****************************************************************************
+ *
+ *****************************************************************************/
+/* Aim at one read every PREFETCH_READ_PERIOD with the measured bandwidth */
+#define PREFETCH_READ_PERIOD (CLOCK_FREQ / 20)
+
+struct stream_sys_t
+{
+    vlc_thread_t thread;
+
+    /* Serializes accesses to s->p_source */
+    vlc_mutex_t  source_lock;
+
+    vlc_mutex_t  lock;
+    vlc_cond_t   wait_data;
+    vlc_cond_t   wait_space;
+
+    /* Ring buffer holding [buffer_offset, buffer_offset + buffer_length) */
+    uint8_t      *p_buffer;
+    size_t       i_buffer_size;
+    uint64_t     i_buffer_offset;
+    size_t       i_buffer_length;
+
+    /* Position of the reader */
+    uint64_t     i_stream_offset;
+
+    bool         b_eof;
+    bool         b_error;
+    bool         b_seek;     /* The thread must seek to i_buffer_offset */
+
+    /* Adaptive read size */
+    size_t       i_read_min;
+    size_t       i_read_size;
+    uint64_t     i_byterate; /* bytes per second */
+
+    /* Cached source properties */
+    bool         b_can_seek;
+    bool         b_can_fastseek;
+    uint64_t     i_size;
+
+    /* Peek contiguous copy */
+    uint8_t      *p_peek;
+    size_t       i_peek;
+};
+
+static int  Read   ( stream_t *, void *p_read, unsigned int i_read );
+static int  Peek   ( stream_t *, const uint8_t **pp_peek, unsigned int i_peek );
+static int  Control( stream_t *, int i_query, va_list );
+static void *Thread( void * );
+
+/****************************************************************************
+ * Open/Close
+ ****************************************************************************/
+static int Open( vlc_object_t *p_this )
+{
+    stream_t *s = (stream_t*)p_this;
+    stream_t *p_source = s->p_source;
+    bool b_can_seek, b_can_fastseek, b_remote = false;
+
+    /* Preparsing only reads the headers */
+    if( s->p_input != NULL && s->p_input->b_preparsing )
+        return VLC_EGENERIC;
+
+    /* Do not stack prefetchers */
+    if( p_source->p_module != NULL &&
+        !strcmp( module_get_object( p_source->p_module ), "prefetch" ) )
+        return VLC_EGENERIC;
+
+    /* Local files are already read ahead by the OS, and live streams are
+     * already buffered by their access. Files on network shares seek fast
+     * enough, but each read is a round trip. */
+    stream_Control( p_source, STREAM_CAN_SEEK, &b_can_seek );
+    stream_Control( p_source, STREAM_CAN_FASTSEEK, &b_can_fastseek );
+    if( b_can_seek && b_can_fastseek )
+        stream_Control( p_source, STREAM_IS_REMOTE, &b_remote );
+    if( !b_can_seek || ( b_can_fastseek && !b_remote ) )
+        return VLC_EGENERIC;
+
+    stream_sys_t *p_sys = malloc( sizeof(*p_sys) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+
+    p_sys->i_buffer_size = var_InheritInteger( s, "prefetch-buffer-size" ) * 1024;
+    p_sys->p_buffer = malloc( p_sys->i_buffer_size );
+    if( !p_sys->p_buffer )
+    {
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+    p_sys->i_buffer_offset = stream_Tell( p_source );
+    p_sys->i_buffer_length = 0;
+    p_sys->i_stream_offset = p_sys->i_buffer_offset;
+    p_sys->b_eof = false;
+    p_sys->b_error = false;
+    p_sys->b_seek = false;
+
+    p_sys->i_read_min = var_InheritInteger( s, "prefetch-read-size" ) * 1024;
+    p_sys->i_read_min = __MIN( p_sys->i_read_min, p_sys->i_buffer_size / 4 );
+    p_sys->i_read_size = p_sys->i_read_min;
+    p_sys->i_byterate = 0;
+
+    p_sys->b_can_seek = b_can_seek;
+    p_sys->b_can_fastseek = b_can_fastseek;
+    p_sys->i_size = stream_Size( p_source );
+
+    p_sys->p_peek = NULL;
+    p_sys->i_peek = 0;
+
+    vlc_mutex_init( &p_sys->source_lock );
+    vlc_mutex_init( &p_sys->lock );
+    vlc_cond_init( &p_sys->wait_data );
+    vlc_cond_init( &p_sys->wait_space );
+
+    s->p_sys = p_sys;
+    if( vlc_clone( &p_sys->thread, Thread, s, VLC_THREAD_PRIORITY_INPUT ) )
+    {
+        vlc_cond_destroy( &p_sys->wait_space );
+        vlc_cond_destroy( &p_sys->wait_data );
+        vlc_mutex_destroy( &p_sys->lock );
+        vlc_mutex_destroy( &p_sys->source_lock );
+        free( p_sys->p_buffer );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg( s, "reading %zu kB ahead", p_sys->i_buffer_size / 1024 );
+
+    s->pf_read = Read;
+    s->pf_peek = Peek;
+    s->pf_control = Control;
+
+    return VLC_SUCCESS;
+}
+
+static void Close( vlc_object_t *p_this )
+{
+    stream_t *s = (stream_t*)p_this;
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_cancel( p_sys->thread );
+    vlc_join( p_sys->thread, NULL );
+
+    vlc_cond_destroy( &p_sys->wait_space );
+    vlc_cond_destroy( &p_sys->wait_data );
+    vlc_mutex_destroy( &p_sys->lock );
+    vlc_mutex_destroy( &p_sys->source_lock );
+    free( p_sys->p_peek );
+    free( p_sys->p_buffer );
+    free( p_sys );
+}
+
+/****************************************************************************
+ * Thread: keeps the window ahead of the reader filled
+ ****************************************************************************/
+/* Updates the read size from the duration of the last read */
+static void UpdateReadSize( stream_sys_t *p_sys, size_t i_read,
+                            mtime_t i_duration )
+{
+    if( i_read == 0 || i_duration <= 0 )
+        return;
+
+    const uint64_t i_byterate = i_read * CLOCK_FREQ / i_duration;
+    if( p_sys->i_byterate == 0 )
+        p_sys->i_byterate = i_byterate;
+    else
+        p_sys->i_byterate = ( 7 * p_sys->i_byterate + i_byterate ) / 8;
+
+    size_t i_size = p_sys->i_byterate * PREFETCH_READ_PERIOD / CLOCK_FREQ;
+    i_size = __MAX( i_size, p_sys->i_read_min );
+    i_size = __MIN( i_size, p_sys->i_buffer_size / 4 );
+    p_sys->i_read_size = i_size;
+}
+
+static void WaitSpace( stream_sys_t *p_sys )
+{
+    mutex_cleanup_push( &p_sys->lock );
+    vlc_cond_wait( &p_sys->wait_space, &p_sys->lock );
+    vlc_cleanup_pop( );
+}
+
+static void *Thread( void *data )
+{
+    stream_t *s = data;
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    for( ;; )
+    {
+        if( p_sys->b_seek )
+        {
+            const uint64_t i_pos = p_sys->i_buffer_offset;
+
+            p_sys->b_seek = false;
+            vlc_mutex_unlock( &p_sys->lock );
+
+            int i_ret;
+            vlc_mutex_lock( &p_sys->source_lock );
+            mutex_cleanup_push( &p_sys->source_lock );
+            i_ret = stream_Seek( s->p_source, i_pos );
+            vlc_cleanup_run( );
+
+            vlc_mutex_lock( &p_sys->lock );
+            if( !p_sys->b_seek )
+                p_sys->b_error = i_ret != VLC_SUCCESS;
+            vlc_cond_signal( &p_sys->wait_data );
+            continue;
+        }
+
+        if( p_sys->b_eof || p_sys->b_error )
+        {
+            WaitSpace( p_sys );
+            continue;
+        }
+
+        /* Recycle the data already consumed when the buffer is full */
+        if( p_sys->i_buffer_length == p_sys->i_buffer_size )
+        {
+            const uint64_t i_history = p_sys->i_stream_offset
+                                     - p_sys->i_buffer_offset;
+            if( i_history == 0 )
+            {
+                WaitSpace( p_sys );
+                continue;
+            }
+            const size_t i_drop = __MIN( i_history, p_sys->i_read_size );
+            p_sys->i_buffer_offset += i_drop;
+            p_sys->i_buffer_length -= i_drop;
+        }
+
+        /* Read at the end of the buffer, without wrapping */
+        const uint64_t i_end = p_sys->i_buffer_offset + p_sys->i_buffer_length;
+        const size_t i_index = i_end % p_sys->i_buffer_size;
+        size_t i_read = p_sys->i_buffer_size - p_sys->i_buffer_length;
+        i_read = __MIN( i_read, p_sys->i_buffer_size - i_index );
+        i_read = __MIN( i_read, p_sys->i_read_size );
+        vlc_mutex_unlock( &p_sys->lock );
+
+        int i_ret;
+        mtime_t i_duration;
+        uint64_t i_size;
+        vlc_mutex_lock( &p_sys->source_lock );
+        mutex_cleanup_push( &p_sys->source_lock );
+        const mtime_t i_start = mdate();
+        i_ret = stream_Read( s->p_source, &p_sys->p_buffer[i_index], i_read );
+        i_duration = mdate() - i_start;
+        i_size = stream_Size( s->p_source );
+        vlc_cleanup_run( );
+
+        vlc_mutex_lock( &p_sys->lock );
+        if( p_sys->b_seek )
+            continue; /* The data are not wanted anymore */
+
+        p_sys->i_size = i_size;
+        if( i_ret <= 0 )
+            p_sys->b_eof = true;
+        else
+        {
+            p_sys->i_buffer_length += i_ret;
+            UpdateReadSize( p_sys, i_ret, i_duration );
+        }
+        vlc_cond_signal( &p_sys->wait_data );
+    }
+    assert( 0 );
+    return NULL;
+}
+
+/****************************************************************************
+ * Stream filters functions
+ ****************************************************************************/
+/* Waits until at least i_wanted bytes are available after the reader
+ * position, or the end of the stream. Returns the available size. */
+static size_t WaitData( stream_t *s, size_t i_wanted )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    i_wanted = __MIN( i_wanted, p_sys->i_buffer_size / 2 );
+    for( ;; )
+    {
+        const uint64_t i_end = p_sys->i_buffer_offset + p_sys->i_buffer_length;
+        const size_t i_avail = i_end > p_sys->i_stream_offset ?
+                               i_end - p_sys->i_stream_offset : 0;
+
+        if( !p_sys->b_seek &&
+            ( i_avail >= i_wanted || p_sys->b_eof || p_sys->b_error ) )
+            return i_avail;
+        if( !vlc_object_alive( s ) )
+            return i_avail;
+
+        /* Make sure the thread does not wait for space that will never be
+         * released */
+        vlc_cond_signal( &p_sys->wait_space );
+        vlc_cond_wait( &p_sys->wait_data, &p_sys->lock );
+    }
+}
+
+static int Seek( stream_t *s, uint64_t i_pos )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    const uint64_t i_end = p_sys->i_buffer_offset + p_sys->i_buffer_length;
+
+    /* Data already read, or soon to be read */
+    if( i_pos >= p_sys->i_buffer_offset && !p_sys->b_seek &&
+        i_pos <= i_end + p_sys->i_read_size )
+    {
+        if( i_pos > i_end && ( p_sys->b_eof || p_sys->b_error ) )
+            return VLC_EGENERIC;
+        p_sys->i_stream_offset = i_pos;
+        vlc_cond_signal( &p_sys->wait_space );
+        return VLC_SUCCESS;
+    }
+
+    if( !p_sys->b_can_seek )
+        return VLC_EGENERIC;
+
+    /* Restart reading from the new position */
+    p_sys->i_buffer_offset = i_pos;
+    p_sys->i_buffer_length = 0;
+    p_sys->i_stream_offset = i_pos;
+    p_sys->b_seek = true;
+    p_sys->b_eof = false;
+    p_sys->b_error = false;
+    vlc_cond_signal( &p_sys->wait_space );
+    return VLC_SUCCESS;
+}
+
+static int Read( stream_t *s, void *p_read, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    uint8_t *p_data = p_read;
+    unsigned int i_total = 0;
+
+    vlc_mutex_lock( &p_sys->lock );
+    if( p_data == NULL )
+    {
+        /* Skipping */
+        if( Seek( s, p_sys->i_stream_offset + i_read ) == VLC_SUCCESS )
+            i_total = i_read;
+        vlc_mutex_unlock( &p_sys->lock );
+        return i_total;
+    }
+
+    while( i_total < i_read )
+    {
+        const size_t i_avail = WaitData( s, i_read - i_total );
+        if( i_avail == 0 )
+            break;
+
+        const size_t i_index = p_sys->i_stream_offset % p_sys->i_buffer_size;
+        size_t i_copy = __MIN( i_avail, i_read - i_total );
+        i_copy = __MIN( i_copy, p_sys->i_buffer_size - i_index );
+
+        memcpy( &p_data[i_total], &p_sys->p_buffer[i_index], i_copy );
+        p_sys->i_stream_offset += i_copy;
+        i_total += i_copy;
+        vlc_cond_signal( &p_sys->wait_space );
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return i_total;
+}
+
+static int Peek( stream_t *s, const uint8_t **pp_peek, unsigned int i_peek )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock( &p_sys->lock );
+    const size_t i_avail = WaitData( s, i_peek );
+    if( i_peek > i_avail )
+        i_peek = i_avail;
+
+    const size_t i_index = p_sys->i_stream_offset % p_sys->i_buffer_size;
+    if( i_index + i_peek <= p_sys->i_buffer_size )
+    {
+        /* The data are contiguous, and will not be overwritten until the
+         * next read as they are after the reader position */
+        *pp_peek = &p_sys->p_buffer[i_index];
+    }
+    else
+    {
+        if( p_sys->i_peek < i_peek )
+        {
+            uint8_t *p_peek = realloc( p_sys->p_peek, i_peek );
+            if( !p_peek )
+            {
+                vlc_mutex_unlock( &p_sys->lock );
+                return 0;
+            }
+            p_sys->p_peek = p_peek;
+            p_sys->i_peek = i_peek;
+        }
+
+        const size_t i_first = p_sys->i_buffer_size - i_index;
+        memcpy( p_sys->p_peek, &p_sys->p_buffer[i_index], i_first );
+        memcpy( &p_sys->p_peek[i_first], p_sys->p_buffer, i_peek - i_first );
+        *pp_peek = p_sys->p_peek;
+    }
+    vlc_mutex_unlock( &p_sys->lock );
+
+    return i_peek;
+}
+
+static int Control( stream_t *s, int i_query, va_list args )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    int i_ret = VLC_SUCCESS;
+
+    switch( i_query )
+    {
+        case STREAM_CAN_SEEK:
+            *va_arg( args, bool * ) = p_sys->b_can_seek;
+            break;
+        case STREAM_CAN_FASTSEEK:
+            *va_arg( args, bool * ) = p_sys->b_can_fastseek;
+            break;
+
+        case STREAM_GET_POSITION:
+            vlc_mutex_lock( &p_sys->lock );
+            *va_arg( args, uint64_t * ) = p_sys->i_stream_offset;
+            vlc_mutex_unlock( &p_sys->lock );
+            break;
+        case STREAM_SET_POSITION:
+            vlc_mutex_lock( &p_sys->lock );
+            i_ret = Seek( s, va_arg( args, uint64_t ) );
+            vlc_mutex_unlock( &p_sys->lock );
+            break;
+
+        case STREAM_GET_SIZE:
+            vlc_mutex_lock( &p_sys->lock );
+            *va_arg( args, uint64_t * ) = p_sys->i_size;
+            vlc_mutex_unlock( &p_sys->lock );
+            break;
+
+        case STREAM_CONTROL_ACCESS:
+        {
+            va_list ap;
+            va_copy( ap, args );
+            const int i_access_query = va_arg( ap, int );
+            va_end( ap );
+
+            vlc_mutex_lock( &p_sys->source_lock );
+            i_ret = stream_vaControl( s->p_source, i_query, args );
+            const uint64_t i_pos = stream_Tell( s->p_source );
+            vlc_mutex_unlock( &p_sys->source_lock );
+
+            /* Only titles and seekpoints move the access position, the
+             * other queries leave the buffered data valid */
+            if( i_access_query != ACCESS_SET_TITLE &&
+                i_access_query != ACCESS_SET_SEEKPOINT )
+                break;
+
+            /* Restart from the new access position */
+            vlc_mutex_lock( &p_sys->lock );
+            p_sys->i_buffer_offset = i_pos;
+            p_sys->i_buffer_length = 0;
+            p_sys->i_stream_offset = i_pos;
+            p_sys->b_seek = true;
+            p_sys->b_eof = false;
+            p_sys->b_error = false;
+            vlc_cond_signal( &p_sys->wait_space );
+            vlc_mutex_unlock( &p_sys->lock );
+            break;
+        }
+
+        default:
+            vlc_mutex_lock( &p_sys->source_lock );
+            i_ret = stream_vaControl( s->p_source, i_query, args );
+            vlc_mutex_unlock( &p_sys->source_lock );
+            break;
+    }
+    return i_ret;
+}
@@ -234,7 +234,7 @@ static void preparse_if_needed( libvlc_media_t *p_md )
     /* XXX: need some locking here */
     if (!p_md->has_asked_preparse)
     {
-        playlist_PreparseEnqueue(
+        playlist_PreparsePrioritize(
                 libvlc_priv (p_md->p_libvlc_instance->p_libvlc_int)->p_playlist,
                 p_md->p_input_item );
         p_md->has_asked_preparse = true;
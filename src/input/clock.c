@@ -72,6 +72,18 @@
  * dynamic average value.
  * We use the following formula :
  * new_average = (old_average * c_average + new_sample_value) / (c_average +1)
+ *
+ * The average follows the mean network delay, so every delay burst moves the
+ * recovered clock. Two other estimators can be selected (clock-recovery):
+ *  - the windowed minimum keeps the smallest drift sample of the last
+ *  i_cr_average samples (at most CR_WINDOW_MAX). Network delays are only
+ *  ever positive, so the least delayed sample is the closest to the sender
+ *  clock.
+ *  - the tracking loop is an alpha-beta filter (the steady state form of a
+ *  Kalman filter on drift and drift rate), so a constant clock skew is
+ *  followed without lag. Samples further than 3 standard deviations from the
+ *  prediction are rejected, unless CR_OUTLIER_MAX of them follow each other,
+ *  in which case it is a real step and the loop is restarted on it.
  */
 
 
@@ -99,6 +111,14 @@
 /* Due to some problems in es_out, we cannot use a large value yet */
 #define CR_BUFFERING_TARGET (100000)
 
+/* Maximum number of samples kept by the windowed minimum */
+#define CR_WINDOW_MAX (256)
+
+/* Number of samples accepted by the tracking loop before rejecting any, and
+ * number of consecutive rejected samples after which the loop restarts */
+#define CR_OUTLIER_WARMUP (5)
+#define CR_OUTLIER_MAX (5)
+
 /*****************************************************************************
  * Structures
  *****************************************************************************/
@@ -122,6 +142,49 @@ static void    AvgUpdate( average_t *, mtime_t i_value );
 static mtime_t AvgGet( average_t * );
 static void    AvgRescale( average_t *, int i_divider );
 
+/**
+ * This structure holds the clock drift estimator
+ */
+typedef struct
+{
+    int       i_type;  /* INPUT_CLOCK_RECOVERY_* */
+    int       i_divider;
+    mtime_t   i_value;
+
+    /* INPUT_CLOCK_RECOVERY_AVERAGE */
+    average_t avg;
+
+    /* INPUT_CLOCK_RECOVERY_MINIMUM */
+    struct
+    {
+        mtime_t  pi_value[CR_WINDOW_MAX];
+        unsigned i_index;
+        unsigned i_count;
+    } window;
+
+    /* INPUT_CLOCK_RECOVERY_TRACKING */
+    struct
+    {
+        double   f_value;
+        double   f_rate;     /* drift change per system microsecond */
+        double   f_variance; /* of the prediction error */
+        mtime_t  i_date;
+        unsigned i_count;
+        unsigned i_outliers;
+    } loop;
+
+    /* Mean deviation of the samples from the estimation */
+    average_t jitter;
+} drift_t;
+static void    DriftInit( drift_t *, int i_type, int i_divider );
+static void    DriftClean( drift_t * );
+
+static void    DriftReset( drift_t * );
+static void    DriftUpdate( drift_t *, mtime_t i_value, mtime_t i_system );
+static mtime_t DriftGet( drift_t * );
+static mtime_t DriftGetJitter( drift_t * );
+static void    DriftRescale( drift_t *, int i_divider );
+
 /* */
 typedef struct
 {
@@ -156,7 +219,10 @@ struct input_clock_t
 
     /* Clock drift */
     mtime_t i_next_drift_update;
-    average_t drift;
+    drift_t drift;
+
+    /* Margin left by the last clock point before being late */
+    mtime_t i_buffering_margin;
 
     /* Late statistics */
     struct
@@ -188,7 +254,7 @@ static mtime_t ClockGetTsOffset( input_clock_t * );
 /*****************************************************************************
  * input_clock_New: create a new clock
  *****************************************************************************/
-input_clock_t *input_clock_New( int i_rate )
+input_clock_t *input_clock_New( int i_rate, int i_recovery )
 {
     input_clock_t *cl = malloc( sizeof(*cl) );
     if( !cl )
@@ -206,7 +272,8 @@ input_clock_t *input_clock_New( int i_rate )
     cl->i_buffering_duration = 0;
 
     cl->i_next_drift_update = VLC_TS_INVALID;
-    AvgInit( &cl->drift, 10 );
+    DriftInit( &cl->drift, i_recovery, 10 );
+    cl->i_buffering_margin = 0;
 
     cl->late.i_index = 0;
     for( int i = 0; i < INPUT_CLOCK_LATE_COUNT; i++ )
@@ -225,7 +292,7 @@ input_clock_t *input_clock_New( int i_rate )
  *****************************************************************************/
 void input_clock_Delete( input_clock_t *cl )
 {
-    AvgClean( &cl->drift );
+    DriftClean( &cl->drift );
     vlc_mutex_destroy( &cl->lock );
     free( cl );
 }
@@ -271,7 +338,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
     if( b_reset_reference )
     {
         cl->i_next_drift_update = VLC_TS_INVALID;
-        AvgReset( &cl->drift );
+        DriftReset( &cl->drift );
 
         /* Feed synchro with a new reference point. */
         cl->b_has_reference = true;
@@ -286,7 +353,7 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
     {
         const mtime_t i_converted = ClockSystemToStream( cl, i_ck_system );
 
-        AvgUpdate( &cl->drift, i_converted - i_ck_stream );
+        DriftUpdate( &cl->drift, i_converted - i_ck_stream, i_ck_system );
 
         cl->i_next_drift_update = i_ck_system + CLOCK_FREQ/5; /* FIXME why that */
     }
@@ -314,9 +381,10 @@ void input_clock_Update( input_clock_t *cl, vlc_object_t *p_log,
 
     /* It does not take the decoder latency into account but it is not really
      * the goal of the clock here */
-    const mtime_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + AvgGet( &cl->drift ) );
+    const mtime_t i_system_expected = ClockStreamToSystem( cl, i_ck_stream + DriftGet( &cl->drift ) );
     const mtime_t i_late = ( i_ck_system - cl->i_pts_delay ) - i_system_expected;
     *pb_late = i_late > 0;
+    cl->i_buffering_margin = -i_late;
     if( i_late > 0 )
     {
         cl->late.pi_value[cl->late.i_index] = i_late;
@@ -394,7 +462,7 @@ mtime_t input_clock_GetWakeup( input_clock_t *cl )
 
     /* Synchronized, we can wait */
     if( cl->b_has_reference )
-        i_wakeup = ClockStreamToSystem( cl, cl->last.i_stream + AvgGet( &cl->drift ) - cl->i_buffering_duration );
+        i_wakeup = ClockStreamToSystem( cl, cl->last.i_stream + DriftGet( &cl->drift ) - cl->i_buffering_duration );
 
     vlc_mutex_unlock( &cl->lock );
 
@@ -430,7 +498,7 @@ int input_clock_ConvertTS( input_clock_t *cl,
     /* */
     if( *pi_ts0 > VLC_TS_INVALID )
     {
-        *pi_ts0 = ClockStreamToSystem( cl, *pi_ts0 + AvgGet( &cl->drift ) );
+        *pi_ts0 = ClockStreamToSystem( cl, *pi_ts0 + DriftGet( &cl->drift ) );
         if( *pi_ts0 > cl->i_ts_max )
             cl->i_ts_max = *pi_ts0;
         *pi_ts0 += i_ts_delay;
@@ -439,7 +507,7 @@ int input_clock_ConvertTS( input_clock_t *cl,
     /* XXX we do not ipdate i_ts_max on purpose */
     if( pi_ts1 && *pi_ts1 > VLC_TS_INVALID )
     {
-        *pi_ts1 = ClockStreamToSystem( cl, *pi_ts1 + AvgGet( &cl->drift ) ) +
+        *pi_ts1 = ClockStreamToSystem( cl, *pi_ts1 + DriftGet( &cl->drift ) ) +
                   i_ts_delay;
     }
 
@@ -563,7 +631,7 @@ void input_clock_SetJitter( input_clock_t *cl,
         i_cr_average = 10;
 
     if( cl->drift.i_divider != i_cr_average )
-        AvgRescale( &cl->drift, i_cr_average );
+        DriftRescale( &cl->drift, i_cr_average );
 
     vlc_mutex_unlock( &cl->lock );
 }
@@ -590,6 +658,26 @@ mtime_t input_clock_GetJitter( input_clock_t *cl )
     return i_pts_delay + i_late_median;
 }
 
+int input_clock_GetStats( input_clock_t *cl, mtime_t *pi_drift,
+                          mtime_t *pi_jitter, mtime_t *pi_buffering )
+{
+    vlc_mutex_lock( &cl->lock );
+
+    if( !cl->b_has_reference )
+    {
+        vlc_mutex_unlock( &cl->lock );
+        return VLC_EGENERIC;
+    }
+
+    *pi_drift = DriftGet( &cl->drift );
+    *pi_jitter = DriftGetJitter( &cl->drift );
+    *pi_buffering = cl->i_buffering_margin;
+
+    vlc_mutex_unlock( &cl->lock );
+
+    return VLC_SUCCESS;
+}
+
 /*****************************************************************************
  * ClockStreamToSystem: converts a movie clock to system date
  *****************************************************************************/
@@ -665,3 +753,158 @@ static void AvgRescale( average_t *p_avg, int i_divider )
     p_avg->i_value   = i_tmp / p_avg->i_divider;
     p_avg->i_residue = i_tmp % p_avg->i_divider;
 }
+
+/*****************************************************************************
+ * Clock drift estimation helpers
+ *****************************************************************************/
+static void DriftInit( drift_t *p_drift, int i_type, int i_divider )
+{
+    p_drift->i_type = i_type;
+    p_drift->i_divider = i_divider;
+    AvgInit( &p_drift->avg, i_divider );
+    AvgInit( &p_drift->jitter, i_divider );
+    DriftReset( p_drift );
+}
+static void DriftClean( drift_t *p_drift )
+{
+    AvgClean( &p_drift->jitter );
+    AvgClean( &p_drift->avg );
+}
+static void DriftReset( drift_t *p_drift )
+{
+    p_drift->i_value = 0;
+    AvgReset( &p_drift->avg );
+    AvgReset( &p_drift->jitter );
+
+    p_drift->window.i_index = 0;
+    p_drift->window.i_count = 0;
+
+    p_drift->loop.f_value = 0.;
+    p_drift->loop.f_rate = 0.;
+    p_drift->loop.f_variance = 0.;
+    p_drift->loop.i_date = VLC_TS_INVALID;
+    p_drift->loop.i_count = 0;
+    p_drift->loop.i_outliers = 0;
+}
+
+static mtime_t WindowUpdate( drift_t *p_drift, mtime_t i_value )
+{
+    const unsigned i_size = __MIN( p_drift->i_divider, CR_WINDOW_MAX );
+
+    p_drift->window.pi_value[p_drift->window.i_index] = i_value;
+    p_drift->window.i_index = ( p_drift->window.i_index + 1 ) % i_size;
+    if( p_drift->window.i_count < i_size )
+        p_drift->window.i_count++;
+
+    mtime_t i_min = i_value;
+    for( unsigned i = 0; i < p_drift->window.i_count; i++ )
+        i_min = __MIN( i_min, p_drift->window.pi_value[i] );
+    return i_min;
+}
+
+static mtime_t LoopUpdate( drift_t *p_drift, mtime_t i_value, mtime_t i_system )
+{
+    if( p_drift->loop.i_count == 0 )
+    {
+        p_drift->loop.f_value = i_value;
+        p_drift->loop.f_rate = 0.;
+        p_drift->loop.f_variance = 0.;
+        p_drift->loop.i_date = i_system;
+        p_drift->loop.i_count = 1;
+        p_drift->loop.i_outliers = 0;
+        return i_value;
+    }
+
+    /* Predict */
+    const double f_dt = i_system - p_drift->loop.i_date;
+    const double f_predicted = p_drift->loop.f_value + p_drift->loop.f_rate * f_dt;
+    const double f_error = i_value - f_predicted;
+
+    /* Reject the outliers */
+    if( p_drift->loop.i_count >= CR_OUTLIER_WARMUP &&
+        f_error * f_error > 9. * p_drift->loop.f_variance )
+    {
+        if( ++p_drift->loop.i_outliers < CR_OUTLIER_MAX )
+            return p_drift->i_value;
+
+        /* It is not jitter but a step: restart on it */
+        p_drift->loop.i_count = 0;
+        return LoopUpdate( p_drift, i_value, i_system );
+    }
+    p_drift->loop.i_outliers = 0;
+
+    /* Correct, with the gains of a critically damped loop whose memory is
+     * i_divider samples */
+    const double f_theta = 1. - 1. / p_drift->i_divider;
+    const double f_alpha = 1. - f_theta * f_theta;
+    const double f_beta = ( 1. - f_theta ) * ( 1. - f_theta );
+
+    p_drift->loop.f_value = f_predicted + f_alpha * f_error;
+    if( f_dt > 0. )
+        p_drift->loop.f_rate += f_beta * f_error / f_dt;
+    p_drift->loop.f_variance += ( f_error * f_error - p_drift->loop.f_variance ) /
+                                __MIN( p_drift->loop.i_count, (unsigned)p_drift->i_divider );
+    p_drift->loop.i_date = i_system;
+    p_drift->loop.i_count++;
+
+    return (mtime_t)p_drift->loop.f_value;
+}
+
+static void DriftUpdate( drift_t *p_drift, mtime_t i_value, mtime_t i_system )
+{
+    const mtime_t i_previous = p_drift->i_value;
+    const bool b_first = p_drift->avg.i_count == 0;
+
+    /* The average is always kept, to report the mean drift */
+    AvgUpdate( &p_drift->avg, i_value );
+
+    switch( p_drift->i_type )
+    {
+    case INPUT_CLOCK_RECOVERY_MINIMUM:
+        p_drift->i_value = WindowUpdate( p_drift, i_value );
+        break;
+    case INPUT_CLOCK_RECOVERY_TRACKING:
+        p_drift->i_value = LoopUpdate( p_drift, i_value, i_system );
+        break;
+    default:
+        p_drift->i_value = AvgGet( &p_drift->avg );
+        break;
+    }
+
+    if( !b_first )
+    {
+        const mtime_t i_deviation = i_value - i_previous;
+        AvgUpdate( &p_drift->jitter, i_deviation >= 0 ? i_deviation : -i_deviation );
+    }
+}
+static mtime_t DriftGet( drift_t *p_drift )
+{
+    return p_drift->i_value;
+}
+static mtime_t DriftGetJitter( drift_t *p_drift )
+{
+    return AvgGet( &p_drift->jitter );
+}
+static void DriftRescale( drift_t *p_drift, int i_divider )
+{
+    const unsigned i_old_size = __MIN( p_drift->i_divider, CR_WINDOW_MAX );
+    const unsigned i_size = __MIN( i_divider, CR_WINDOW_MAX );
+
+    p_drift->i_divider = i_divider;
+    AvgRescale( &p_drift->avg, i_divider );
+    AvgRescale( &p_drift->jitter, i_divider );
+
+    /* Keep the most recent samples of the window, oldest first */
+    mtime_t pi_value[CR_WINDOW_MAX];
+    const unsigned i_count = __MIN( p_drift->window.i_count, i_size );
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        const unsigned i_src = ( p_drift->window.i_index + i_old_size
+                                 - i_count + i ) % i_old_size;
+        pi_value[i] = p_drift->window.pi_value[i_src];
+    }
+    memcpy( p_drift->window.pi_value, pi_value, i_count * sizeof(*pi_value) );
+    p_drift->window.i_count = i_count;
+    p_drift->window.i_index = i_count % i_size;
+}
@@ -36,11 +36,21 @@
  */
 typedef struct input_clock_t input_clock_t;
 
+/**
+ * Clock drift estimation algorithms (see clock.c)
+ */
+enum
+{
+    INPUT_CLOCK_RECOVERY_AVERAGE = 0,
+    INPUT_CLOCK_RECOVERY_MINIMUM,
+    INPUT_CLOCK_RECOVERY_TRACKING,
+};
+
 /**
  * This function creates a new input_clock_t.
  * You must use input_clock_Delete to delete it once unused.
  */
-input_clock_t *input_clock_New( int i_rate );
+input_clock_t *input_clock_New( int i_rate, int i_recovery );
 
 /**
  * This function destroys a input_clock_t created by input_clock_New.
@@ -135,4 +145,13 @@ void input_clock_SetJitter( input_clock_t *,
  */
 mtime_t input_clock_GetJitter( input_clock_t * );
 
+/**
+ * This function returns the current drift estimation, the mean deviation of
+ * the drift samples from it (reception jitter), and the margin left by the
+ * last clock point before being late (negative when it was late).
+ * It returns VLC_EGENERIC if there is not a reference point.
+ */
+int input_clock_GetStats( input_clock_t *, mtime_t *pi_drift,
+                          mtime_t *pi_jitter, mtime_t *pi_buffering );
+
 #endif
@@ -59,6 +59,7 @@ static decoder_t *CreateDecoder( vlc_object_t *, input_thread_t *,
 static void       DeleteDecoder( decoder_t * );
 
 static void      *DecoderThread( void * );
+static void      *DecoderPacketizerThread( void * );
 static void       DecoderProcess( decoder_t *, block_t * );
 static void       DecoderError( decoder_t *p_dec, block_t *p_block );
 static void       DecoderOutputChangePause( decoder_t *, bool b_paused, mtime_t i_date );
@@ -102,6 +103,11 @@ struct decoder_owner_sys_t
     decoder_t *p_packetizer;
     bool b_packetizer;
 
+    /* Packetizer thread, feeding p_fifo from p_packetizer_fifo */
+    bool          b_packetizer_thread;
+    vlc_thread_t  packetizer_thread;
+    block_fifo_t *p_packetizer_fifo;
+
     /* Current format in use by the output */
     video_format_t video;
     audio_format_t audio;
@@ -129,6 +135,9 @@ struct decoder_owner_sys_t
     /* -- Theses variables need locking on read *and* write -- */
     bool b_exit;
 
+    /* Packetizer output format, pending for the decoder thread */
+    es_format_t *p_packetizer_fmt;
+
     /* Pause */
     bool b_paused;
     struct
@@ -177,6 +186,9 @@ struct decoder_owner_sys_t
 #define DECODER_MAX_BUFFERING_AUDIO_DURATION (AOUT_MAX_PREPARE_TIME)
 #define DECODER_MAX_BUFFERING_VIDEO_DURATION (1*CLOCK_FREQ)
 
+/* Maximum number of packetized blocks queued for the decoder thread */
+#define DECODER_PACKETIZER_FIFO_DEPTH (16)
+
 /* Pictures which are DECODER_BOGUS_VIDEO_DELAY or more in advance probably have
  * a bogus PTS and won't be displayed */
 #define DECODER_BOGUS_VIDEO_DELAY                ((mtime_t)(DEFAULT_PTS_DELAY * 30))
@@ -301,10 +313,25 @@ static decoder_t *decoder_New( vlc_object_t *p_parent, input_thread_t *p_input,
     else
         i_priority = VLC_THREAD_PRIORITY_VIDEO;
 
+    /* Spawn the packetizer thread, if any */
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    if( p_owner->b_packetizer_thread
+     && vlc_clone( &p_owner->packetizer_thread, DecoderPacketizerThread, p_dec,
+                   i_priority ) )
+    {
+        msg_Warn( p_dec, "cannot spawn packetizer thread" );
+        p_owner->b_packetizer_thread = false;
+    }
+
     /* Spawn the decoder thread */
-    if( vlc_clone( &p_dec->p_owner->thread, DecoderThread, p_dec, i_priority ) )
+    if( vlc_clone( &p_owner->thread, DecoderThread, p_dec, i_priority ) )
     {
         msg_Err( p_dec, "cannot spawn decoder thread" );
+        if( p_owner->b_packetizer_thread )
+        {
+            vlc_cancel( p_owner->packetizer_thread );
+            vlc_join( p_owner->packetizer_thread, NULL );
+        }
         module_unneed( p_dec, p_dec->p_module );
         DeleteDecoder( p_dec );
         return NULL;
@@ -350,6 +377,13 @@ void input_DecoderDelete( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
+    /* The packetizer thread feeds the decoder thread, stop it first */
+    if( p_owner->b_packetizer_thread )
+    {
+        vlc_cancel( p_owner->packetizer_thread );
+        vlc_join( p_owner->packetizer_thread, NULL );
+    }
+
     vlc_cancel( p_owner->thread );
 
     /* Make sure we aren't paused/buffering/waiting/decoding anymore */
@@ -389,6 +423,8 @@ void input_DecoderDelete( decoder_t *p_dec )
 void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    block_fifo_t *p_fifo = p_owner->b_packetizer_thread ?
+                           p_owner->p_packetizer_fifo : p_owner->p_fifo;
 
     if( b_do_pace )
     {
@@ -397,22 +433,22 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
          * There is no need to lock as b_buffering is never modify
          * inside decoder thread. */
         if( !p_owner->b_buffering )
-            block_FifoPace( p_owner->p_fifo, 10, SIZE_MAX );
+            block_FifoPace( p_fifo, 10, SIZE_MAX );
     }
 #ifdef __arm__
-    else if( block_FifoSize( p_owner->p_fifo ) > 50*1024*1024 /* 50 MiB */ )
+    else if( block_FifoSize( p_fifo ) > 50*1024*1024 /* 50 MiB */ )
 #else
-    else if( block_FifoSize( p_owner->p_fifo ) > 400*1024*1024 /* 400 MiB, ie ~ 50mb/s for 60s */ )
+    else if( block_FifoSize( p_fifo ) > 400*1024*1024 /* 400 MiB, ie ~ 50mb/s for 60s */ )
 #endif
     {
         /* FIXME: ideally we would check the time amount of data
          * in the FIFO instead of its size. */
         msg_Warn( p_dec, "decoder/packetizer fifo full (data not "
                   "consumed quickly enough), resetting fifo!" );
-        block_FifoEmpty( p_owner->p_fifo );
+        block_FifoEmpty( p_fifo );
     }
 
-    block_FifoPut( p_owner->p_fifo, p_block );
+    block_FifoPut( p_fifo, p_block );
 }
 
 bool input_DecoderIsEmpty( decoder_t * p_dec )
@@ -421,6 +457,9 @@ bool input_DecoderIsEmpty( decoder_t * p_dec )
     assert( !p_owner->b_buffering );
 
     bool b_empty = block_FifoCount( p_dec->p_owner->p_fifo ) <= 0;
+    if( p_owner->b_packetizer_thread
+     && block_FifoCount( p_owner->p_packetizer_fifo ) > 0 )
+        b_empty = false;
     if( b_empty )
     {
         vlc_mutex_lock( &p_owner->lock );
@@ -662,8 +701,11 @@ bool input_DecoderHasFormatChanged( decoder_t *p_dec, es_format_t *p_fmt, vlc_me
 size_t input_DecoderGetFifoSize( decoder_t *p_dec )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    size_t i_size = block_FifoSize( p_owner->p_fifo );
 
-    return block_FifoSize( p_owner->p_fifo );
+    if( p_owner->b_packetizer_thread )
+        i_size += block_FifoSize( p_owner->p_packetizer_fifo );
+    return i_size;
 }
 
 void input_DecoderGetObjects( decoder_t *p_dec,
@@ -700,6 +742,10 @@ static mtime_t DecoderGetDisplayDate( decoder_t *p_dec, mtime_t i_ts )
     vlc_mutex_lock( &p_owner->lock );
     if( p_owner->b_buffering || p_owner->b_paused )
         i_ts = VLC_TS_INVALID;
+
+    /* The picture must reach the video output soon enough to be filtered
+     * and rendered */
+    const mtime_t i_latency = p_owner->p_vout ? vout_GetDisplayLatency( p_owner->p_vout ) : 0;
     vlc_mutex_unlock( &p_owner->lock );
 
     if( !p_owner->p_clock || i_ts <= VLC_TS_INVALID )
@@ -708,7 +754,7 @@ static mtime_t DecoderGetDisplayDate( decoder_t *p_dec, mtime_t i_ts )
     if( input_clock_ConvertTS( p_owner->p_clock, NULL, &i_ts, NULL, INT64_MAX ) )
         return VLC_TS_INVALID;
 
-    return i_ts;
+    return i_ts - i_latency;
 }
 static int DecoderGetDisplayRate( decoder_t *p_dec )
 {
@@ -760,6 +806,7 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_dec->pf_decode_sub = NULL;
     p_dec->pf_get_cc = NULL;
     p_dec->pf_packetize = NULL;
+    p_dec->i_extra_picture_buffers = 0;
 
     /* Initialize the decoder */
     p_dec->p_module = NULL;
@@ -791,6 +838,9 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->p_sout_input = NULL;
     p_owner->p_packetizer = NULL;
     p_owner->b_packetizer = b_packetizer;
+    p_owner->b_packetizer_thread = false;
+    p_owner->p_packetizer_fifo = NULL;
+    p_owner->p_packetizer_fmt = NULL;
 
     /* decoder fifo */
     p_owner->p_fifo = block_FifoNew();
@@ -848,6 +898,15 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
         }
     }
 
+    /* Move the packetizer to its own thread if requested */
+    if( ( b_packetizer || p_owner->p_packetizer ) &&
+        ( fmt->i_cat == VIDEO_ES || fmt->i_cat == AUDIO_ES ) &&
+        var_InheritBool( p_dec, "packetizer-thread" ) )
+    {
+        p_owner->p_packetizer_fifo = block_FifoNew();
+        p_owner->b_packetizer_thread = p_owner->p_packetizer_fifo != NULL;
+    }
+
     /* Copy ourself the input replay gain */
     if( fmt->i_cat == AUDIO_ES )
     {
@@ -965,7 +1024,9 @@ static void DecoderFlush( decoder_t *p_dec )
 
     vlc_assert_locked( &p_owner->lock );
 
-    /* Empty the fifo */
+    /* Empty the fifos */
+    if( p_owner->b_packetizer_thread )
+        block_FifoEmpty( p_owner->p_packetizer_fifo );
     block_FifoEmpty( p_owner->p_fifo );
 
     /* Monitor for flush end */
@@ -1790,6 +1851,37 @@ static void DecoderFlushBuffering( decoder_t *p_dec )
 }
 
 #ifdef ENABLE_SOUT
+/* This function creates the sout input from the packetizer output format
+ */
+static int DecoderSoutInputNew( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = (decoder_owner_sys_t *)p_dec->p_owner;
+
+    es_format_Copy( &p_owner->sout, &p_dec->fmt_out );
+
+    p_owner->sout.i_group = p_dec->fmt_in.i_group;
+    p_owner->sout.i_id = p_dec->fmt_in.i_id;
+    if( p_dec->fmt_in.psz_language )
+    {
+        free( p_owner->sout.psz_language );
+        p_owner->sout.psz_language =
+            strdup( p_dec->fmt_in.psz_language );
+    }
+
+    p_owner->p_sout_input =
+        sout_InputNew( p_owner->p_sout,
+                       &p_owner->sout );
+
+    if( p_owner->p_sout_input == NULL )
+    {
+        msg_Err( p_dec, "cannot create packetizer output (%4.4s)",
+                 (char *)&p_owner->sout.i_codec );
+        p_dec->b_error = true;
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
 /* This function process a block for sout
  */
 static void DecoderProcessSout( decoder_t *p_dec, block_t *p_block )
@@ -1803,27 +1895,8 @@ static void DecoderProcessSout( decoder_t *p_dec, block_t *p_block )
     {
         if( !p_owner->p_sout_input )
         {
-            es_format_Copy( &p_owner->sout, &p_dec->fmt_out );
-
-            p_owner->sout.i_group = p_dec->fmt_in.i_group;
-            p_owner->sout.i_id = p_dec->fmt_in.i_id;
-            if( p_dec->fmt_in.psz_language )
-            {
-                free( p_owner->sout.psz_language );
-                p_owner->sout.psz_language =
-                    strdup( p_dec->fmt_in.psz_language );
-            }
-
-            p_owner->p_sout_input =
-                sout_InputNew( p_owner->p_sout,
-                               &p_owner->sout );
-
-            if( p_owner->p_sout_input == NULL )
+            if( DecoderSoutInputNew( p_dec ) )
             {
-                msg_Err( p_dec, "cannot create packetizer output (%4.4s)",
-                         (char *)&p_owner->sout.i_codec );
-                p_dec->b_error = true;
-
                 while( p_sout_block )
                 {
                     block_t *p_next = p_sout_block->p_next;
@@ -1854,7 +1927,7 @@ static void DecoderProcessVideo( decoder_t *p_dec, block_t *p_block, bool b_flus
 {
     decoder_owner_sys_t *p_owner = (decoder_owner_sys_t *)p_dec->p_owner;
 
-    if( p_owner->p_packetizer )
+    if( p_owner->p_packetizer && !p_owner->b_packetizer_thread )
     {
         block_t *p_packetized_block;
         decoder_t *p_packetizer = p_owner->p_packetizer;
@@ -1904,7 +1977,7 @@ static void DecoderProcessAudio( decoder_t *p_dec, block_t *p_block, bool b_flus
 {
     decoder_owner_sys_t *p_owner = (decoder_owner_sys_t *)p_dec->p_owner;
 
-    if( p_owner->p_packetizer )
+    if( p_owner->p_packetizer && !p_owner->b_packetizer_thread )
     {
         block_t *p_packetized_block;
         decoder_t *p_packetizer = p_owner->p_packetizer;
@@ -2018,6 +2091,48 @@ static void DecoderProcessOnFlush( decoder_t *p_dec )
     vlc_mutex_unlock( &p_owner->lock );
 }
 
+/* Hands the packetizer output format over to the decoder thread */
+static void DecoderSetPacketizerFormat( decoder_t *p_dec,
+                                        const es_format_t *p_fmt )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    es_format_t *p_copy = malloc( sizeof(*p_copy) );
+
+    if( unlikely(p_copy == NULL) )
+        return;
+    es_format_Copy( p_copy, p_fmt );
+
+    vlc_mutex_lock( &p_owner->lock );
+    if( p_owner->p_packetizer_fmt )
+    {
+        es_format_Clean( p_owner->p_packetizer_fmt );
+        free( p_owner->p_packetizer_fmt );
+    }
+    p_owner->p_packetizer_fmt = p_copy;
+    vlc_mutex_unlock( &p_owner->lock );
+}
+
+/* Applies the format set by the packetizer thread, from the decoder thread */
+static void DecoderUpdatePacketizerFormat( decoder_t *p_dec )
+{
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+
+    vlc_mutex_lock( &p_owner->lock );
+    es_format_t *p_fmt = p_owner->p_packetizer_fmt;
+    p_owner->p_packetizer_fmt = NULL;
+    vlc_mutex_unlock( &p_owner->lock );
+
+    if( !p_fmt )
+        return;
+    if( !p_dec->fmt_in.i_extra )
+    {
+        es_format_Clean( &p_dec->fmt_in );
+        es_format_Copy( &p_dec->fmt_in, p_fmt );
+    }
+    es_format_Clean( p_fmt );
+    free( p_fmt );
+}
+
 /**
  * Decode a block
  *
@@ -2043,13 +2158,21 @@ static void DecoderProcess( decoder_t *p_dec, block_t *p_block )
         if( p_block )
             p_block->i_flags &= ~BLOCK_FLAG_CORE_PRIVATE_MASK;
 
-        DecoderProcessSout( p_dec, p_block );
+        if( !p_owner->b_packetizer_thread )
+            DecoderProcessSout( p_dec, p_block );
+        else if( b_flush_request )
+            block_Release( p_block );
+        else if( p_block ) /* No packetizer thread for teletext */
+            DecoderPlaySout( p_dec, p_block, false );
     }
     else
 #endif
     {
         bool b_flush = false;
 
+        if( p_owner->b_packetizer_thread )
+            DecoderUpdatePacketizerFormat( p_dec );
+
         if( p_block )
         {
             const bool b_flushing = p_owner->i_preroll_end == INT64_MAX;
@@ -2096,6 +2219,100 @@ static void DecoderError( decoder_t *p_dec, block_t *p_block )
         DecoderProcessOnFlush( p_dec );
 }
 
+/**
+ * The packetizer main loop, when the packetizer runs in its own thread.
+ *
+ * It packetizes the blocks queued by input_DecoderDecode() and queues the
+ * packetized blocks for the decoder thread, which then decodes them or sends
+ * them to the stream output.
+ *
+ * \param p_dec the decoder
+ */
+static void *DecoderPacketizerThread( void *p_data )
+{
+    decoder_t *p_dec = (decoder_t *)p_data;
+    decoder_owner_sys_t *p_owner = p_dec->p_owner;
+    /* With stream output, the decoder is the packetizer itself */
+    const bool b_sout = p_owner->b_packetizer;
+    decoder_t *p_packetizer = b_sout ? p_dec : p_owner->p_packetizer;
+    const bool b_cc = !b_sout && p_dec->fmt_in.i_cat == VIDEO_ES &&
+                      p_packetizer->pf_get_cc != NULL;
+    bool b_extra = b_sout || p_dec->fmt_in.i_extra > 0;
+    bool b_error = false;
+    int i_flags = 0;
+
+    for( ;; )
+    {
+        block_t *p_block = block_FifoGet( p_owner->p_packetizer_fifo );
+        if( !p_block )
+            continue;
+
+        int canc = vlc_savecancel();
+        block_t *p_flush = NULL;
+        block_t *p_chain = NULL;
+        block_t **pp_chain_last = &p_chain;
+
+        if( p_block->i_flags & BLOCK_FLAG_CORE_FLUSH )
+        {
+            /* The flush request itself is forwarded to the decoder thread,
+             * the packetizer only gets a copy of it */
+            p_flush = p_block;
+            p_block = block_Duplicate( p_flush );
+            i_flags = 0;
+        }
+        else if( !b_sout )
+        {
+            /* The packetizer does not always propagate those flags */
+            i_flags |= p_block->i_flags &
+                       (BLOCK_FLAG_PREROLL|BLOCK_FLAG_DISCONTINUITY);
+        }
+        if( p_block && p_block->i_buffer <= 0 )
+        {
+            block_Release( p_block );
+            p_block = NULL;
+        }
+        if( p_block )
+            p_block->i_flags &= ~BLOCK_FLAG_CORE_PRIVATE_MASK;
+
+        block_t *p_packetized_block;
+        while( !b_error && (p_packetized_block =
+               p_packetizer->pf_packetize( p_packetizer,
+                                           p_block ? &p_block : NULL )) )
+        {
+#ifdef ENABLE_SOUT
+            if( b_sout && !p_owner->p_sout_input &&
+                DecoderSoutInputNew( p_dec ) )
+            {
+                block_ChainRelease( p_packetized_block );
+                b_error = true;
+                break;
+            }
+#endif
+            if( !b_extra && p_packetizer->fmt_out.i_extra )
+            {
+                DecoderSetPacketizerFormat( p_dec, &p_packetizer->fmt_out );
+                b_extra = true;
+            }
+            if( b_cc )
+                DecoderGetCc( p_dec, p_packetizer );
+
+            p_packetized_block->i_flags |= i_flags;
+            i_flags = 0;
+            block_ChainLastAppend( &pp_chain_last, p_packetized_block );
+        }
+        if( b_error && p_block )
+            block_Release( p_block );
+        if( p_flush )
+            block_ChainLastAppend( &pp_chain_last, p_flush );
+
+        block_FifoPut( p_owner->p_fifo, p_chain );
+        vlc_restorecancel( canc );
+
+        block_FifoPace( p_owner->p_fifo, DECODER_PACKETIZER_FIFO_DEPTH,
+                        SIZE_MAX );
+    }
+    return NULL;
+}
 
 /**
  * Destroys a decoder object
@@ -2114,6 +2331,16 @@ static void DeleteDecoder( decoder_t * p_dec )
     /* Free all packets still in the decoder fifo. */
     block_FifoEmpty( p_owner->p_fifo );
     block_FifoRelease( p_owner->p_fifo );
+    if( p_owner->p_packetizer_fifo )
+    {
+        block_FifoEmpty( p_owner->p_packetizer_fifo );
+        block_FifoRelease( p_owner->p_packetizer_fifo );
+    }
+    if( p_owner->p_packetizer_fmt )
+    {
+        es_format_Clean( p_owner->p_packetizer_fmt );
+        free( p_owner->p_packetizer_fmt );
+    }
 
     /* */
     vlc_mutex_lock( &p_owner->lock );
@@ -2426,7 +2653,9 @@ static picture_t *vout_new_buffer( decoder_t *p_dec )
         }
         p_vout = input_resource_RequestVout( p_owner->p_resource,
                                              p_vout, &fmt,
-                                             dpb_size + 1 + DECODER_MAX_BUFFERING_COUNT,
+                                             dpb_size +
+                                             p_dec->i_extra_picture_buffers +
+                                             1 + DECODER_MAX_BUFFERING_COUNT,
                                              true );
         vlc_mutex_lock( &p_owner->lock );
         p_owner->p_vout = p_vout;
@@ -152,6 +152,7 @@ struct es_out_sys_t
     mtime_t     i_pts_delay;
     mtime_t     i_pts_jitter;
     int         i_cr_average;
+    int         i_clock_recovery;
     int         i_rate;
 
     /* */
@@ -317,6 +318,7 @@ es_out_t *input_EsOutNew( input_thread_t *p_input, int i_rate )
     p_sys->i_pts_delay = 0;
     p_sys->i_pts_jitter = 0;
     p_sys->i_cr_average = 0;
+    p_sys->i_clock_recovery = var_GetInteger( p_input, "clock-recovery" );
 
     p_sys->b_buffering = true;
     p_sys->i_buffering_extra_initial = 0;
@@ -727,6 +729,27 @@ static void EsOutDecodersChangePause( es_out_t *out, bool b_paused, mtime_t i_da
     }
 }
 
+static void EsOutUpdateClockStats( es_out_t *out )
+{
+    es_out_sys_t   *p_sys = out->p_sys;
+    input_thread_t *p_input = p_sys->p_input;
+    mtime_t i_drift, i_jitter, i_buffering;
+
+    if( !libvlc_stats( p_input ) ||
+        input_clock_GetStats( p_sys->p_pgrm->p_clock,
+                              &i_drift, &i_jitter, &i_buffering ) )
+        return;
+
+    vlc_mutex_lock( &p_input->p->counters.counters_lock );
+    stats_UpdateInteger( p_input, p_input->p->counters.p_clock_drift,
+                         i_drift, NULL );
+    stats_UpdateInteger( p_input, p_input->p->counters.p_clock_jitter,
+                         i_jitter, NULL );
+    stats_UpdateInteger( p_input, p_input->p->counters.p_clock_buffering,
+                         i_buffering, NULL );
+    vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+}
+
 static bool EsOutIsExtraBufferingAllowed( es_out_t *out )
 {
     es_out_sys_t *p_sys = out->p_sys;
@@ -1072,7 +1095,7 @@ static es_out_pgrm_t *EsOutProgramAdd( es_out_t *out, int i_group )
     p_pgrm->psz_name = NULL;
     p_pgrm->psz_now_playing = NULL;
     p_pgrm->psz_publisher = NULL;
-    p_pgrm->p_clock = input_clock_New( p_sys->i_rate );
+    p_pgrm->p_clock = input_clock_New( p_sys->i_rate, p_sys->i_clock_recovery );
     if( !p_pgrm->p_clock )
     {
         free( p_pgrm );
@@ -2333,6 +2356,8 @@ static int EsOutControlLocked( es_out_t *out, int i_query, va_list args )
 
             if( p_pgrm == p_sys->p_pgrm )
             {
+                EsOutUpdateClockStats( out );
+
                 if( p_sys->b_buffering )
                 {
                     /* Check buffering state on master clock update */
@@ -37,6 +37,13 @@
 #ifdef HAVE_SYS_STAT_H
 #   include <sys/stat.h>
 #endif
+#ifdef HAVE_UNISTD_H
+#   include <unistd.h>
+#endif
+#include <fcntl.h>
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_fs.h>
@@ -54,6 +61,12 @@
  * Local prototypes
  *****************************************************************************/
 
+/* The blocks are written into a shared mapping of the storage files, whose
+ * space is reserved beforehand (writing in the mapping cannot fail then) */
+#if defined(HAVE_MMAP) && defined(HAVE_POSIX_FALLOCATE)
+#   define TS_STORAGE_MMAP 1
+#endif
+
 /* XXX attribute_packed is (and MUST be) used ONLY to reduce memory usage */
 #ifdef HAVE_ATTRIBUTE_PACKED
 #   define attribute_packed __attribute__((__packed__))
@@ -67,6 +80,7 @@ enum
     C_SEND,
     C_DEL,
     C_CONTROL,
+    C_NONE,     /* Already executed, and not replayable */
 };
 
 typedef struct attribute_packed
@@ -85,6 +99,7 @@ typedef struct attribute_packed
     es_out_id_t *p_es;
     block_t *p_block;
     int     i_offset;  /* We do not use file > INT_MAX */
+    bool    b_played;  /* Popped at least once */
 } ts_cmd_send_t;
 
 typedef struct attribute_packed
@@ -155,6 +170,7 @@ typedef struct ts_storage_t ts_storage_t;
 struct ts_storage_t
 {
     ts_storage_t *p_next;
+    int64_t      i_seq;     /* Order of the storage in the chain */
 
     /* */
     char    *psz_file;  /* Filename */
@@ -162,6 +178,10 @@ struct ts_storage_t
     int64_t i_file_size;/* Current size in bytes */
     FILE    *p_filew;   /* FILE handle for data writing */
     FILE    *p_filer;   /* FILE handle for data reading */
+#ifdef TS_STORAGE_MMAP
+    uint8_t *p_map;     /* Shared mapping of the file being written */
+    block_t *p_map_r;   /* Private mapping of the complete file */
+#endif
 
     /* */
     int      i_cmd_r;
@@ -170,12 +190,24 @@ struct ts_storage_t
     ts_cmd_t *p_cmd;
 };
 
+/* Random access point of the timeshift buffer */
+typedef struct
+{
+    mtime_t      i_date;
+    ts_storage_t *p_storage;
+    int          i_cmd;
+} ts_index_t;
+
+/* Minimal spacing between two random access points */
+#define TS_INDEX_SPACING (CLOCK_FREQ/10)
+
 typedef struct
 {
     vlc_thread_t   thread;
     input_thread_t *p_input;
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
+    int64_t        i_window_max;
     const char     *psz_tmp_path;
 
     /* Lock for all following fields */
@@ -195,11 +227,29 @@ typedef struct
     /* */
     mtime_t        i_buffering_delay;
 
-    /* */
+    /* The storages from p_storage_first to p_storage_r are kept once played,
+     * so that the commands sent and the clock can be replayed */
+    ts_storage_t   *p_storage_first;
     ts_storage_t   *p_storage_r;
     ts_storage_t   *p_storage_w;
+    int64_t        i_storage_seq;
 
     mtime_t        i_cmd_delay;
+    mtime_t        i_cmd_date;      /* Date of the last command played */
+    int            i_seek;          /* Incremented on each seek */
+
+    /* Pending seek: the ES commands skipped, then the flush, are run by the
+     * thread in order with the command it may be executing */
+    bool           b_seek_flush;
+    int            i_seek_cmd;
+    int            i_seek_cmd_max;
+    ts_cmd_t       *p_seek_cmd;
+
+    /* Random access points, in storage order */
+    int            i_index;
+    int            i_index_max;
+    ts_index_t     *p_index;
+    bool           b_index_keyframe;
 
 } ts_thread_t;
 
@@ -215,6 +265,7 @@ struct es_out_sys_t
 
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
+    int64_t        i_window_max;      /* Maximal size of all the files in byte */
     char           *psz_tmp_path;     /* Path for temporary files */
 
     /* Lock for all following fields */
@@ -251,18 +302,34 @@ static bool         TsHasCmd( ts_thread_t * );
 static bool         TsIsUnused( ts_thread_t * );
 static int          TsChangePause( ts_thread_t *, bool b_source_paused, bool b_paused, mtime_t i_date );
 static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
+static int          TsChangeTime( ts_thread_t *, mtime_t i_delta );
+static void         TsSeekLocked( ts_thread_t *, const ts_index_t * );
+static void         TsSeekFlushLocked( ts_thread_t * );
+static void         TsCutLocked( ts_thread_t * );
+static void         TsDropLocked( ts_thread_t * );
+static void         TsIndexLocked( ts_thread_t *, ts_storage_t *, int i_cmd, bool b_keyframe );
+static void         TsIndexRemoveLocked( ts_thread_t *, const ts_storage_t *, int i_cmd );
 
 static void         *TsRun( void * );
 
-static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max );
+static ts_storage_t *TsStorageNew( const char *psz_path, int64_t i_tmp_size_max, int64_t i_seq );
 static void         TsStorageDelete( ts_storage_t * );
 static void         TsStoragePack( ts_storage_t *p_storage );
 static bool         TsStorageIsFull( ts_storage_t *, const ts_cmd_t *p_cmd );
 static bool         TsStorageIsEmpty( ts_storage_t * );
 static void         TsStoragePushCmd( ts_storage_t *, const ts_cmd_t *p_cmd, bool b_flush );
 static void         TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_flush );
+static void         BlockCopyProperties( block_t *, const block_t * );
+#ifdef TS_STORAGE_MMAP
+static void         TsStorageMap( ts_storage_t * );
+static void         TsStorageUnmap( ts_storage_t * );
+static void         TsStorageRemap( ts_storage_t * );
+static block_t      *TsStorageMapBlock( ts_storage_t *, int i_offset );
+#endif
 
 static void CmdClean( ts_cmd_t * );
+static bool CmdIsReplayable( const ts_cmd_t * );
+static void CmdExecute( es_out_t *, ts_cmd_t * );
 static void cmd_cleanup_routine( void *p ) { CmdClean( p ); }
 
 static int  CmdInitAdd    ( ts_cmd_t *, es_out_id_t *, const es_format_t *, bool b_copy );
@@ -331,11 +398,17 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     else
         p_sys->i_tmp_size_max = __MAX( i_tmp_size_max, 1*1024*1024 );
 
+    /* Keep at least two files, so that the one being read is not dropped */
+    const int64_t i_window_max = var_CreateGetInteger( p_input, "input-timeshift-size" );
+    p_sys->i_window_max = __MAX( i_window_max * 1024 * 1024,
+                                 2 * p_sys->i_tmp_size_max );
+
     char *psz_tmp_path = var_CreateGetNonEmptyString( p_input, "input-timeshift-path" );
     p_sys->psz_tmp_path = GetTmpPath( psz_tmp_path );
 
-    msg_Dbg( p_input, "using timeshift granularity of %d MiB, in path '%s'",
-             (int)p_sys->i_tmp_size_max/(1024*1024), p_sys->psz_tmp_path );
+    msg_Dbg( p_input, "using timeshift granularity of %d MiB and size of %d MiB, in path '%s'",
+             (int)(p_sys->i_tmp_size_max/(1024*1024)),
+             (int)(p_sys->i_window_max/(1024*1024)), p_sys->psz_tmp_path );
 
 #if 0
 #define S(t) msg_Err( p_input, "SIZEOF("#t")=%d", sizeof(t) )
@@ -558,11 +631,22 @@ static int ControlLockedSetTime( es_out_t *p_out, mtime_t i_date )
     es_out_sys_t *p_sys = p_out->p_sys;
 
     if( !p_sys->b_delayed )
+    {
+        /* Nothing was buffered to seek into */
+        if( i_date >= 0 )
+            return VLC_EGENERIC;
         return es_out_SetTime( p_sys->p_out, i_date );
+    }
 
-    /* TODO */
-    msg_Err( p_sys->p_input, "EsOutTimeshift does not yet support time change" );
-    return VLC_EGENERIC;
+    if( i_date < 0 )
+    {
+        /* TODO */
+        msg_Err( p_sys->p_input, "EsOutTimeshift does not yet support time change" );
+        return VLC_EGENERIC;
+    }
+
+    /* The input time is the one of the commands being played */
+    return TsChangeTime( p_sys->p_ts, i_date - var_GetTime( p_sys->p_input, "time" ) );
 }
 static int ControlLockedSetFrameNext( es_out_t *p_out )
 {
@@ -741,6 +825,7 @@ static int TsStart( es_out_t *p_out )
         return VLC_EGENERIC;
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
+    p_ts->i_window_max = p_sys->i_window_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
@@ -754,8 +839,20 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_rate_delay = 0;
     p_ts->i_buffering_delay = 0;
     p_ts->i_cmd_delay = 0;
+    p_ts->i_cmd_date = -1;
+    p_ts->i_seek = 0;
+    p_ts->b_seek_flush = false;
+    p_ts->i_seek_cmd = 0;
+    p_ts->i_seek_cmd_max = 0;
+    p_ts->p_seek_cmd = NULL;
+    p_ts->p_storage_first = NULL;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
+    p_ts->i_storage_seq = 0;
+    p_ts->i_index = 0;
+    p_ts->i_index_max = 0;
+    p_ts->p_index = NULL;
+    p_ts->b_index_keyframe = false;
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts, VLC_THREAD_PRIORITY_INPUT ) )
@@ -797,9 +894,18 @@ static void TsStop( ts_thread_t *p_ts )
 
         CmdClean( &cmd );
     }
+    for( int i = 0; i < p_ts->i_seek_cmd; i++ )
+        CmdClean( &p_ts->p_seek_cmd[i] );
+    free( p_ts->p_seek_cmd );
     assert( !p_ts->p_storage_r || !p_ts->p_storage_r->p_next );
-    if( p_ts->p_storage_r )
-        TsStorageDelete( p_ts->p_storage_r );
+    while( p_ts->p_storage_first )
+    {
+        ts_storage_t *p_next = p_ts->p_storage_first->p_next;
+
+        TsStorageDelete( p_ts->p_storage_first );
+        p_ts->p_storage_first = p_next;
+    }
+    free( p_ts->p_index );
     vlc_mutex_unlock( &p_ts->lock );
 
     TsDestroy( p_ts );
@@ -810,7 +916,8 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 
     if( !p_ts->p_storage_w || TsStorageIsFull( p_ts->p_storage_w, p_cmd ) )
     {
-        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max );
+        ts_storage_t *p_storage = TsStorageNew( p_ts->psz_tmp_path, p_ts->i_tmp_size_max,
+                                                p_ts->i_storage_seq++ );
 
         if( !p_storage )
         {
@@ -822,6 +929,7 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 
         if( !p_ts->p_storage_w )
         {
+            p_ts->p_storage_first =
             p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
         }
         else
@@ -832,8 +940,17 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
         }
     }
 
+    ts_storage_t *p_storage = p_ts->p_storage_w;
+    const int i_cmd = p_storage->i_cmd_w;
+    const bool b_keyframe = p_cmd->i_type == C_SEND &&
+                            ( p_cmd->u.send.p_block->i_flags & BLOCK_FLAG_TYPE_I );
+
     /* TODO return error and warn the user (but only once) */
-    TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
+    TsStoragePushCmd( p_storage, p_cmd, p_ts->p_storage_r == p_storage );
+
+    if( p_storage->i_cmd_w > i_cmd )
+        TsIndexLocked( p_ts, p_storage, i_cmd, b_keyframe );
+    TsDropLocked( p_ts );
 
     vlc_cond_signal( &p_ts->wait );
 
@@ -843,22 +960,33 @@ static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
 {
     vlc_assert_locked( &p_ts->lock );
 
-    if( TsStorageIsEmpty( p_ts->p_storage_r ) )
-        return VLC_EGENERIC;
+    for( ;; )
+    {
+        ts_storage_t *p_storage = p_ts->p_storage_r;
 
-    TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
+        if( TsStorageIsEmpty( p_storage ) )
+            return VLC_EGENERIC;
 
-    while( p_ts->p_storage_r && TsStorageIsEmpty( p_ts->p_storage_r ) )
-    {
-        ts_storage_t *p_next = p_ts->p_storage_r->p_next;
-        if( !p_next )
-            break;
+        ts_cmd_t *p_stored = &p_storage->p_cmd[p_storage->i_cmd_r];
+        TsStoragePopCmd( p_storage, p_cmd, b_flush );
 
-        TsStorageDelete( p_ts->p_storage_r );
-        p_ts->p_storage_r = p_next;
-    }
+        /* Only the played commands that can be replayed are kept */
+        if( !CmdIsReplayable( p_stored ) )
+            p_stored->i_type = C_NONE;
 
-    return VLC_SUCCESS;
+        while( TsStorageIsEmpty( p_ts->p_storage_r ) && p_ts->p_storage_r->p_next )
+            p_ts->p_storage_r = p_ts->p_storage_r->p_next;
+
+        /* The commands played before an ES change cannot be replayed */
+        if( p_cmd->i_type == C_ADD || p_cmd->i_type == C_DEL )
+            TsCutLocked( p_ts );
+
+        if( p_cmd->i_type != C_NONE )
+        {
+            p_ts->i_cmd_date = p_cmd->i_date;
+            return VLC_SUCCESS;
+        }
+    }
 }
 static bool TsHasCmd( ts_thread_t *p_ts )
 {
@@ -875,7 +1003,7 @@ static bool TsIsUnused( ts_thread_t *p_ts )
     bool b_unused;
 
     vlc_mutex_lock( &p_ts->lock );
-    b_unused = !p_ts->b_paused &&
+    b_unused = !p_ts->b_paused && !p_ts->b_seek_flush &&
                p_ts->i_rate == p_ts->i_rate_source &&
                TsStorageIsEmpty( p_ts->p_storage_r );
     vlc_mutex_unlock( &p_ts->lock );
@@ -931,6 +1059,262 @@ static int TsChangeRate( ts_thread_t *p_ts, int i_src_rate, int i_rate )
 
     return i_ret;
 }
+static int TsChangeTime( ts_thread_t *p_ts, mtime_t i_delta )
+{
+    vlc_mutex_lock( &p_ts->lock );
+
+    if( p_ts->i_index <= 0 || p_ts->i_cmd_date < 0 )
+    {
+        vlc_mutex_unlock( &p_ts->lock );
+        return VLC_EGENERIC;
+    }
+
+    /* Find the last random access point at or before the target, the
+     * buffer bounds are used beyond them */
+    const mtime_t i_date = p_ts->i_cmd_date + i_delta;
+    int i_low = 0;
+    int i_high = p_ts->i_index - 1;
+    while( i_low < i_high )
+    {
+        const int i_mid = ( i_low + i_high + 1 ) / 2;
+
+        if( p_ts->p_index[i_mid].i_date <= i_date )
+            i_low = i_mid;
+        else
+            i_high = i_mid - 1;
+    }
+    const ts_index_t point = p_ts->p_index[i_low];
+
+    /* Do not go backward when seeking forward, and reciprocally */
+    const ts_storage_t *p_r = p_ts->p_storage_r;
+    const bool b_forward = point.p_storage->i_seq > p_r->i_seq ||
+                           ( point.p_storage == p_r && point.i_cmd >= p_r->i_cmd_r );
+    if( b_forward != ( i_delta > 0 ) )
+    {
+        vlc_mutex_unlock( &p_ts->lock );
+        return VLC_EGENERIC;
+    }
+
+    msg_Dbg( p_ts->p_input, "es out timeshift: seeking by %"PRId64" ms",
+             ( point.i_date - p_ts->i_cmd_date ) / 1000 );
+    TsSeekLocked( p_ts, &point );
+
+    vlc_mutex_unlock( &p_ts->lock );
+    return VLC_SUCCESS;
+}
+
+/* Moves the read position to the given command.
+ *
+ * Going forward, the commands skipped that alter the ES are still executed.
+ * Going backward, the sent blocks and the clock updates are played again.
+ * The execution and the flush are left to the timeshift thread, as it may
+ * be running a command popped before the seek. */
+static void TsSeekLocked( ts_thread_t *p_ts, const ts_index_t *p_target )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    ts_storage_t *p_r = p_ts->p_storage_r;
+    ts_storage_t *p_target_storage = p_target->p_storage;
+    bool b_cut = false;
+
+    if( p_target_storage->i_seq < p_r->i_seq ||
+        ( p_target_storage == p_r && p_target->i_cmd < p_r->i_cmd_r ) )
+    {
+        for( ts_storage_t *p = p_target_storage; p != p_r; p = p->p_next )
+            p->p_next->i_cmd_r = 0;
+    }
+    else
+    {
+        for( ts_storage_t *p = p_r; ; p = p->p_next )
+        {
+            const int i_end = p == p_target_storage ? p_target->i_cmd : p->i_cmd_w;
+
+            while( p->i_cmd_r < i_end )
+            {
+                ts_cmd_t *p_cmd = &p->p_cmd[p->i_cmd_r++];
+
+                if( p_cmd->i_type == C_NONE || CmdIsReplayable( p_cmd ) )
+                    continue;
+
+                if( p_cmd->i_type == C_ADD || p_cmd->i_type == C_DEL )
+                    b_cut = true;
+
+                if( p_ts->i_seek_cmd >= p_ts->i_seek_cmd_max )
+                {
+                    const int i_seek_cmd_max = __MAX( 2 * p_ts->i_seek_cmd_max, 16 );
+                    ts_cmd_t *p_seek_cmd = realloc( p_ts->p_seek_cmd,
+                                                    i_seek_cmd_max * sizeof(*p_seek_cmd) );
+                    if( !p_seek_cmd )
+                    {
+                        CmdClean( p_cmd );
+                        p_cmd->i_type = C_NONE;
+                        continue;
+                    }
+                    p_ts->p_seek_cmd = p_seek_cmd;
+                    p_ts->i_seek_cmd_max = i_seek_cmd_max;
+                }
+                p_ts->p_seek_cmd[p_ts->i_seek_cmd++] = *p_cmd;
+                p_cmd->i_type = C_NONE;
+            }
+            if( p == p_target_storage )
+                break;
+        }
+    }
+    p_target_storage->i_cmd_r = p_target->i_cmd;
+    p_ts->p_storage_r = p_target_storage;
+
+    /* Play the target right now (or on resume) */
+    const mtime_t i_now = p_ts->b_paused ? p_ts->i_pause_date : mdate();
+
+    p_ts->i_cmd_delay = i_now - p_target->i_date - p_ts->i_buffering_delay;
+    p_ts->i_rate_date = -1;
+    p_ts->i_rate_delay = 0;
+    p_ts->i_cmd_date = p_target->i_date;
+    p_ts->i_seek++;
+    p_ts->b_seek_flush = true;
+
+    if( b_cut )
+        TsCutLocked( p_ts );
+
+    vlc_cond_signal( &p_ts->wait );
+}
+
+/* Runs the commands skipped by the last seeks, then flushes the outputs.
+ * It is called by the timeshift thread only, the lock is released meanwhile */
+static void TsSeekFlushLocked( ts_thread_t *p_ts )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    ts_cmd_t *p_cmd = p_ts->p_seek_cmd;
+    const int i_cmd = p_ts->i_seek_cmd;
+
+    p_ts->b_seek_flush = false;
+    p_ts->i_seek_cmd = 0;
+    p_ts->i_seek_cmd_max = 0;
+    p_ts->p_seek_cmd = NULL;
+    vlc_mutex_unlock( &p_ts->lock );
+
+    for( int i = 0; i < i_cmd; i++ )
+        CmdExecute( p_ts->p_out, &p_cmd[i] );
+    free( p_cmd );
+
+    es_out_SetTime( p_ts->p_out, -1 );
+
+    vlc_mutex_lock( &p_ts->lock );
+}
+
+/* Forgets the commands played before the current one */
+static void TsCutLocked( ts_thread_t *p_ts )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    ts_storage_t *p_r = p_ts->p_storage_r;
+
+    TsIndexRemoveLocked( p_ts, p_r, p_r->i_cmd_r );
+    while( p_ts->p_storage_first != p_r )
+    {
+        ts_storage_t *p_next = p_ts->p_storage_first->p_next;
+
+        TsStorageDelete( p_ts->p_storage_first );
+        p_ts->p_storage_first = p_next;
+    }
+}
+
+/* Drops the oldest storages beyond the timeshift size */
+static void TsDropLocked( ts_thread_t *p_ts )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    while( p_ts->p_storage_first != p_ts->p_storage_w )
+    {
+        ts_storage_t *p_first = p_ts->p_storage_first;
+        int64_t i_size = 0;
+
+        for( ts_storage_t *p = p_first; p; p = p->p_next )
+            i_size += p->i_file_size;
+        if( i_size <= p_ts->i_window_max )
+            break;
+
+        if( p_first == p_ts->p_storage_r )
+        {
+            ts_index_t next = {
+                .p_storage = p_first->p_next,
+                .i_cmd = 0,
+            };
+            if( next.p_storage->i_cmd_w <= 0 )
+                break;
+            next.i_date = next.p_storage->p_cmd[0].i_date;
+
+            /* TODO warn the user (but only once) */
+            msg_Warn( p_ts->p_input, "es out timeshift: buffer full, skipping %d commands",
+                      p_first->i_cmd_w - p_first->i_cmd_r );
+            TsSeekLocked( p_ts, &next );
+        }
+        else
+        {
+            TsIndexRemoveLocked( p_ts, p_first->p_next, 0 );
+            p_ts->p_storage_first = p_first->p_next;
+            TsStorageDelete( p_first );
+        }
+    }
+}
+
+/* Adds the command as random access point if it is a keyframe, or as long
+ * as no keyframe was flagged, if it is a clock reference */
+static void TsIndexLocked( ts_thread_t *p_ts, ts_storage_t *p_storage, int i_cmd, bool b_keyframe )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    const ts_cmd_t *p_cmd = &p_storage->p_cmd[i_cmd];
+
+    if( b_keyframe )
+    {
+        p_ts->b_index_keyframe = true;
+    }
+    else if( p_ts->b_index_keyframe || p_cmd->i_type != C_CONTROL ||
+             ( p_cmd->u.control.i_query != ES_OUT_SET_PCR &&
+               p_cmd->u.control.i_query != ES_OUT_SET_GROUP_PCR ) )
+    {
+        return;
+    }
+
+    if( p_ts->i_index > 0 &&
+        p_cmd->i_date < p_ts->p_index[p_ts->i_index-1].i_date + TS_INDEX_SPACING )
+        return;
+
+    if( p_ts->i_index >= p_ts->i_index_max )
+    {
+        const int i_index_max = __MAX( 2 * p_ts->i_index_max, 256 );
+        ts_index_t *p_index = realloc( p_ts->p_index, i_index_max * sizeof(*p_index) );
+        if( !p_index )
+            return;
+
+        p_ts->p_index = p_index;
+        p_ts->i_index_max = i_index_max;
+    }
+
+    ts_index_t *p_point = &p_ts->p_index[p_ts->i_index++];
+    p_point->i_date = p_cmd->i_date;
+    p_point->p_storage = p_storage;
+    p_point->i_cmd = i_cmd;
+}
+
+/* Removes the random access points before the given command */
+static void TsIndexRemoveLocked( ts_thread_t *p_ts, const ts_storage_t *p_storage, int i_cmd )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    int i = 0;
+    while( i < p_ts->i_index &&
+           ( p_ts->p_index[i].p_storage->i_seq < p_storage->i_seq ||
+             ( p_ts->p_index[i].p_storage == p_storage && p_ts->p_index[i].i_cmd < i_cmd ) ) )
+        i++;
+
+    if( i <= 0 )
+        return;
+    p_ts->i_index -= i;
+    memmove( &p_ts->p_index[0], &p_ts->p_index[i], p_ts->i_index * sizeof(*p_ts->p_index) );
+}
 
 static void *TsRun( void *p_data )
 {
@@ -942,6 +1326,7 @@ static void *TsRun( void *p_data )
         ts_cmd_t cmd;
         mtime_t  i_deadline;
         bool b_buffering;
+        int i_seek;
 
         /* Pop a command to execute */
         vlc_mutex_lock( &p_ts->lock );
@@ -950,8 +1335,12 @@ static void *TsRun( void *p_data )
         for( ;; )
         {
             const int canc = vlc_savecancel();
-            b_buffering = es_out_GetBuffering( p_ts->p_out );
 
+            /* The command executed last was popped before the seek */
+            while( p_ts->b_seek_flush )
+                TsSeekFlushLocked( p_ts );
+
+            b_buffering = es_out_GetBuffering( p_ts->p_out );
             if( ( !p_ts->b_paused || b_buffering ) && !TsPopCmdLocked( p_ts, &cmd, false ) )
             {
                 vlc_restorecancel( canc );
@@ -961,6 +1350,7 @@ static void *TsRun( void *p_data )
 
             vlc_cond_wait( &p_ts->wait, &p_ts->lock );
         }
+        i_seek = p_ts->i_seek;
 
         if( b_buffering && i_buffering_date < 0 )
         {
@@ -1021,29 +1411,17 @@ static void *TsRun( void *p_data )
 
         vlc_cleanup_pop();
 
-        /* Execute the command  */
+        /* Execute the command, unless a seek made it obsolete */
         const int canc = vlc_savecancel();
-        switch( cmd.i_type )
-        {
-        case C_ADD:
-            CmdExecuteAdd( p_ts->p_out, &cmd );
-            CmdCleanAdd( &cmd );
-            break;
-        case C_SEND:
-            CmdExecuteSend( p_ts->p_out, &cmd );
-            CmdCleanSend( &cmd );
-            break;
-        case C_CONTROL:
-            CmdExecuteControl( p_ts->p_out, &cmd );
-            CmdCleanControl( &cmd );
-            break;
-        case C_DEL:
-            CmdExecuteDel( p_ts->p_out, &cmd );
-            break;
-        default:
-            assert(0);
-            break;
-        }
+
+        vlc_mutex_lock( &p_ts->lock );
+        const bool b_obsolete = i_seek != p_ts->i_seek && CmdIsReplayable( &cmd );
+        vlc_mutex_unlock( &p_ts->lock );
+
+        if( b_obsolete )
+            CmdClean( &cmd );
+        else
+            CmdExecute( p_ts->p_out, &cmd );
         vlc_restorecancel( canc );
     }
 
@@ -1053,7 +1431,7 @@ static void *TsRun( void *p_data )
 /*****************************************************************************
  *
  *****************************************************************************/
-static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_max )
+static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_max, int64_t i_seq )
 {
     ts_storage_t *p_storage = calloc( 1, sizeof(ts_storage_t) );
     if( !p_storage )
@@ -1061,6 +1439,7 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
 
     /* */
     p_storage->p_next = NULL;
+    p_storage->i_seq = i_seq;
 
     /* */
     p_storage->i_file_max = i_tmp_size_max;
@@ -1081,6 +1460,9 @@ static ts_storage_t *TsStorageNew( const char *psz_tmp_path, int64_t i_tmp_size_
         TsStorageDelete( p_storage );
         return NULL;
     }
+#ifdef TS_STORAGE_MMAP
+    TsStorageMap( p_storage );
+#endif
     return p_storage;
 }
 static void TsStorageDelete( ts_storage_t *p_storage )
@@ -1095,6 +1477,12 @@ static void TsStorageDelete( ts_storage_t *p_storage )
     }
     free( p_storage->p_cmd );
 
+#ifdef TS_STORAGE_MMAP
+    if( p_storage->p_map )
+        munmap( p_storage->p_map, p_storage->i_file_max );
+    if( p_storage->p_map_r )
+        block_Release( p_storage->p_map_r );
+#endif
     if( p_storage->p_filer )
         fclose( p_storage->p_filer );
     if( p_storage->p_filew )
@@ -1110,6 +1498,10 @@ static void TsStorageDelete( ts_storage_t *p_storage )
 }
 static void TsStoragePack( ts_storage_t *p_storage )
 {
+#ifdef TS_STORAGE_MMAP
+    TsStorageRemap( p_storage );
+#endif
+
     /* Try to release a bit of memory */
     if( p_storage->i_cmd_w >= p_storage->i_cmd_max )
         return;
@@ -1146,6 +1538,30 @@ static void TsStoragePushCmd( ts_storage_t *p_storage, const ts_cmd_t *p_cmd, bo
         block_t *p_block = cmd.u.send.p_block;
 
         cmd.u.send.p_block = NULL;
+        cmd.u.send.b_played = false;
+
+#ifdef TS_STORAGE_MMAP
+        const size_t i_size = sizeof(*p_block) + p_block->i_buffer;
+
+        /* Only a block bigger than the file itself does not fit */
+        if( p_storage->p_map && p_storage->i_file_size + i_size > p_storage->i_file_max )
+            TsStorageUnmap( p_storage );
+
+        if( p_storage->p_map )
+        {
+            uint8_t *p_dst = &p_storage->p_map[p_storage->i_file_size];
+
+            memcpy( p_dst, p_block, sizeof(*p_block) );
+            memcpy( &p_dst[sizeof(*p_block)], p_block->p_buffer, p_block->i_buffer );
+
+            cmd.u.send.i_offset = p_storage->i_file_size;
+            p_storage->i_file_size += i_size;
+            block_Release( p_block );
+
+            p_storage->p_cmd[p_storage->i_cmd_w++] = cmd;
+            return;
+        }
+#endif
         cmd.u.send.i_offset = ftell( p_storage->p_filew );
 
         if( fwrite( p_block, sizeof(*p_block), 1, p_storage->p_filew ) != 1 )
@@ -1179,6 +1595,17 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     {
         block_t block;
 
+        p_storage->p_cmd[p_storage->i_cmd_r-1].u.send.b_played = true;
+#ifdef TS_STORAGE_MMAP
+        /* A block sliced from the private mapping may have been modified by
+         * the decoders, so a replayed one is read back from the file */
+        if( !b_flush && ( p_storage->p_map ||
+                          ( p_storage->p_map_r && !p_cmd->u.send.b_played ) ) )
+        {
+            p_cmd->u.send.p_block = TsStorageMapBlock( p_storage, p_cmd->u.send.i_offset );
+            return;
+        }
+#endif
         if( !b_flush &&
             !fseek( p_storage->p_filer, p_cmd->u.send.i_offset, SEEK_SET ) &&
             fread( &block, sizeof(block), 1, p_storage->p_filer ) == 1 )
@@ -1186,12 +1613,7 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
             block_t *p_block = block_Alloc( block.i_buffer );
             if( p_block )
             {
-                p_block->i_dts      = block.i_dts;
-                p_block->i_pts      = block.i_pts;
-                p_block->i_flags    = block.i_flags;
-                p_block->i_length   = block.i_length;
-                p_block->i_rate     = block.i_rate;
-                p_block->i_nb_samples = block.i_nb_samples;
+                BlockCopyProperties( p_block, &block );
                 p_block->i_buffer = fread( p_block->p_buffer, 1, block.i_buffer, p_storage->p_filer );
             }
             p_cmd->u.send.p_block = p_block;
@@ -1204,6 +1626,90 @@ static void TsStoragePopCmd( ts_storage_t *p_storage, ts_cmd_t *p_cmd, bool b_fl
     }
 }
 
+static void BlockCopyProperties( block_t *p_dst, const block_t *p_src )
+{
+    p_dst->i_dts      = p_src->i_dts;
+    p_dst->i_pts      = p_src->i_pts;
+    p_dst->i_flags    = p_src->i_flags;
+    p_dst->i_length   = p_src->i_length;
+    p_dst->i_rate     = p_src->i_rate;
+    p_dst->i_nb_samples = p_src->i_nb_samples;
+}
+
+#ifdef TS_STORAGE_MMAP
+static void TsStorageMap( ts_storage_t *p_storage )
+{
+    const int fd = fileno( p_storage->p_filew );
+
+    if( posix_fallocate( fd, 0, p_storage->i_file_max ) )
+        return;
+
+    void *p_map = mmap( NULL, p_storage->i_file_max, PROT_READ|PROT_WRITE,
+                        MAP_SHARED, fd, 0 );
+    if( p_map == MAP_FAILED )
+        return;
+#ifdef HAVE_POSIX_MADVISE
+    posix_madvise( p_map, p_storage->i_file_max, POSIX_MADV_SEQUENTIAL );
+#endif
+    p_storage->p_map = p_map;
+}
+/* Falls back to the FILE handles */
+static void TsStorageUnmap( ts_storage_t *p_storage )
+{
+    munmap( p_storage->p_map, p_storage->i_file_max );
+    p_storage->p_map = NULL;
+
+    fseek( p_storage->p_filew, p_storage->i_file_size, SEEK_SET );
+}
+/* Once complete, the file is mapped privately: the blocks read the first
+ * time can then point into it, and be modified by the decoders without
+ * altering the file */
+static void TsStorageRemap( ts_storage_t *p_storage )
+{
+    if( !p_storage->p_map )
+        return;
+
+    const int fd = fileno( p_storage->p_filew );
+    TsStorageUnmap( p_storage );
+
+    /* Release the space reserved but not used */
+    if( ftruncate( fd, p_storage->i_file_size ) || p_storage->i_file_size <= 0 )
+        return;
+
+    void *p_map = mmap( NULL, p_storage->i_file_size, PROT_READ|PROT_WRITE,
+                        MAP_PRIVATE, fd, 0 );
+    if( p_map == MAP_FAILED )
+        return;
+    p_storage->p_map_r = block_mmap_Alloc( p_map, p_storage->i_file_size );
+}
+static block_t *TsStorageMapBlock( ts_storage_t *p_storage, int i_offset )
+{
+    block_t block;
+    block_t *p_block;
+
+    if( p_storage->p_map_r )
+    {
+        memcpy( &block, &p_storage->p_map_r->p_buffer[i_offset], sizeof(block) );
+        p_block = block_mmap_Slice( p_storage->p_map_r, i_offset + sizeof(block),
+                                    block.i_buffer );
+    }
+    else
+    {
+        const uint8_t *p_src = &p_storage->p_map[i_offset];
+
+        /* The file is still being written, its data cannot be shared */
+        memcpy( &block, p_src, sizeof(block) );
+        p_block = block_Alloc( block.i_buffer );
+        if( p_block )
+            memcpy( p_block->p_buffer, &p_src[sizeof(block)], block.i_buffer );
+    }
+
+    if( p_block )
+        BlockCopyProperties( p_block, &block );
+    return p_block;
+}
+#endif
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -1221,6 +1727,57 @@ static void CmdClean( ts_cmd_t *p_cmd )
         CmdCleanControl( p_cmd );
         break;
     case C_DEL:
+    case C_NONE:
+        break;
+    default:
+        assert(0);
+        break;
+    }
+}
+
+/* Sent blocks and clock updates can be played again after a seek back, the
+ * other commands alter the ES and are executed only once */
+static bool CmdIsReplayable( const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type == C_SEND )
+        return true;
+    if( p_cmd->i_type != C_CONTROL )
+        return false;
+
+    switch( p_cmd->u.control.i_query )
+    {
+    case ES_OUT_SET_PCR:
+    case ES_OUT_SET_GROUP_PCR:
+    case ES_OUT_RESET_PCR:
+    case ES_OUT_SET_NEXT_DISPLAY_TIME:
+    case ES_OUT_SET_TIMES:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/* Executes the command and releases its resources */
+static void CmdExecute( es_out_t *p_out, ts_cmd_t *p_cmd )
+{
+    switch( p_cmd->i_type )
+    {
+    case C_ADD:
+        CmdExecuteAdd( p_out, p_cmd );
+        CmdCleanAdd( p_cmd );
+        break;
+    case C_SEND:
+        CmdExecuteSend( p_out, p_cmd );
+        CmdCleanSend( p_cmd );
+        break;
+    case C_CONTROL:
+        CmdExecuteControl( p_out, p_cmd );
+        CmdCleanControl( p_cmd );
+        break;
+    case C_DEL:
+        CmdExecuteDel( p_out, p_cmd );
+        break;
+    case C_NONE:
         break;
     default:
         assert(0);
@@ -0,0 +1,263 @@
+/*****************************************************************************
+ * index_cache.c: persistent cache of demuxer indexes
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef HAVE_UNISTD_H
+# include <unistd.h>
+#endif
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_block.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+
+/*
+ * Each indexed file gets one cache file per demuxer, named after the MD5 of
+ * the demuxer name and the file path, in the "index" user cache directory.
+ * The cache file is made of a header, the demuxer name and file path (to
+ * rule out hash collisions), and the opaque demuxer payload. The payload is
+ * aligned on 8 bytes, so that the demuxer can use it in place once the
+ * cache file is memory mapped.
+ *
+ * The cache is only valid for the same file size and modification time, and
+ * for the same native byte order and format version.
+ */
+#define INDEX_CACHE_MAGIC   "VLCINDEX"
+#define INDEX_CACHE_FORMAT  1
+
+typedef struct
+{
+    char     magic[8];
+    uint32_t i_format;   /* INDEX_CACHE_FORMAT, also catches byte order */
+    uint32_t i_version;  /* Payload version, defined by the demuxer */
+    uint64_t i_size;     /* Size of the indexed file */
+    int64_t  i_mtime;    /* Modification time of the indexed file */
+    uint64_t i_payload;  /* Payload size */
+    uint32_t i_key;      /* Size of the key (name and path) */
+    uint32_t i_reserved;
+} index_cache_header_t;
+
+#define INDEX_CACHE_ALIGN(x) (((x) + 7) & ~(size_t)7)
+
+/* Returns the identity of the file read by the demuxer, if it is cacheable */
+static int IndexCacheStat( demux_t *p_demux, struct stat *p_st )
+{
+    if( !var_InheritBool( p_demux, "demux-index-cache" ) )
+        return VLC_EGENERIC;
+    if( p_demux->psz_file == NULL || p_demux->s == NULL )
+        return VLC_EGENERIC;
+    if( vlc_stat( p_demux->psz_file, p_st ) || !S_ISREG( p_st->st_mode ) )
+        return VLC_EGENERIC;
+
+    /* Make sure that the stream really is this file */
+    if( stream_Size( p_demux->s ) != (uint64_t)p_st->st_size )
+        return VLC_EGENERIC;
+    return VLC_SUCCESS;
+}
+
+static char *IndexCacheKey( demux_t *p_demux, const char *psz_name )
+{
+    char *psz_key;
+
+    if( asprintf( &psz_key, "%s\n%s", psz_name, p_demux->psz_file ) == -1 )
+        return NULL;
+    return psz_key;
+}
+
+static char *IndexCachePath( const char *psz_key, bool b_create )
+{
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    char *psz_dir, *psz_path = NULL;
+
+    if( psz_cachedir == NULL )
+        return NULL;
+    if( asprintf( &psz_dir, "%s" DIR_SEP "index", psz_cachedir ) == -1 )
+        psz_dir = NULL;
+    if( psz_dir != NULL && b_create )
+    {
+        vlc_mkdir( psz_cachedir, 0700 );
+        vlc_mkdir( psz_dir, 0700 );
+    }
+    free( psz_cachedir );
+    if( psz_dir == NULL )
+        return NULL;
+
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, psz_key, strlen( psz_key ) );
+    EndMD5( &md5 );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    if( psz_hash != NULL
+     && asprintf( &psz_path, "%s" DIR_SEP "%s", psz_dir, psz_hash ) == -1 )
+        psz_path = NULL;
+    free( psz_hash );
+    free( psz_dir );
+    return psz_path;
+}
+
+/**
+ * Looks up the index cached for the file being demuxed.
+ *
+ * @param psz_name name of the demuxer, identifying the payload format
+ * @param i_version version of the payload format
+ * @return the payload (memory mapped whenever possible), or NULL if there is
+ * no valid cached index for the current file.
+ */
+block_t *demux_IndexCacheLoad( demux_t *p_demux, const char *psz_name,
+                               uint32_t i_version )
+{
+    struct stat st;
+    if( IndexCacheStat( p_demux, &st ) )
+        return NULL;
+
+    char *psz_key = IndexCacheKey( p_demux, psz_name );
+    if( psz_key == NULL )
+        return NULL;
+
+    block_t *p_block = NULL;
+    char *psz_path = IndexCachePath( psz_key, false );
+    if( psz_path == NULL )
+        goto out;
+
+    int fd = vlc_open( psz_path, O_RDONLY );
+    if( fd == -1 )
+        goto out;
+    p_block = block_File( fd );
+    close( fd );
+    if( p_block == NULL )
+        goto out;
+
+    /* Validate the header */
+    const size_t i_key = strlen( psz_key );
+    const size_t i_offset = sizeof(index_cache_header_t)
+                          + INDEX_CACHE_ALIGN( i_key );
+    index_cache_header_t hdr;
+
+    if( p_block->i_buffer < i_offset )
+        goto invalid;
+    memcpy( &hdr, p_block->p_buffer, sizeof(hdr) );
+    if( memcmp( hdr.magic, INDEX_CACHE_MAGIC, sizeof(hdr.magic) )
+     || hdr.i_format != INDEX_CACHE_FORMAT || hdr.i_version != i_version
+     || hdr.i_size != (uint64_t)st.st_size
+     || hdr.i_mtime != (int64_t)st.st_mtime
+     || hdr.i_key != i_key
+     || memcmp( p_block->p_buffer + sizeof(hdr), psz_key, i_key )
+     || hdr.i_payload != p_block->i_buffer - i_offset )
+        goto invalid;
+
+    msg_Dbg( p_demux, "using cached %s index (%"PRIu64" bytes)", psz_name,
+             hdr.i_payload );
+    p_block->p_buffer += i_offset;
+    p_block->i_buffer = hdr.i_payload;
+    goto out;
+
+invalid:
+    msg_Dbg( p_demux, "discarding stale %s index cache", psz_name );
+    block_Release( p_block );
+    p_block = NULL;
+    vlc_unlink( psz_path );
+out:
+    free( psz_path );
+    free( psz_key );
+    return p_block;
+}
+
+/**
+ * Stores the index of the file being demuxed, for demux_IndexCacheLoad() to
+ * find it when the same file is opened again.
+ *
+ * @param psz_name name of the demuxer, identifying the payload format
+ * @param i_version version of the payload format
+ * @param p_data payload, in native byte order
+ * @param i_data payload size (bytes)
+ */
+int demux_IndexCacheStore( demux_t *p_demux, const char *psz_name,
+                           uint32_t i_version, const void *p_data,
+                           size_t i_data )
+{
+    struct stat st;
+    if( IndexCacheStat( p_demux, &st ) )
+        return VLC_EGENERIC;
+
+    char *psz_key = IndexCacheKey( p_demux, psz_name );
+    if( psz_key == NULL )
+        return VLC_ENOMEM;
+
+    int i_ret = VLC_EGENERIC;
+    char *psz_path = IndexCachePath( psz_key, true );
+    char *psz_tmp;
+    if( psz_path == NULL
+     || asprintf( &psz_tmp, "%s.%lu", psz_path,
+                  (unsigned long)getpid() ) == -1 )
+        goto out;
+
+    FILE *stream = vlc_fopen( psz_tmp, "wb" );
+    if( stream == NULL )
+    {
+        msg_Warn( p_demux, "cannot write %s index cache: %m", psz_name );
+        free( psz_tmp );
+        goto out;
+    }
+
+    const size_t i_key = strlen( psz_key );
+    static const uint8_t pad[8];
+    index_cache_header_t hdr;
+
+    memset( &hdr, 0, sizeof(hdr) );
+    memcpy( hdr.magic, INDEX_CACHE_MAGIC, sizeof(hdr.magic) );
+    hdr.i_format = INDEX_CACHE_FORMAT;
+    hdr.i_version = i_version;
+    hdr.i_size = st.st_size;
+    hdr.i_mtime = st.st_mtime;
+    hdr.i_payload = i_data;
+    hdr.i_key = i_key;
+
+    bool b_ok = fwrite( &hdr, sizeof(hdr), 1, stream ) == 1
+             && fwrite( psz_key, 1, i_key, stream ) == i_key
+             && fwrite( pad, 1, INDEX_CACHE_ALIGN( i_key ) - i_key,
+                        stream ) == INDEX_CACHE_ALIGN( i_key ) - i_key
+             && fwrite( p_data, 1, i_data, stream ) == i_data;
+    if( fclose( stream ) )
+        b_ok = false;
+
+    /* Replace the previous cache atomically */
+    if( b_ok && vlc_rename( psz_tmp, psz_path ) == 0 )
+    {
+        msg_Dbg( p_demux, "stored %s index cache (%zu bytes)", psz_name,
+                 i_data );
+        i_ret = VLC_SUCCESS;
+    }
+    else
+        vlc_unlink( psz_tmp );
+    free( psz_tmp );
+out:
+    free( psz_path );
+    free( psz_key );
+    return i_ret;
+}
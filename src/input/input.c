@@ -182,29 +182,53 @@ int input_Read( vlc_object_t *p_parent, input_item_t *p_item )
     return VLC_SUCCESS;
 }
 
+static void PreparseTimeout( void *data )
+{
+    input_thread_t *p_input = data;
+
+    /* It is called again until the preparsing is over, to also kill the
+     * objects created since the previous call */
+    ObjectKillChildrens( p_input, VLC_OBJECT(p_input) );
+}
+
 /**
  * Initialize an input and initialize it to preparse the item
  * This function is blocking. It will only accept parsing regular files.
  *
  * \param p_parent a vlc_object_t
  * \param p_item an input item
- * \return VLC_SUCCESS or an error
+ * \param i_timeout maximum duration of the preparsing, or 0 for no limit
+ * \return VLC_SUCCESS, VLC_ETIMEOUT if the preparsing was interrupted, or
+ * an error
  */
-int input_Preparse( vlc_object_t *p_parent, input_item_t *p_item )
+int input_Preparse( vlc_object_t *p_parent, input_item_t *p_item,
+                    mtime_t i_timeout )
 {
     input_thread_t *p_input;
+    vlc_timer_t timer;
+    bool b_timer = false;
 
     /* Allocate descriptor */
     p_input = Create( p_parent, p_item, NULL, true, NULL );
     if( !p_input )
         return VLC_EGENERIC;
 
+    if( i_timeout > 0 && !vlc_timer_create( &timer, PreparseTimeout, p_input ) )
+    {
+        vlc_timer_schedule( timer, false, i_timeout, CLOCK_FREQ/10 );
+        b_timer = true;
+    }
+
     if( !Init( p_input ) )
         End( p_input );
 
+    if( b_timer )
+        vlc_timer_destroy( timer );
+
+    const bool b_timeout = !vlc_object_alive( p_input );
     vlc_object_release( p_input );
 
-    return VLC_SUCCESS;
+    return b_timeout ? VLC_ETIMEOUT : VLC_SUCCESS;
 }
 
 /**
@@ -879,11 +903,16 @@ static void InitStatistics( input_thread_t * p_input )
     {
         INIT_COUNTER( read_bytes, INTEGER, COUNTER );
         INIT_COUNTER( read_packets, INTEGER, COUNTER );
+        INIT_COUNTER( read_cache_hits, INTEGER, COUNTER );
+        INIT_COUNTER( read_cache_misses, INTEGER, COUNTER );
         INIT_COUNTER( demux_read, INTEGER, COUNTER );
         INIT_COUNTER( input_bitrate, FLOAT, DERIVATIVE );
         INIT_COUNTER( demux_bitrate, FLOAT, DERIVATIVE );
         INIT_COUNTER( demux_corrupted, INTEGER, COUNTER );
         INIT_COUNTER( demux_discontinuity, INTEGER, COUNTER );
+        INIT_COUNTER( clock_drift, INTEGER, LAST );
+        INIT_COUNTER( clock_jitter, INTEGER, LAST );
+        INIT_COUNTER( clock_buffering, INTEGER, LAST );
         INIT_COUNTER( played_abuffers, INTEGER, COUNTER );
         INIT_COUNTER( lost_abuffers, INTEGER, COUNTER );
         INIT_COUNTER( displayed_pictures, INTEGER, COUNTER );
@@ -1355,11 +1384,16 @@ error:
                                p_input->p->counters.p_##c = NULL; } while(0)
         EXIT_COUNTER( read_bytes );
         EXIT_COUNTER( read_packets );
+        EXIT_COUNTER( read_cache_hits );
+        EXIT_COUNTER( read_cache_misses );
         EXIT_COUNTER( demux_read );
         EXIT_COUNTER( input_bitrate );
         EXIT_COUNTER( demux_bitrate );
         EXIT_COUNTER( demux_corrupted );
         EXIT_COUNTER( demux_discontinuity );
+        EXIT_COUNTER( clock_drift );
+        EXIT_COUNTER( clock_jitter );
+        EXIT_COUNTER( clock_buffering );
         EXIT_COUNTER( played_abuffers );
         EXIT_COUNTER( lost_abuffers );
         EXIT_COUNTER( displayed_pictures );
@@ -1428,11 +1462,16 @@ static void End( input_thread_t * p_input )
             stats_ComputeInputStats( p_input, p_input->p->p_item->p_stats );
             CL_CO( read_bytes );
             CL_CO( read_packets );
+            CL_CO( read_cache_hits );
+            CL_CO( read_cache_misses );
             CL_CO( demux_read );
             CL_CO( input_bitrate );
             CL_CO( demux_bitrate );
             CL_CO( demux_corrupted );
             CL_CO( demux_discontinuity );
+            CL_CO( clock_drift );
+            CL_CO( clock_jitter );
+            CL_CO( clock_buffering );
             CL_CO( played_abuffers );
             CL_CO( lost_abuffers );
             CL_CO( displayed_pictures );
@@ -1752,6 +1791,14 @@ static bool Control( input_thread_t *p_input,
             if( i_time < 0 )
                 i_time = 0;
 
+            /* Seek within the timeshift buffer when the stream cannot */
+            if( !p_input->p->b_can_pace_control &&
+                !es_out_SetTime( p_input->p->p_es_out, i_time ) )
+            {
+                b_force_update = true;
+                break;
+            }
+
             /* Reset the decoders states and clock sync (before calling the demuxer */
             es_out_SetTime( p_input->p->p_es_out, -1 );
 
@@ -2539,8 +2586,9 @@ static int InputSourceInit( input_thread_t *p_input,
             }
             free( psz_list );
         }
-        /* Autodetect extra files if none specified */
-        if( i_input_list <= 0 )
+        /* Autodetect extra files if none specified (not when preparsing,
+         * which only reads the headers) */
+        if( i_input_list <= 0 && !p_input->b_preparsing )
         {
             InputGetExtraFiles( p_input, &i_input_list, &ppsz_input_list,
                                 psz_access, psz_path );
@@ -2563,11 +2611,14 @@ static int InputSourceInit( input_thread_t *p_input,
             goto error;
         }
 
-        /* Add stream filters */
-        char *psz_stream_filter = var_GetNonEmptyString( p_input,
-                                                         "stream-filter" );
+        /* Add stream filters (only the automatic ones when preparsing) */
+        char *psz_stream_filter = NULL;
+        if( !p_input->b_preparsing )
+            psz_stream_filter = var_GetNonEmptyString( p_input,
+                                                       "stream-filter" );
         in->p_stream = stream_FilterChainNew( in->p_stream,
                                               psz_stream_filter,
+                                              !p_input->b_preparsing &&
                                               var_GetBool( p_input, "input-record-native" ) );
         free( psz_stream_filter );
 
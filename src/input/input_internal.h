@@ -139,11 +139,16 @@ struct input_thread_private_t
     struct {
         counter_t *p_read_packets;
         counter_t *p_read_bytes;
+        counter_t *p_read_cache_hits;
+        counter_t *p_read_cache_misses;
         counter_t *p_input_bitrate;
         counter_t *p_demux_read;
         counter_t *p_demux_bitrate;
         counter_t *p_demux_corrupted;
         counter_t *p_demux_discontinuity;
+        counter_t *p_clock_drift;
+        counter_t *p_clock_jitter;
+        counter_t *p_clock_buffering;
         counter_t *p_decoded_audio;
         counter_t *p_decoded_video;
         counter_t *p_decoded_sub;
@@ -48,11 +48,13 @@
  *  - ...
  */
 
-/* Two methods:
+/* Three methods:
  *  - using pf_block
  *      One linked list of data read
  *  - using pf_read
  *      More complex scheme using mutliple track to avoid seeking
+ *  - using pf_read on a seekable access
+ *      Page cache, so that data is read only once from the access
  *  - using directly the access (only indirection for peeking).
  *      This method is known to introduce much less latency.
  *      It should probably defaulted (instead of the stream method (2)).
@@ -95,6 +97,28 @@
 #define STREAM_READ_ATONCE 1024
 #define STREAM_CACHE_TRACK_SIZE (STREAM_CACHE_SIZE/STREAM_CACHE_TRACK)
 
+/* Method3: Page cache, for seekable pf_read
+ *  - The cache is made of "stream-cache-size" kB of fixed-size pages,
+ *    indexed by their offset through a hash table.
+ *  - Pages are replaced in least recently used order.
+ *  - Seeking is free: the access is only seeked when a page is missing
+ *    and the access is not already positioned at its start.
+ */
+#define STREAM_PAGE_SIZE (32*1024)
+
+typedef struct stream_page_t stream_page_t;
+struct stream_page_t
+{
+    uint64_t i_index;       /* Offset of the page / STREAM_PAGE_SIZE */
+    unsigned i_size;        /* Valid data, 0 if the page is unused */
+
+    stream_page_t *p_hash;  /* Next page in the same hash bucket */
+    stream_page_t *p_prev;  /* More recently used page */
+    stream_page_t *p_next;  /* Less recently used page */
+
+    uint8_t *p_buffer;
+};
+
 typedef struct
 {
     int64_t i_date;
@@ -116,7 +140,8 @@ typedef struct
 typedef enum
 {
     STREAM_METHOD_BLOCK,
-    STREAM_METHOD_STREAM
+    STREAM_METHOD_STREAM,
+    STREAM_METHOD_PAGE
 } stream_read_method_t;
 
 struct stream_sys_t
@@ -156,6 +181,29 @@ struct stream_sys_t
 
     } stream;
 
+    /* Method 3: for seekable pf_read */
+    struct
+    {
+        unsigned       i_count;
+        stream_page_t  *p_pages;
+        uint8_t        *p_buffer;
+
+        stream_page_t  **pp_hash;
+        unsigned       i_hash_mask;
+
+        stream_page_t  *p_mru;      /* Most recently used page */
+        stream_page_t  *p_lru;      /* Least recently used page */
+
+        uint64_t       i_access_pos; /* Where the next access read lands */
+
+        /* Lookups not reported to the input statistics yet */
+        unsigned       i_hits;
+        unsigned       i_misses;
+
+        uint64_t       i_total_hits;
+        uint64_t       i_total_misses;
+    } page;
+
     /* Peek temporary buffer */
     unsigned int i_peek;
     uint8_t *p_peek;
@@ -187,6 +235,7 @@ struct stream_sys_t
 static int  AStreamReadBlock( stream_t *s, void *p_read, unsigned int i_read );
 static int  AStreamPeekBlock( stream_t *s, const uint8_t **p_peek, unsigned int i_read );
 static int  AStreamSeekBlock( stream_t *s, uint64_t i_pos );
+static block_t *AStreamSliceBlock( stream_t *s, unsigned int i_read );
 static void AStreamPrebufferBlock( stream_t *s );
 static block_t *AReadBlock( stream_t *s, bool *pb_eof );
 
@@ -197,6 +246,14 @@ static int  AStreamSeekStream( stream_t *s, uint64_t i_pos );
 static void AStreamPrebufferStream( stream_t *s );
 static int  AReadStream( stream_t *s, void *p_read, unsigned int i_read );
 
+/* Method 3 */
+static int  AStreamInitPage( stream_t *s );
+static void AStreamResetPage( stream_t *s );
+static void AStreamCleanPage( stream_t *s );
+static int  AStreamReadPage( stream_t *s, void *p_read, unsigned int i_read );
+static int  AStreamPeekPage( stream_t *s, const uint8_t **pp_peek, unsigned int i_read );
+static int  AStreamSeekPage( stream_t *s, uint64_t i_pos );
+
 /* Common */
 static int AStreamControl( stream_t *s, int i_query, va_list );
 static void AStreamDestroy( stream_t *s );
@@ -306,7 +363,13 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
     if( p_access->pf_block )
         p_sys->method = STREAM_METHOD_BLOCK;
     else
-        p_sys->method = STREAM_METHOD_STREAM;
+    {
+        bool b_can_seek;
+
+        access_Control( p_access, ACCESS_CAN_SEEK, &b_can_seek );
+        p_sys->method = b_can_seek ? STREAM_METHOD_PAGE
+                                   : STREAM_METHOD_STREAM;
+    }
 
     p_sys->i_pos = p_access->info.i_pos;
 
@@ -394,6 +457,23 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
             goto error;
         }
     }
+    else if( p_sys->method == STREAM_METHOD_PAGE )
+    {
+        msg_Dbg( s, "Using page method for AStream*" );
+        s->pf_read = AStreamReadPage;
+        s->pf_peek = AStreamPeekPage;
+
+        if( AStreamInitPage( s ) )
+            goto error;
+
+        /* Do the prebuffering */
+        const uint8_t *p_peek;
+        if( AStreamPeekPage( s, &p_peek, STREAM_CACHE_PREBUFFER_SIZE ) <= 0 )
+        {
+            msg_Err( s, "cannot pre fill buffer" );
+            goto error;
+        }
+    }
     else
     {
         int i;
@@ -443,6 +523,10 @@ error:
     {
         /* Nothing yet */
     }
+    else if( p_sys->method == STREAM_METHOD_PAGE )
+    {
+        AStreamCleanPage( s );
+    }
     else
     {
         free( p_sys->stream.p_buffer );
@@ -464,6 +548,12 @@ static void AStreamDestroy( stream_t *s )
 
     if( p_sys->method == STREAM_METHOD_BLOCK )
         block_ChainRelease( p_sys->block.p_first );
+    else if( p_sys->method == STREAM_METHOD_PAGE )
+    {
+        msg_Dbg( s, "page cache: %"PRIu64" hits, %"PRIu64" misses",
+                 p_sys->page.i_total_hits, p_sys->page.i_total_misses );
+        AStreamCleanPage( s );
+    }
     else
         free( p_sys->stream.p_buffer );
 
@@ -515,6 +605,11 @@ static void AStreamControlReset( stream_t *s )
         /* Do the prebuffering */
         AStreamPrebufferBlock( s );
     }
+    else if( p_sys->method == STREAM_METHOD_PAGE )
+    {
+        /* The access may now expose different data at the same offsets */
+        AStreamResetPage( s );
+    }
     else
     {
         int i;
@@ -555,6 +650,8 @@ static void AStreamControlUpdate( stream_t *s )
             p_sys->i_pos += p_sys->list[i]->i_size;
         }
     }
+    if( p_sys->method == STREAM_METHOD_PAGE )
+        p_sys->page.i_access_pos = p_sys->i_pos;
 }
 
 /****************************************************************************
@@ -594,6 +691,10 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
             access_Control( p_access, ACCESS_CAN_FASTSEEK, p_bool );
             break;
 
+        case STREAM_IS_REMOTE:
+            return access_Control( p_access, ACCESS_IS_REMOTE,
+                                   va_arg( args, bool * ) );
+
         case STREAM_GET_POSITION:
             pi_64 = va_arg( args, uint64_t * );
             *pi_64 = p_sys->i_pos;
@@ -607,6 +708,8 @@ static int AStreamControl( stream_t *s, int i_query, va_list args )
                 return AStreamSeekBlock( s, i_64 );
             case STREAM_METHOD_STREAM:
                 return AStreamSeekStream( s, i_64 );
+            case STREAM_METHOD_PAGE:
+                return AStreamSeekPage( s, i_64 );
             default:
                 assert(0);
                 return VLC_EGENERIC;
@@ -840,6 +943,33 @@ static int AStreamPeekBlock( stream_t *s, const uint8_t **pp_peek, unsigned int
     return i_data;
 }
 
+/* Returns the next i_read bytes as a slice of the current block, if they
+ * are all there and the block is memory mapped */
+static block_t *AStreamSliceBlock( stream_t *s, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    block_t *b = p_sys->block.p_current;
+
+    if( b == NULL || b->i_buffer - p_sys->block.i_offset < i_read )
+        return NULL;
+
+    block_t *p_slice = block_mmap_Slice( b, p_sys->block.i_offset, i_read );
+    if( p_slice == NULL )
+        return NULL;
+
+    p_sys->block.i_offset += i_read;
+    p_sys->i_pos += i_read;
+    if( p_sys->block.i_offset >= b->i_buffer )
+    {
+        /* Current block is now empty, switch to next */
+        p_sys->block.i_offset = 0;
+        p_sys->block.p_current = b->p_next;
+        if( !p_sys->block.p_current )
+            AStreamRefillBlock( s );
+    }
+    return p_slice;
+}
+
 static int AStreamSeekBlock( stream_t *s, uint64_t i_pos )
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -1459,6 +1589,334 @@ static void AStreamPrebufferStream( stream_t *s )
     }
 }
 
+/****************************************************************************
+ * Method 3:
+ ****************************************************************************/
+static int AStreamInitPage( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    unsigned i_count = var_InheritInteger( s, "stream-cache-size" ) * 1024
+                       / STREAM_PAGE_SIZE;
+    if( i_count < 4 )
+        i_count = 4;
+
+    unsigned i_hash = 1;
+    while( i_hash < i_count )
+        i_hash <<= 1;
+
+    p_sys->page.i_count = i_count;
+    p_sys->page.i_hash_mask = i_hash - 1;
+    p_sys->page.p_pages = calloc( i_count, sizeof(*p_sys->page.p_pages) );
+    p_sys->page.pp_hash = calloc( i_hash, sizeof(*p_sys->page.pp_hash) );
+    p_sys->page.p_buffer = malloc( (size_t)i_count * STREAM_PAGE_SIZE );
+    if( !p_sys->page.p_pages || !p_sys->page.pp_hash || !p_sys->page.p_buffer )
+        return VLC_ENOMEM;
+
+    for( unsigned i = 0; i < i_count; i++ )
+        p_sys->page.p_pages[i].p_buffer =
+            &p_sys->page.p_buffer[(size_t)i * STREAM_PAGE_SIZE];
+
+    p_sys->page.i_total_hits = 0;
+    p_sys->page.i_total_misses = 0;
+    p_sys->page.i_hits = 0;
+    p_sys->page.i_misses = 0;
+    AStreamResetPage( s );
+    return VLC_SUCCESS;
+}
+
+/* Drops all the cached data */
+static void AStreamResetPage( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    const unsigned i_count = p_sys->page.i_count;
+
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        stream_page_t *p = &p_sys->page.p_pages[i];
+
+        p->i_size = 0;
+        p->p_hash = NULL;
+        p->p_prev = i > 0 ? &p_sys->page.p_pages[i - 1] : NULL;
+        p->p_next = i + 1 < i_count ? &p_sys->page.p_pages[i + 1] : NULL;
+    }
+    memset( p_sys->page.pp_hash, 0,
+            (p_sys->page.i_hash_mask + 1) * sizeof(*p_sys->page.pp_hash) );
+    p_sys->page.p_mru = &p_sys->page.p_pages[0];
+    p_sys->page.p_lru = &p_sys->page.p_pages[i_count - 1];
+    p_sys->page.i_access_pos = p_sys->i_pos;
+}
+
+static void AStreamCleanPage( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    free( p_sys->page.p_buffer );
+    free( p_sys->page.pp_hash );
+    free( p_sys->page.p_pages );
+}
+
+/* Reports the cache efficiency to the input statistics */
+static void AStreamStatsPage( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    input_thread_t *p_input = NULL;
+
+    if( s->p_parent && s->p_parent->p_parent &&
+        vlc_internals( s->p_parent->p_parent )->i_object_type == VLC_OBJECT_INPUT )
+        p_input = (input_thread_t *)s->p_parent->p_parent;
+
+    if( p_input && libvlc_stats( s ) )
+    {
+        vlc_mutex_lock( &p_input->p->counters.counters_lock );
+        stats_UpdateInteger( s, p_input->p->counters.p_read_cache_hits,
+                             p_sys->page.i_hits, NULL );
+        stats_UpdateInteger( s, p_input->p->counters.p_read_cache_misses,
+                             p_sys->page.i_misses, NULL );
+        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+    }
+    p_sys->page.i_hits = 0;
+    p_sys->page.i_misses = 0;
+}
+
+/* Moves a page to the head of the LRU list */
+static void AStreamTouchPage( stream_sys_t *p_sys, stream_page_t *p )
+{
+    if( p == p_sys->page.p_mru )
+        return;
+
+    /* Unlink */
+    p->p_prev->p_next = p->p_next;
+    if( p->p_next )
+        p->p_next->p_prev = p->p_prev;
+    else
+        p_sys->page.p_lru = p->p_prev;
+
+    /* Insert at the head */
+    p->p_prev = NULL;
+    p->p_next = p_sys->page.p_mru;
+    p_sys->page.p_mru->p_prev = p;
+    p_sys->page.p_mru = p;
+}
+
+static void AStreamUnhashPage( stream_sys_t *p_sys, stream_page_t *p )
+{
+    stream_page_t **pp = &p_sys->page.pp_hash[p->i_index & p_sys->page.i_hash_mask];
+
+    while( *pp != p )
+        pp = &(*pp)->p_hash;
+    *pp = p->p_hash;
+    p->p_hash = NULL;
+}
+
+/* Reads from the access until the page is full or the end of the stream */
+static int AStreamFillPage( stream_t *s, stream_page_t *p )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    const uint64_t i_pos = p->i_index * STREAM_PAGE_SIZE + p->i_size;
+
+    /* Short forward gaps are read through, rather than sent to the access
+     * as a seek: that is a new request or a reconnection for some of them */
+    const uint64_t i_skip_threshold = p_sys->stat.b_fastseek
+                                    ? 128 : 3 * STREAM_PAGE_SIZE;
+    while( p_sys->page.i_access_pos < i_pos &&
+           i_pos - p_sys->page.i_access_pos <= i_skip_threshold )
+    {
+        if( s->b_die )
+            return VLC_EGENERIC;
+
+        /* The free end of the page serves as scratch buffer */
+        const unsigned i_skip = __MIN( i_pos - p_sys->page.i_access_pos,
+                                       STREAM_PAGE_SIZE - p->i_size );
+        int i_read = AReadStream( s, &p->p_buffer[p->i_size], i_skip );
+        if( i_read < 0 )
+            continue;
+        if( i_read == 0 )
+            return VLC_SUCCESS; /* EOF */
+
+        p_sys->page.i_access_pos += i_read;
+        p_sys->stat.i_bytes += i_read;
+        p_sys->stat.i_read_count++;
+    }
+
+    if( p_sys->page.i_access_pos != i_pos )
+    {
+        const int64_t i_start = mdate();
+
+        if( ASeek( s, i_pos ) )
+            return VLC_EGENERIC;
+        p_sys->page.i_access_pos = i_pos;
+
+        p_sys->stat.i_seek_time += mdate() - i_start;
+        p_sys->stat.i_seek_count++;
+    }
+
+    const int64_t i_start = mdate();
+    while( p->i_size < STREAM_PAGE_SIZE )
+    {
+        if( s->b_die )
+            break;
+
+        int i_read = AReadStream( s, &p->p_buffer[p->i_size],
+                                  STREAM_PAGE_SIZE - p->i_size );
+        if( i_read < 0 )
+            continue;
+        if( i_read == 0 )
+            break; /* EOF */
+
+        p->i_size += i_read;
+        p_sys->page.i_access_pos += i_read;
+        p_sys->stat.i_bytes += i_read;
+        p_sys->stat.i_read_count++;
+    }
+    p_sys->stat.i_read_time += mdate() - i_start;
+    return VLC_SUCCESS;
+}
+
+/* Returns the page holding the data at i_pos, or NULL at the end of the
+ * stream or on error */
+static stream_page_t *AStreamGetPage( stream_t *s, uint64_t i_pos )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    const uint64_t i_index = i_pos / STREAM_PAGE_SIZE;
+    const unsigned i_offset = i_pos % STREAM_PAGE_SIZE;
+    stream_page_t *p;
+
+    for( p = p_sys->page.pp_hash[i_index & p_sys->page.i_hash_mask];
+         p != NULL; p = p->p_hash )
+        if( p->i_index == i_index )
+            break;
+
+    if( p != NULL )
+    {
+        AStreamTouchPage( p_sys, p );
+        if( i_offset < p->i_size )
+        {
+            p_sys->page.i_total_hits++;
+            if( ++p_sys->page.i_hits >= 256 )
+                AStreamStatsPage( s );
+            return p;
+        }
+        /* The page was short: the stream may have grown since */
+    }
+    else
+    {
+        /* Recycle the least recently used page */
+        p = p_sys->page.p_lru;
+        if( p->i_size > 0 )
+            AStreamUnhashPage( p_sys, p );
+        AStreamTouchPage( p_sys, p );
+
+        p->i_index = i_index;
+        p->i_size = 0;
+    }
+
+    p_sys->page.i_total_misses++;
+    p_sys->page.i_misses++;
+    AStreamStatsPage( s );
+
+    const bool b_new = p->i_size == 0;
+    const int i_ret = AStreamFillPage( s, p );
+
+    if( b_new && p->i_size > 0 )
+    {
+        stream_page_t **pp_bucket =
+            &p_sys->page.pp_hash[i_index & p_sys->page.i_hash_mask];
+        p->p_hash = *pp_bucket;
+        *pp_bucket = p;
+    }
+    if( i_ret || i_offset >= p->i_size )
+        return NULL;
+    return p;
+}
+
+/* Copies data starting at i_pos, without moving the read position */
+static unsigned AStreamCopyPage( stream_t *s, uint8_t *p_data,
+                                 uint64_t i_pos, unsigned i_read )
+{
+    unsigned i_data = 0;
+
+    while( i_data < i_read )
+    {
+        stream_page_t *p = AStreamGetPage( s, i_pos + i_data );
+        if( p == NULL )
+            break;
+
+        const unsigned i_offset = (i_pos + i_data) % STREAM_PAGE_SIZE;
+        const unsigned i_copy = __MIN( p->i_size - i_offset, i_read - i_data );
+
+        if( p_data )
+            memcpy( &p_data[i_data], &p->p_buffer[i_offset], i_copy );
+        i_data += i_copy;
+
+        if( p->i_size < STREAM_PAGE_SIZE )
+            break; /* EOF */
+    }
+    return i_data;
+}
+
+static int AStreamReadPage( stream_t *s, void *p_read, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    unsigned i_data;
+
+    if( p_read == NULL && p_sys->p_access->info.i_size > 0 && !p_sys->i_list )
+    {
+        /* Skipping is free, but do not go past the end */
+        const uint64_t i_size = p_sys->p_access->info.i_size;
+
+        i_data = p_sys->i_pos < i_size ? __MIN( i_size - p_sys->i_pos, i_read )
+                                       : 0;
+    }
+    else
+        i_data = AStreamCopyPage( s, p_read, p_sys->i_pos, i_read );
+
+    p_sys->i_pos += i_data;
+    return i_data;
+}
+
+static int AStreamPeekPage( stream_t *s, const uint8_t **pp_peek, unsigned int i_read )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    const unsigned i_offset = p_sys->i_pos % STREAM_PAGE_SIZE;
+
+    stream_page_t *p = AStreamGetPage( s, p_sys->i_pos );
+    if( p == NULL )
+        return 0;
+
+    /* We can directly give a pointer over our buffer */
+    if( i_offset + i_read <= p->i_size || p->i_size < STREAM_PAGE_SIZE )
+    {
+        *pp_peek = &p->p_buffer[i_offset];
+        return __MIN( i_read, p->i_size - i_offset );
+    }
+
+    /* We need to create a local copy */
+    if( p_sys->i_peek < i_read )
+    {
+        p_sys->p_peek = realloc_or_free( p_sys->p_peek, i_read );
+        if( !p_sys->p_peek )
+        {
+            p_sys->i_peek = 0;
+            return 0;
+        }
+        p_sys->i_peek = i_read;
+    }
+
+    *pp_peek = p_sys->p_peek;
+    return AStreamCopyPage( s, p_sys->p_peek, p_sys->i_pos, i_read );
+}
+
+static int AStreamSeekPage( stream_t *s, uint64_t i_pos )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    /* The access is only seeked when data is actually missing, and short
+     * forward skips are read through (see AStreamFillPage()) */
+    p_sys->i_pos = i_pos;
+    return VLC_SUCCESS;
+}
+
 /****************************************************************************
  * stream_ReadLine:
  ****************************************************************************/
@@ -1937,6 +2395,14 @@ block_t *stream_Block( stream_t *s, int i_size )
 {
     if( i_size <= 0 ) return NULL;
 
+    /* Memory mapped data can be handed out without copying */
+    if( s->pf_read == AStreamReadBlock )
+    {
+        block_t *p_bk = AStreamSliceBlock( s, i_size );
+        if( p_bk )
+            return p_bk;
+    }
+
     /* emulate block read */
     block_t *p_bk = block_New( s, i_size );
     if( p_bk )
@@ -468,6 +468,8 @@ void input_ConfigVarInit ( input_thread_t *p_input )
                     VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
         var_Create( p_input, "clock-synchro",
                     VLC_VAR_INTEGER | VLC_VAR_DOINHERIT);
+        var_Create( p_input, "clock-recovery",
+                    VLC_VAR_INTEGER | VLC_VAR_DOINHERIT );
     }
 
     var_Create( p_input, "can-seek", VLC_VAR_BOOL );
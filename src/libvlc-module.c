@@ -168,6 +168,12 @@ static const char *const ppsz_snap_formats[] =
  * Intf
  ****************************************************************************/
 
+#define COPY_THREADS_TEXT N_("Picture copy threads")
+#define COPY_THREADS_LONGTEXT N_( \
+    "Number of threads used to copy large (4K and above) pictures. " \
+    "0 means to pick a value from the number of CPUs, 1 disables " \
+    "parallel copies.")
+
 // DEPRECATED
 #define INTF_CAT_LONGTEXT N_( \
     "These options allow you to configure the interfaces used by VLC. " \
@@ -635,6 +641,14 @@ static const char *const ppsz_pos_descriptions[] =
     "real-time sources. Use this if you experience jerky playback of " \
     "network streams.")
 
+#define CLOCK_RECOVERY_TEXT N_("Clock recovery")
+#define CLOCK_RECOVERY_LONGTEXT N_( \
+    "This selects how the drift between the stream clock and the system " \
+    "clock is estimated for real-time sources. The average follows the " \
+    "mean network delay. The windowed minimum and the tracking loop are " \
+    "less sensitive to bursty reception (such as IP multicast), and allow " \
+    "for lower network caching values.")
+
 #define CLOCK_JITTER_TEXT N_("Clock jitter")
 #define CLOCK_JITTER_LONGTEXT N_( \
     "This defines the maximum input delay jitter that the synchronization " \
@@ -649,6 +663,10 @@ static const int pi_clock_values[] = { -1, 0, 1 };
 static const char *const ppsz_clock_descriptions[] =
 { N_("Default"), N_("Disable"), N_("Enable") };
 
+static const int pi_clock_recovery_values[] = { 0, 1, 2 };
+static const char *const ppsz_clock_recovery_descriptions[] =
+{ N_("Average"), N_("Windowed minimum"), N_("Tracking loop") };
+
 #define SERVER_PORT_TEXT N_("UDP port")
 #define SERVER_PORT_LONGTEXT N_( \
     "This is the default port used for UDP streams. Default is 1234." )
@@ -764,6 +782,18 @@ static const char *const ppsz_clock_descriptions[] =
     "the form \"{name=bookmark-name,time=optional-time-offset," \
     "bytes=optional-byte-offset},{...}\"")
 
+#define STREAM_CACHE_TEXT N_("Stream cache size (kB)")
+#define STREAM_CACHE_LONGTEXT N_( \
+    "Amount of memory used to cache the data read from seekable inputs. " \
+    "Data found in the cache is not requested again from the access, " \
+    "which helps with formats that need a lot of seeking." )
+
+#define INDEX_CACHE_TEXT N_("Cache demuxer indexes")
+#define INDEX_CACHE_LONGTEXT N_( \
+    "Keep the indexes built by the demuxers for local files, such as AVI " \
+    "files without index, so that they can be reused the next time the " \
+    "same file is opened." )
+
 #define INPUT_RECORD_PATH_TEXT N_("Record directory or filename")
 #define INPUT_RECORD_PATH_LONGTEXT N_( \
     "Directory or filename where the records will be stored" )
@@ -782,6 +812,12 @@ static const char *const ppsz_clock_descriptions[] =
     "This is the maximum size in bytes of the temporary files " \
     "that will be used to store the timeshifted streams." )
 
+#define INPUT_TIMESHIFT_SIZE_TEXT N_("Timeshift size (MB)")
+#define INPUT_TIMESHIFT_SIZE_LONGTEXT N_( \
+    "This is the maximum size in megabytes of all the temporary files " \
+    "used to store the timeshifted streams. Beyond it, the oldest data " \
+    "is dropped." )
+
 #define INPUT_TITLE_FORMAT_TEXT N_( "Change title according to current media" )
 #define INPUT_TITLE_FORMAT_LONGTEXT N_( "This option allows you to set the title according to what's being played<br>"  \
     "$a: Artist<br>$b: Album<br>$c: Copyright<br>$t: Title<br>$g: Genre<br>"  \
@@ -1016,6 +1052,12 @@ static const char *const ppsz_clock_descriptions[] =
     "This allows you to select the order in which VLC will choose its " \
     "packetizers."  )
 
+#define PACKETIZER_THREAD_TEXT N_("Packetize in a separate thread")
+#define PACKETIZER_THREAD_LONGTEXT N_( \
+    "Run the packetizer of each audio and video elementary stream in its " \
+    "own thread, ahead of the decoder or of the stream output. This uses " \
+    "more CPU cores when remuxing or decoding high bitrate streams.")
+
 #define MUX_TEXT N_("Mux module")
 #define MUX_LONGTEXT N_( \
     "This is a legacy entry to let you configure mux modules")
@@ -1239,6 +1281,21 @@ static const char *const ppsz_clock_descriptions[] =
     "Automatically preparse files added to the playlist " \
     "(to retrieve some metadata)." )
 
+#define PREPARSE_THREADS_TEXT N_( "Preparser threads" )
+#define PREPARSE_THREADS_LONGTEXT N_( \
+    "Maximum number of files preparsed at the same time " \
+    "(0 meaning one per CPU)." )
+
+#define PREPARSE_TIMEOUT_TEXT N_( "Preparser timeout" )
+#define PREPARSE_TIMEOUT_LONGTEXT N_( \
+    "Maximum time spent preparsing a single file, in milliseconds " \
+    "(0 meaning no limit)." )
+
+#define FETCH_THREADS_TEXT N_( "Art fetcher threads" )
+#define FETCH_THREADS_LONGTEXT N_( \
+    "Maximum number of items whose art and meta data are fetched " \
+    "at the same time." )
+
 #define ALBUM_ART_TEXT N_( "Album art policy" )
 #define ALBUM_ART_LONGTEXT N_( \
     "Choose how album art will be downloaded." )
@@ -1933,6 +1990,10 @@ vlc_module_begin ()
     add_integer( "clock-synchro", -1, CLOCK_SYNCHRO_TEXT,
                  CLOCK_SYNCHRO_LONGTEXT, true )
         change_integer_list( pi_clock_values, ppsz_clock_descriptions )
+    add_integer( "clock-recovery", 0, CLOCK_RECOVERY_TEXT,
+                 CLOCK_RECOVERY_LONGTEXT, true )
+        change_integer_list( pi_clock_recovery_values,
+                             ppsz_clock_recovery_descriptions )
     add_integer( "clock-jitter", 5 * CLOCK_FREQ/1000, CLOCK_JITTER_TEXT,
               CLOCK_JITTER_LONGTEXT, true )
         change_safe()
@@ -1940,6 +2001,17 @@ vlc_module_begin ()
     add_bool( "network-synchronisation", false, NETSYNC_TEXT,
               NETSYNC_LONGTEXT, true )
 
+#ifdef OPTIMIZE_MEMORY
+    add_integer_with_range( "stream-cache-size", 512, 128, 1048576,
+                            STREAM_CACHE_TEXT, STREAM_CACHE_LONGTEXT, true )
+#else
+    add_integer_with_range( "stream-cache-size", 12288, 128, 1048576,
+                            STREAM_CACHE_TEXT, STREAM_CACHE_LONGTEXT, true )
+#endif
+
+    add_bool( "demux-index-cache", true, INDEX_CACHE_TEXT,
+              INDEX_CACHE_LONGTEXT, true )
+
     add_string( "input-record-path", NULL, INPUT_RECORD_PATH_TEXT,
                 INPUT_RECORD_PATH_LONGTEXT, true )
     add_bool( "input-record-native", true, INPUT_RECORD_NATIVE_TEXT,
@@ -1949,6 +2021,8 @@ vlc_module_begin ()
                 INPUT_TIMESHIFT_PATH_LONGTEXT, true )
     add_integer( "input-timeshift-granularity", -1, INPUT_TIMESHIFT_GRANULARITY_TEXT,
                  INPUT_TIMESHIFT_GRANULARITY_LONGTEXT, true )
+    add_integer( "input-timeshift-size", 1024, INPUT_TIMESHIFT_SIZE_TEXT,
+                 INPUT_TIMESHIFT_SIZE_LONGTEXT, true )
 
     add_string( "input-title-format", "$Z", INPUT_TITLE_FORMAT_TEXT, INPUT_TITLE_FORMAT_LONGTEXT, false );
 
@@ -2016,6 +2090,8 @@ vlc_module_begin ()
     set_subcategory( SUBCAT_SOUT_PACKETIZER )
     add_module( "packetizer", "packetizer", NULL,
                 PACKETIZER_TEXT, PACKETIZER_LONGTEXT, true )
+    add_bool( "packetizer-thread", false, PACKETIZER_THREAD_TEXT,
+              PACKETIZER_THREAD_LONGTEXT, true )
 
     set_subcategory( SUBCAT_SOUT_SAP )
     add_integer( "sap-interval", 5, ANN_SAPINTV_TEXT,
@@ -2042,6 +2118,9 @@ vlc_module_begin ()
 #if defined( __powerpc__ ) || defined( __ppc__ ) || defined( __ppc64__ )
     add_bool( "altivec", 1, ALTIVEC_TEXT, ALTIVEC_LONGTEXT, true )
 #endif
+    add_integer( "picture-copy-threads", 0, COPY_THREADS_TEXT,
+                 COPY_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 16 )
 
 /* Misc options */
     set_subcategory( SUBCAT_ADVANCED_MISC )
@@ -2121,11 +2200,19 @@ vlc_module_begin ()
 
     add_bool( "auto-preparse", true, PREPARSE_TEXT,
               PREPARSE_LONGTEXT, false )
+    add_integer( "preparse-threads", 0, PREPARSE_THREADS_TEXT,
+                 PREPARSE_THREADS_LONGTEXT, true )
+        change_integer_range( 0, 64 )
+    add_integer( "preparse-timeout", 5000, PREPARSE_TIMEOUT_TEXT,
+                 PREPARSE_TIMEOUT_LONGTEXT, true )
 
     add_integer( "album-art", ALBUM_ART_WHEN_ASKED, ALBUM_ART_TEXT,
                  ALBUM_ART_LONGTEXT, false )
         change_integer_list( pi_albumart_values,
                              ppsz_albumart_descriptions )
+    add_integer( "fetch-threads", 4, FETCH_THREADS_TEXT,
+                 FETCH_THREADS_LONGTEXT, true )
+        change_integer_range( 1, 32 )
 
     set_subcategory( SUBCAT_PLAYLIST_SD )
     add_module_list_cat( "services-discovery", SUBCAT_PLAYLIST_SD, NULL,
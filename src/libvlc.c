@@ -766,6 +766,12 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
     /* Avoid being called "memcpy":*/
     vlc_object_set_name( p_libvlc, "main" );
 
+    /* Threads to copy large pictures in parallel */
+    int i_copy_threads = var_InheritInteger( p_libvlc, "picture-copy-threads" );
+    if( i_copy_threads <= 0 )
+        i_copy_threads = __MIN( vlc_GetCPUCount(), 4 );
+    vlc_workers_Init( i_copy_threads - 1 );
+
     priv->b_stats = var_InheritBool( p_libvlc, "stats" );
     priv->i_timers = 0;
     priv->pp_timers = NULL;
@@ -802,6 +808,7 @@ int libvlc_InternalInit( libvlc_int_t *p_libvlc, int i_argc,
         {
             module_unneed( p_libvlc, priv->p_memcpy_module );
         }
+        vlc_workers_Deinit();
         module_EndBank( p_libvlc, true );
         return VLC_EGENERIC;
     }
@@ -1038,6 +1045,8 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     }
 #endif
 
+    vlc_workers_Deinit();
+
     if( priv->p_memcpy_module )
     {
         module_unneed( p_libvlc, priv->p_memcpy_module );
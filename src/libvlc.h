@@ -69,6 +69,14 @@ void vlc_assert_locked (vlc_mutex_t *);
 extern uint32_t cpu_flags;
 uint32_t CPUCapabilities( void );
 
+/*
+ * Shared worker threads
+ */
+void vlc_workers_Init( unsigned );
+void vlc_workers_Deinit( void );
+unsigned vlc_workers_GetCount( void );
+void vlc_workers_Run( void (*)( void *, unsigned ), void *, unsigned );
+
 /*
  * Message/logging stuff
  */
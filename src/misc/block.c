@@ -33,6 +33,7 @@
 #include <assert.h>
 #include <errno.h>
 #include "vlc_block.h"
+#include <vlc_atomic.h>
 
 /**
  * @section Block handling functions.
@@ -315,16 +316,23 @@ typedef struct block_mmap_t
     block_t     self;
     void       *base_addr;
     size_t      length;
+    vlc_atomic_t refs; /* the block itself and its slices */
 } block_mmap_t;
 
-static void block_mmap_Release (block_t *block)
+static void block_mmap_Unref (block_mmap_t *p_sys)
 {
-    block_mmap_t *p_sys = (block_mmap_t *)block;
+    if (vlc_atomic_dec (&p_sys->refs) > 0)
+        return;
 
     munmap (p_sys->base_addr, p_sys->length);
     free (p_sys);
 }
 
+static void block_mmap_Release (block_t *block)
+{
+    block_mmap_Unref ((block_mmap_t *)block);
+}
+
 /**
  * Creates a block from a virtual address memory mapping (mmap).
  * This is provided by LibVLC so that mmap blocks can safely be deallocated
@@ -351,13 +359,66 @@ block_t *block_mmap_Alloc (void *addr, size_t length)
     block->self.pf_release = block_mmap_Release;
     block->base_addr = addr;
     block->length = length;
+    vlc_atomic_set (&block->refs, 1);
     return &block->self;
 }
+
+typedef struct block_slice_t
+{
+    block_t       self;
+    block_mmap_t *map;
+} block_slice_t;
+
+static void block_slice_Release (block_t *block)
+{
+    block_slice_t *p_sys = (block_slice_t *)block;
+
+    block_mmap_Unref (p_sys->map);
+    free (p_sys);
+}
+
+/**
+ * Creates a block pointing to a part of the data of a memory mapped block,
+ * without copying. The mapping remains valid until both blocks are released.
+ *
+ * @param block block created by block_mmap_Alloc() or block_mmap_Slice()
+ * @param offset offset (bytes) of the slice within block->p_buffer
+ * @param length length (bytes) of the slice
+ * @return NULL if the block is not memory mapped, or on error.
+ */
+block_t *block_mmap_Slice (block_t *block, size_t offset, size_t length)
+{
+    block_mmap_t *map;
+
+    if (block->pf_release == block_mmap_Release)
+        map = (block_mmap_t *)block;
+    else if (block->pf_release == block_slice_Release)
+        map = ((block_slice_t *)block)->map;
+    else
+        return NULL;
+
+    assert (offset + length <= block->i_buffer);
+
+    block_slice_t *slice = malloc (sizeof (*slice));
+    if (slice == NULL)
+        return NULL;
+
+    block_Init (&slice->self, block->p_buffer + offset, length);
+    slice->self.pf_release = block_slice_Release;
+    slice->map = map;
+    vlc_atomic_inc (&map->refs);
+    return &slice->self;
+}
 #else
 block_t *block_mmap_Alloc (void *addr, size_t length)
 {
     (void)addr; (void)length; return NULL;
 }
+
+block_t *block_mmap_Slice (block_t *block, size_t offset, size_t length)
+{
+    (void)block; (void)offset; (void)length; return NULL;
+}
 #endif
 
 
@@ -38,6 +38,8 @@
 #include <vlc_image.h>
 #include <vlc_block.h>
 
+#include "libvlc.h"
+
 /**
  * Allocate a new picture in the heap.
  *
@@ -280,12 +282,121 @@ void picture_Delete( picture_t *p_picture )
 /*****************************************************************************
  *
  *****************************************************************************/
+/* Returns the size of the memory area holding all the planes if they are
+ * stored one after the other, 0 otherwise */
+static size_t picture_GetContiguousSize( const picture_t *p_picture )
+{
+    size_t i_size = 0;
+
+    for( int i = 0; i < p_picture->i_planes; i++ )
+    {
+        const plane_t *p = &p_picture->p[i];
+
+        if( p->p_pixels != &p_picture->p[0].p_pixels[i_size] )
+            return 0;
+        i_size += p->i_pitch * p->i_lines;
+    }
+    return i_size;
+}
+
+/* Checks whether both pictures share the exact same memory layout and
+ * can thus be copied with a single memcpy */
+static bool picture_CanCoalesce( const picture_t *p_dst,
+                                 const picture_t *p_src )
+{
+    if( p_dst->i_planes != p_src->i_planes || p_src->i_planes <= 0 )
+        return false;
+
+    for( int i = 0; i < p_src->i_planes; i++ )
+    {
+        const plane_t *s = &p_src->p[i];
+        const plane_t *d = &p_dst->p[i];
+
+        /* See plane_CopyPixels() about the 2x visible pitch check */
+        if( s->i_pitch != d->i_pitch || s->i_lines != d->i_lines ||
+            s->i_visible_lines != d->i_visible_lines ||
+            s->i_pitch >= 2 * s->i_visible_pitch )
+            return false;
+    }
+    return picture_GetContiguousSize( p_src ) != 0 &&
+           picture_GetContiguousSize( p_dst ) != 0;
+}
+
+/* Pictures larger than this are split across the worker threads, so that
+ * 1080p stays on the calling thread while 4K and above do not */
+#define PICTURE_PARALLEL_COPY_MIN (8 * 1024 * 1024)
+
+typedef struct
+{
+    picture_t       *p_dst;
+    const picture_t *p_src;
+    size_t          i_size;   /* Non zero for a single contiguous copy */
+    unsigned        i_slices;
+} picture_copy_t;
+
+static void picture_CopySlice( void *data, unsigned i_slice )
+{
+    const picture_copy_t *p_copy = data;
+
+    if( p_copy->i_size > 0 )
+    {
+        /* Keep the slices cache line aligned */
+        const size_t i_step = ( p_copy->i_size / p_copy->i_slices ) & ~63;
+        const size_t i_start = i_step * i_slice;
+        const size_t i_length = i_slice + 1 < p_copy->i_slices ?
+                                i_step : p_copy->i_size - i_start;
+
+        vlc_memcpy( &p_copy->p_dst->p[0].p_pixels[i_start],
+                    &p_copy->p_src->p[0].p_pixels[i_start], i_length );
+        return;
+    }
+
+    for( int i = 0; i < p_copy->p_src->i_planes; i++ )
+    {
+        plane_t dst = p_copy->p_dst->p[i];
+        plane_t src = p_copy->p_src->p[i];
+        const int i_lines = __MIN( dst.i_visible_lines, src.i_visible_lines );
+        const int i_first = i_lines * i_slice / p_copy->i_slices;
+        const int i_last  = i_lines * (i_slice + 1) / p_copy->i_slices;
+
+        dst.p_pixels += i_first * dst.i_pitch;
+        src.p_pixels += i_first * src.i_pitch;
+        dst.i_visible_lines =
+        src.i_visible_lines = i_last - i_first;
+        if( i_last > i_first )
+            plane_CopyPixels( &dst, &src );
+    }
+}
+
 void picture_CopyPixels( picture_t *p_dst, const picture_t *p_src )
 {
-    int i;
+    picture_copy_t copy = {
+        .p_dst = p_dst,
+        .p_src = p_src,
+        .i_size = 0,
+        .i_slices = 1,
+    };
+    size_t i_total;
+
+    if( picture_CanCoalesce( p_dst, p_src ) )
+    {
+        /* All the planes at once, margins included */
+        copy.i_size = i_total = picture_GetContiguousSize( p_src );
+    }
+    else
+    {
+        i_total = 0;
+        for( int i = 0; i < p_src->i_planes; i++ )
+            i_total += p_src->p[i].i_pitch * p_src->p[i].i_visible_lines;
+    }
 
-    for( i = 0; i < p_src->i_planes ; i++ )
-        plane_CopyPixels( p_dst->p+i, p_src->p+i );
+    if( i_total >= PICTURE_PARALLEL_COPY_MIN )
+        copy.i_slices = vlc_workers_GetCount();
+
+    if( copy.i_slices > 1 )
+        vlc_workers_Run( picture_CopySlice, &copy, copy.i_slices );
+    else
+        picture_CopySlice( &copy, 0 );
 }
 
 void plane_CopyPixels( plane_t *p_dst, const plane_t *p_src )
@@ -169,6 +169,10 @@ void stats_ComputeInputStats( input_thread_t *p_input, input_stats_t *p_stats )
                       &p_stats->i_read_bytes );
     stats_GetFloat( p_input, p_input->p->counters.p_input_bitrate,
                     &p_stats->f_input_bitrate );
+    stats_GetInteger( p_input, p_input->p->counters.p_read_cache_hits,
+                      &p_stats->i_read_cache_hits );
+    stats_GetInteger( p_input, p_input->p->counters.p_read_cache_misses,
+                      &p_stats->i_read_cache_misses );
     stats_GetInteger( p_input, p_input->p->counters.p_demux_read,
                       &p_stats->i_demux_read_bytes );
     stats_GetFloat( p_input, p_input->p->counters.p_demux_bitrate,
@@ -178,6 +182,14 @@ void stats_ComputeInputStats( input_thread_t *p_input, input_stats_t *p_stats )
     stats_GetInteger( p_input, p_input->p->counters.p_demux_discontinuity,
                       &p_stats->i_demux_discontinuity );
 
+    /* Clock */
+    stats_GetInteger( p_input, p_input->p->counters.p_clock_drift,
+                      &p_stats->i_clock_drift );
+    stats_GetInteger( p_input, p_input->p->counters.p_clock_jitter,
+                      &p_stats->i_clock_jitter );
+    stats_GetInteger( p_input, p_input->p->counters.p_clock_buffering,
+                      &p_stats->i_clock_buffering );
+
     /* Decoders */
     stats_GetInteger( p_input, p_input->p->counters.p_decoded_video,
                       &p_stats->i_decoded_video );
@@ -216,9 +228,12 @@ void stats_ReinitInputStats( input_stats_t *p_stats )
     vlc_mutex_lock( &p_stats->lock );
     p_stats->i_read_packets = p_stats->i_read_bytes =
     p_stats->f_input_bitrate = p_stats->f_average_input_bitrate =
+    p_stats->i_read_cache_hits = p_stats->i_read_cache_misses =
     p_stats->i_demux_read_packets = p_stats->i_demux_read_bytes =
     p_stats->f_demux_bitrate = p_stats->f_average_demux_bitrate =
     p_stats->i_demux_corrupted = p_stats->i_demux_discontinuity =
+    p_stats->i_clock_drift = p_stats->i_clock_jitter =
+    p_stats->i_clock_buffering =
     p_stats->i_displayed_pictures = p_stats->i_lost_pictures =
     p_stats->i_played_abuffers = p_stats->i_lost_abuffers =
     p_stats->i_decoded_video = p_stats->i_decoded_audio =
@@ -0,0 +1,198 @@
+/*****************************************************************************
+ * workers.c: shared pool of worker threads for data parallel jobs
+ *****************************************************************************
+ * Copyright (C) 2011 the VideoLAN team
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <assert.h>
+
+#include <vlc_common.h>
+#include "libvlc.h"
+
+/*
+ * The pool is shared by all LibVLC instances of the process. It only runs
+ * one batch of jobs at a time: if it is busy, the caller simply does all
+ * the work by itself rather than waiting for the other batch to complete.
+ */
+static vlc_mutex_t lock = VLC_STATIC_MUTEX;
+/* Serializes the starting and the stopping of the pool, as the threads are
+ * joined without the pool lock */
+static vlc_mutex_t init_lock = VLC_STATIC_MUTEX;
+static struct
+{
+    unsigned     refs;
+    unsigned     count;
+    vlc_thread_t *threads;
+    vlc_cond_t   wait;
+    vlc_cond_t   done;
+    bool         quit;
+
+    /* Current batch */
+    bool         busy;
+    void       (*pf_job)( void *, unsigned );
+    void         *data;
+    unsigned     jobs;
+    unsigned     next;
+    unsigned     pending;
+} pool;
+
+static void *Thread( void *data )
+{
+    VLC_UNUSED(data);
+
+    vlc_mutex_lock( &lock );
+    for( ;; )
+    {
+        if( pool.quit )
+            break;
+        if( pool.busy && pool.next < pool.jobs )
+        {
+            const unsigned i = pool.next++;
+
+            vlc_mutex_unlock( &lock );
+            pool.pf_job( pool.data, i );
+            vlc_mutex_lock( &lock );
+            if( --pool.pending == 0 )
+                vlc_cond_signal( &pool.done );
+            continue;
+        }
+        vlc_cond_wait( &pool.wait, &lock );
+    }
+    vlc_mutex_unlock( &lock );
+    return NULL;
+}
+
+/**
+ * Takes a reference to the worker pool, starting it with the given number
+ * of threads if it is not running yet.
+ */
+void vlc_workers_Init( unsigned count )
+{
+    vlc_mutex_lock( &init_lock );
+    vlc_mutex_lock( &lock );
+    if( pool.refs++ > 0 )
+        goto out;
+
+    vlc_cond_init( &pool.wait );
+    vlc_cond_init( &pool.done );
+    pool.quit = false;
+    pool.busy = false;
+    pool.count = 0;
+    pool.threads = count > 0 ? malloc( count * sizeof(*pool.threads) ) : NULL;
+    if( !pool.threads )
+        goto out;
+
+    for( unsigned i = 0; i < count; i++ )
+    {
+        if( vlc_clone( &pool.threads[pool.count], Thread, NULL,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+            break;
+        pool.count++;
+    }
+out:
+    vlc_mutex_unlock( &lock );
+    vlc_mutex_unlock( &init_lock );
+}
+
+/**
+ * Releases a reference to the worker pool, and stops it when the last
+ * reference is gone.
+ */
+void vlc_workers_Deinit( void )
+{
+    vlc_mutex_lock( &init_lock );
+    vlc_mutex_lock( &lock );
+    assert( pool.refs > 0 );
+    if( --pool.refs > 0 )
+    {
+        vlc_mutex_unlock( &lock );
+        vlc_mutex_unlock( &init_lock );
+        return;
+    }
+    pool.quit = true;
+    vlc_cond_broadcast( &pool.wait );
+    vlc_mutex_unlock( &lock );
+
+    for( unsigned i = 0; i < pool.count; i++ )
+        vlc_join( pool.threads[i], NULL );
+    free( pool.threads );
+    pool.threads = NULL;
+    pool.count = 0;
+
+    vlc_cond_destroy( &pool.done );
+    vlc_cond_destroy( &pool.wait );
+    vlc_mutex_unlock( &init_lock );
+}
+
+/**
+ * Returns the number of jobs that can run concurrently, the calling thread
+ * included.
+ */
+unsigned vlc_workers_GetCount( void )
+{
+    vlc_mutex_lock( &lock );
+    const unsigned count = pool.refs > 0 ? pool.count : 0;
+    vlc_mutex_unlock( &lock );
+    return 1 + count;
+}
+
+/**
+ * Runs pf_job( data, i ) for i in [0, jobs) and waits for all the jobs to
+ * be completed. The calling thread takes part in the work, so this is safe
+ * to call even when the pool is not running.
+ */
+void vlc_workers_Run( void (*pf_job)( void *, unsigned ), void *data,
+                      unsigned jobs )
+{
+    vlc_mutex_lock( &lock );
+    if( pool.refs == 0 || pool.count == 0 || pool.busy || jobs <= 1 )
+    {
+        vlc_mutex_unlock( &lock );
+        for( unsigned i = 0; i < jobs; i++ )
+            pf_job( data, i );
+        return;
+    }
+
+    pool.busy    = true;
+    pool.pf_job  = pf_job;
+    pool.data    = data;
+    pool.jobs    = jobs;
+    pool.next    = 0;
+    pool.pending = jobs;
+    vlc_cond_broadcast( &pool.wait );
+
+    while( pool.next < pool.jobs )
+    {
+        const unsigned i = pool.next++;
+
+        vlc_mutex_unlock( &lock );
+        pf_job( data, i );
+        vlc_mutex_lock( &lock );
+        pool.pending--;
+    }
+
+    int canc = vlc_savecancel();
+    while( pool.pending > 0 )
+        vlc_cond_wait( &pool.done, &lock );
+    vlc_restorecancel( canc );
+    pool.busy = false;
+    vlc_mutex_unlock( &lock );
+}
@@ -34,12 +34,17 @@
 #include <vlc_stream.h>
 #include <vlc_url.h>
 #include <vlc_md5.h>
+#include <vlc_block.h>
+#include <vlc_image.h>
 
 #include <limits.h>                                             /* PATH_MAX */
 
 #ifdef HAVE_SYS_STAT_H
 #   include <sys/stat.h>
 #endif
+#ifdef HAVE_UNISTD_H
+#   include <unistd.h>
+#endif
 
 #include "../libvlc.h"
 #include "playlist_internal.h"
@@ -132,70 +137,211 @@ end:
     return psz_path;
 }
 
-static char *ArtCacheName( input_item_t *p_item, const char *psz_type )
+/*
+ * The art is stored once per content, named after the MD5 of its data, in
+ * the "art/data" cache directory: the same cover embedded in every track of
+ * an album only takes one file. The album (or art URL) directory only holds
+ * a reference file with the name of the data file.
+ *
+ * Thumbnails are stored in "art/thumb/<size>", named after the MD5 of the
+ * art URL, which is itself derived from the content for cached art.
+ */
+#define ART_CACHE_REF "ref"
+
+static const unsigned pi_art_thumb_sizes[] = { 64, 128, 256 };
+
+static char *ArtCacheDataPath( const char *psz_name, bool b_create )
 {
-    char *psz_path = ArtCachePath( p_item );
-    if( !psz_path )
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    char *psz_dir, *psz_path = NULL;
+
+    if( psz_cachedir == NULL )
+        return NULL;
+    if( asprintf( &psz_dir, "%s" DIR_SEP "art" DIR_SEP "data",
+                  psz_cachedir ) == -1 )
+        psz_dir = NULL;
+    free( psz_cachedir );
+    if( psz_dir == NULL )
         return NULL;
 
-    ArtCacheCreateDir( psz_path );
+    if( b_create )
+        ArtCacheCreateDir( psz_dir );
+    if( asprintf( &psz_path, "%s" DIR_SEP "%s", psz_dir, psz_name ) == -1 )
+        psz_path = NULL;
+    free( psz_dir );
+    return psz_path;
+}
+
+static char *ArtCacheDataName( const uint8_t *p_buffer, int i_buffer,
+                               const char *psz_type )
+{
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, p_buffer, i_buffer );
+    EndMD5( &md5 );
 
+    char *psz_hash = psz_md5_hash( &md5 );
     char *psz_ext = strdup( psz_type ? psz_type : "" );
-    filename_sanitize( psz_ext );
-    char *psz_filename;
-    if( asprintf( &psz_filename, "%s" DIR_SEP "art%s", psz_path, psz_ext ) < 0 )
-        psz_filename = NULL;
+    char *psz_name;
 
+    if( psz_hash == NULL || psz_ext == NULL )
+        psz_name = NULL;
+    else
+    {
+        filename_sanitize( psz_ext );
+        if( asprintf( &psz_name, "%s%s", psz_hash, psz_ext ) == -1 )
+            psz_name = NULL;
+    }
     free( psz_ext );
-    free( psz_path );
+    free( psz_hash );
+    return psz_name;
+}
+
+static char *ArtThumbnailPath( const char *psz_arturl, unsigned i_size,
+                               bool b_create )
+{
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    char *psz_dir, *psz_path = NULL;
+
+    if( psz_cachedir == NULL )
+        return NULL;
+    if( asprintf( &psz_dir, "%s" DIR_SEP "art" DIR_SEP "thumb" DIR_SEP "%u",
+                  psz_cachedir, i_size ) == -1 )
+        psz_dir = NULL;
+    free( psz_cachedir );
+    if( psz_dir == NULL )
+        return NULL;
+
+    if( b_create )
+        ArtCacheCreateDir( psz_dir );
 
-    return psz_filename;
+    struct md5_s md5;
+    InitMD5( &md5 );
+    AddMD5( &md5, psz_arturl, strlen( psz_arturl ) );
+    EndMD5( &md5 );
+
+    char *psz_hash = psz_md5_hash( &md5 );
+    if( psz_hash != NULL
+     && asprintf( &psz_path, "%s" DIR_SEP "%s.png", psz_dir, psz_hash ) == -1 )
+        psz_path = NULL;
+    free( psz_hash );
+    free( psz_dir );
+    return psz_path;
 }
 
-/* */
-int playlist_FindArtInCache( input_item_t *p_item )
+/* Writes a cache file atomically, as concurrent fetches may write it too */
+static int ArtCacheWriteFile( const char *psz_path,
+                              const void *p_data, size_t i_data )
 {
-    char *psz_path = ArtCachePath( p_item );
+    char *psz_tmp;
+    if( asprintf( &psz_tmp, "%s.XXXXXX", psz_path ) == -1 )
+        return VLC_ENOMEM;
 
-    if( !psz_path )
+    int fd = vlc_mkstemp( psz_tmp );
+    if( fd == -1 )
+    {
+        free( psz_tmp );
         return VLC_EGENERIC;
+    }
 
-    /* Check if file exists */
-    DIR *p_dir = vlc_opendir( psz_path );
-    if( !p_dir )
+    FILE *stream = fdopen( fd, "wb" );
+    bool b_ok = false;
+    if( stream != NULL )
     {
-        free( psz_path );
-        return VLC_EGENERIC;
+        b_ok = fwrite( p_data, 1, i_data, stream ) == i_data;
+        if( fclose( stream ) )
+            b_ok = false;
+    }
+    else
+        close( fd );
+
+    if( !b_ok || vlc_rename( psz_tmp, psz_path ) )
+    {
+        vlc_unlink( psz_tmp );
+        b_ok = false;
+    }
+    free( psz_tmp );
+    return b_ok ? VLC_SUCCESS : VLC_EGENERIC;
+}
+
+/* Returns the data file referenced by an album directory, if it exists */
+static char *ArtCacheReadRef( const char *psz_path )
+{
+    char *psz_ref;
+    if( asprintf( &psz_ref, "%s" DIR_SEP ART_CACHE_REF, psz_path ) == -1 )
+        return NULL;
+
+    FILE *stream = vlc_fopen( psz_ref, "rb" );
+    free( psz_ref );
+    if( stream == NULL )
+        return NULL;
+
+    char psz_name[64];
+    char *psz_file = NULL;
+    if( fgets( psz_name, sizeof(psz_name), stream ) != NULL )
+    {
+        psz_name[strcspn( psz_name, "\r\n" )] = '\0';
+
+        struct stat s;
+        if( psz_name[0] != '\0' && strchr( psz_name, DIR_SEP_CHAR ) == NULL )
+            psz_file = ArtCacheDataPath( psz_name, false );
+        if( psz_file != NULL && vlc_stat( psz_file, &s ) )
+        {
+            free( psz_file );
+            psz_file = NULL;
+        }
     }
+    fclose( stream );
+    return psz_file;
+}
 
-    bool b_found = false;
+/* Returns the art stored in an album directory by older versions */
+static char *ArtCacheFindFile( const char *psz_path )
+{
+    DIR *p_dir = vlc_opendir( psz_path );
+    if( !p_dir )
+        return NULL;
+
+    char *psz_file = NULL;
     char *psz_filename;
-    while( !b_found && (psz_filename = vlc_readdir( p_dir )) )
+    while( !psz_file && (psz_filename = vlc_readdir( p_dir )) )
     {
         if( !strncmp( psz_filename, "art", 3 ) )
         {
-            char *psz_file;
             if( asprintf( &psz_file, "%s" DIR_SEP "%s",
-                          psz_path, psz_filename ) != -1 )
-            {
-                char *psz_uri = make_URI( psz_file, "file" );
-                if( psz_uri )
-                {
-                    input_item_SetArtURL( p_item, psz_uri );
-                    free( psz_uri );
-                }
-                free( psz_file );
-            }
-
-            b_found = true;
+                          psz_path, psz_filename ) == -1 )
+                psz_file = NULL;
         }
         free( psz_filename );
     }
 
-    /* */
     closedir( p_dir );
+    return psz_file;
+}
+
+/* */
+int playlist_FindArtInCache( input_item_t *p_item )
+{
+    char *psz_path = ArtCachePath( p_item );
+
+    if( !psz_path )
+        return VLC_EGENERIC;
+
+    char *psz_file = ArtCacheReadRef( psz_path );
+    if( !psz_file )
+        psz_file = ArtCacheFindFile( psz_path );
     free( psz_path );
-    return b_found ? VLC_SUCCESS : VLC_EGENERIC;
+    if( !psz_file )
+        return VLC_EGENERIC;
+
+    char *psz_uri = make_URI( psz_file, "file" );
+    if( psz_uri )
+    {
+        input_item_SetArtURL( p_item, psz_uri );
+        free( psz_uri );
+    }
+    free( psz_file );
+    return VLC_SUCCESS;
 }
 
 
@@ -203,45 +349,185 @@ int playlist_FindArtInCache( input_item_t *p_item )
 int playlist_SaveArt( playlist_t *p_playlist, input_item_t *p_item,
                       const uint8_t *p_buffer, int i_buffer, const char *psz_type )
 {
-    char *psz_filename = ArtCacheName( p_item, psz_type );
-
-    if( !psz_filename )
+    /* The album directory depends on the art URL, get it before changing it */
+    char *psz_path = ArtCachePath( p_item );
+    if( !psz_path )
         return VLC_EGENERIC;
 
-    char *psz_uri = make_URI( psz_filename, "file" );
+    int i_ret = VLC_EGENERIC;
+    char *psz_name = ArtCacheDataName( p_buffer, i_buffer, psz_type );
+    char *psz_filename = psz_name ? ArtCacheDataPath( psz_name, true ) : NULL;
+    char *psz_uri = psz_filename ? make_URI( psz_filename, "file" ) : NULL;
     if( !psz_uri )
-    {
-        free( psz_filename );
-        return VLC_EGENERIC;
-    }
+        goto out;
 
-    /* Check if we already dumped it */
+    /* Check if we already dumped it, for this item or another one */
     struct stat s;
     if( !vlc_stat( psz_filename, &s ) )
+        msg_Dbg( p_playlist, "album art already stored as %s", psz_filename );
+    else if( ArtCacheWriteFile( psz_filename, p_buffer, i_buffer ) )
     {
-        input_item_SetArtURL( p_item, psz_uri );
-        free( psz_filename );
-        free( psz_uri );
-        return VLC_SUCCESS;
+        msg_Err( p_playlist, "%s: %m", psz_filename );
+        goto out;
     }
+    else
+        msg_Dbg( p_playlist, "album art saved to %s", psz_filename );
+
+    /* Reference it from the album directory */
+    char *psz_ref;
+    ArtCacheCreateDir( psz_path );
+    if( asprintf( &psz_ref, "%s" DIR_SEP ART_CACHE_REF, psz_path ) != -1 )
+    {
+        if( ArtCacheWriteFile( psz_ref, psz_name, strlen( psz_name ) ) )
+            msg_Warn( p_playlist, "%s: %m", psz_ref );
+        free( psz_ref );
+    }
+
+    input_item_SetArtURL( p_item, psz_uri );
+    i_ret = VLC_SUCCESS;
+out:
+    free( psz_uri );
+    free( psz_filename );
+    free( psz_name );
+    free( psz_path );
+    return i_ret;
+}
 
-    /* Dump it otherwise */
-    FILE *f = vlc_fopen( psz_filename, "wb" );
-    if( f )
+/* Writes the missing thumbnails of an art, decoding it at most once */
+static void ArtThumbnailWrite( playlist_t *p_playlist, const char *psz_arturl,
+                               const unsigned *pi_sizes, unsigned i_sizes )
+{
+    image_handler_t *p_image = NULL;
+    picture_t *p_pic = NULL;
+    video_format_t fmt_in, fmt_pic;
+
+    for( unsigned i = 0; i < i_sizes; i++ )
     {
-        if( fwrite( p_buffer, i_buffer, 1, f ) != 1 )
+        const unsigned i_size = pi_sizes[i];
+        char *psz_path = ArtThumbnailPath( psz_arturl, i_size, true );
+        struct stat s;
+
+        if( psz_path == NULL )
+            break;
+        if( !vlc_stat( psz_path, &s ) )
+        {
+            free( psz_path );
+            continue;
+        }
+
+        if( p_pic == NULL )
+        {
+            p_image = image_HandlerCreate( p_playlist );
+            if( p_image == NULL )
+            {
+                free( psz_path );
+                break;
+            }
+            memset( &fmt_in, 0, sizeof(fmt_in) );
+            memset( &fmt_pic, 0, sizeof(fmt_pic) );
+            p_pic = image_ReadUrl( p_image, psz_arturl, &fmt_in, &fmt_pic );
+            if( p_pic == NULL || !fmt_pic.i_width || !fmt_pic.i_height )
+            {
+                msg_Dbg( p_playlist, "cannot decode %s", psz_arturl );
+                free( psz_path );
+                break;
+            }
+        }
+
+        /* Fit the art in the box, without upscaling it */
+        unsigned i_width = fmt_pic.i_width, i_height = fmt_pic.i_height;
+        if( fmt_pic.i_sar_num && fmt_pic.i_sar_den )
+            i_width = (uint64_t)i_width * fmt_pic.i_sar_num / fmt_pic.i_sar_den;
+        if( i_width > i_size || i_height > i_size )
         {
-            msg_Err( p_playlist, "%s: %m", psz_filename );
+            if( i_width >= i_height )
+            {
+                i_height = __MAX( 1, (uint64_t)i_height * i_size / i_width );
+                i_width = i_size;
+            }
+            else
+            {
+                i_width = __MAX( 1, (uint64_t)i_width * i_size / i_height );
+                i_height = i_size;
+            }
         }
-        else
+
+        video_format_t fmt_out;
+        memset( &fmt_out, 0, sizeof(fmt_out) );
+        fmt_out.i_chroma = VLC_CODEC_PNG;
+        fmt_out.i_width = fmt_out.i_visible_width = i_width;
+        fmt_out.i_height = fmt_out.i_visible_height = i_height;
+        fmt_out.i_sar_num = fmt_out.i_sar_den = 1;
+
+        block_t *p_block = image_Write( p_image, p_pic, &fmt_pic, &fmt_out );
+        if( p_block != NULL )
         {
-            msg_Dbg( p_playlist, "album art saved to %s", psz_filename );
-            input_item_SetArtURL( p_item, psz_uri );
+            if( ArtCacheWriteFile( psz_path, p_block->p_buffer,
+                                   p_block->i_buffer ) )
+                msg_Warn( p_playlist, "%s: %m", psz_path );
+            block_Release( p_block );
         }
-        fclose( f );
+        free( psz_path );
     }
-    free( psz_filename );
-    free( psz_uri );
-    return VLC_SUCCESS;
+
+    if( p_pic != NULL )
+        picture_Release( p_pic );
+    if( p_image != NULL )
+        image_HandlerDelete( p_image );
+}
+
+/* */
+void playlist_MakeArtThumbnails( playlist_t *p_playlist, input_item_t *p_item )
+{
+    char *psz_arturl = input_item_GetArtURL( p_item );
+
+    /* Only the cached or local art, the rest would be downloaded again */
+    if( psz_arturl && !strncmp( psz_arturl, "file://", 7 ) )
+        ArtThumbnailWrite( p_playlist, psz_arturl, pi_art_thumb_sizes,
+                           sizeof(pi_art_thumb_sizes)
+                             / sizeof(pi_art_thumb_sizes[0]) );
+    free( psz_arturl );
 }
 
+/**
+ * Returns the URI of a thumbnail of the art of an input item, fitting in a
+ * square of the given size (or of the closest stored size above it).
+ *
+ * The thumbnail is stored by the art fetcher for the common sizes, and
+ * created otherwise. This may therefore block while decoding the art.
+ *
+ * \return a file URI (to be freed), or NULL if the item has no local art
+ */
+char *playlist_GetArtThumbnail( playlist_t *p_playlist, input_item_t *p_item,
+                                unsigned i_size )
+{
+    const unsigned i_sizes = sizeof(pi_art_thumb_sizes)
+                           / sizeof(pi_art_thumb_sizes[0]);
+
+    if( i_size == 0 || i_size > pi_art_thumb_sizes[i_sizes - 1] )
+        i_size = pi_art_thumb_sizes[i_sizes - 1];
+    for( unsigned i = 0; i < i_sizes; i++ )
+        if( i_size <= pi_art_thumb_sizes[i] )
+        {
+            i_size = pi_art_thumb_sizes[i];
+            break;
+        }
+
+    char *psz_arturl = input_item_GetArtURL( p_item );
+    if( !psz_arturl || strncmp( psz_arturl, "file://", 7 ) )
+    {
+        free( psz_arturl );
+        return NULL;
+    }
+
+    ArtThumbnailWrite( p_playlist, psz_arturl, &i_size, 1 );
+
+    char *psz_uri = NULL;
+    char *psz_path = ArtThumbnailPath( psz_arturl, i_size, false );
+    struct stat s;
+    if( psz_path && !vlc_stat( psz_path, &s ) )
+        psz_uri = make_URI( psz_path, "file" );
+    free( psz_path );
+    free( psz_arturl );
+    return psz_uri;
+}
@@ -38,5 +38,7 @@ int playlist_FindArtInCache( input_item_t * );
 
 int playlist_SaveArt( playlist_t *, input_item_t *, const uint8_t *p_buffer, int i_buffer, const char *psz_type );
 
+void playlist_MakeArtThumbnails( playlist_t *, input_item_t * );
+
 #endif
 
@@ -204,7 +204,18 @@ int playlist_PreparseEnqueue( playlist_t *p_playlist, input_item_t *p_item )
     playlist_private_t *p_sys = pl_priv(p_playlist);
 
     if( p_sys->p_preparser )
-        playlist_preparser_Push( p_sys->p_preparser, p_item );
+        playlist_preparser_Push( p_sys->p_preparser, p_item, false );
+
+    return VLC_SUCCESS;
+}
+
+/** Enqueue an item for preparsing, ahead of the other waiting items */
+int playlist_PreparsePrioritize( playlist_t *p_playlist, input_item_t *p_item )
+{
+    playlist_private_t *p_sys = pl_priv(p_playlist);
+
+    if( p_sys->p_preparser )
+        playlist_preparser_Push( p_sys->p_preparser, p_item, true );
 
     return VLC_SUCCESS;
 }
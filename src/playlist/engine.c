@@ -184,6 +184,7 @@ playlist_t * playlist_Create( vlc_object_t *p_parent )
     p_playlist->i_current_index = 0;
     pl_priv(p_playlist)->b_reset_currently_playing = true;
     pl_priv(p_playlist)->last_rebuild_date = 0;
+    pl_priv(p_playlist)->search.psz_string = NULL;
 
     pl_priv(p_playlist)->b_tree = var_InheritBool( p_parent, "playlist-tree" );
 
@@ -290,17 +291,14 @@ void playlist_Destroy( playlist_t *p_playlist )
 
     /* Remove all remaining items */
     FOREACH_ARRAY( playlist_item_t *p_del, p_playlist->all_items )
-        free( p_del->pp_children );
-        vlc_gc_decref( p_del->p_input );
-        free( p_del );
+        playlist_ItemDelete( p_del );
     FOREACH_END();
     ARRAY_RESET( p_playlist->all_items );
     FOREACH_ARRAY( playlist_item_t *p_del, p_sys->items_to_delete )
-        free( p_del->pp_children );
-        vlc_gc_decref( p_del->p_input );
-        free( p_del );
+        playlist_ItemDelete( p_del );
     FOREACH_END();
     ARRAY_RESET( p_sys->items_to_delete );
+    free( p_sys->search.psz_string );
 
     ARRAY_RESET( p_playlist->items );
     ARRAY_RESET( p_playlist->current );
@@ -49,7 +49,8 @@ struct playlist_fetcher_t
 
     vlc_mutex_t     lock;
     vlc_cond_t      wait;
-    bool            b_live;
+    int             i_live;
+    int             i_live_max;
     int             i_art_policy;
     int             i_waiting;
     input_item_t    **pp_waiting;
@@ -72,7 +73,10 @@ playlist_fetcher_t *playlist_fetcher_New( playlist_t *p_playlist )
     p_fetcher->p_playlist = p_playlist;
     vlc_mutex_init( &p_fetcher->lock );
     vlc_cond_init( &p_fetcher->wait );
-    p_fetcher->b_live = false;
+    p_fetcher->i_live = 0;
+    p_fetcher->i_live_max = var_InheritInteger( p_playlist, "fetch-threads" );
+    if( p_fetcher->i_live_max <= 0 )
+        p_fetcher->i_live_max = 1;
     p_fetcher->i_waiting = 0;
     p_fetcher->pp_waiting = NULL;
     p_fetcher->i_art_policy = var_GetInteger( p_playlist, "album-art" );
@@ -84,19 +88,31 @@ playlist_fetcher_t *playlist_fetcher_New( playlist_t *p_playlist )
 void playlist_fetcher_Push( playlist_fetcher_t *p_fetcher,
                             input_item_t *p_item )
 {
-    vlc_gc_incref( p_item );
-
     vlc_mutex_lock( &p_fetcher->lock );
+    /* The item may be requested again before its art is fetched */
+    for( int i = 0; i < p_fetcher->i_waiting; i++ )
+        if( p_fetcher->pp_waiting[i] == p_item )
+        {
+            vlc_mutex_unlock( &p_fetcher->lock );
+            return;
+        }
+
+    vlc_gc_incref( p_item );
     INSERT_ELEM( p_fetcher->pp_waiting, p_fetcher->i_waiting,
                  p_fetcher->i_waiting, p_item );
-    if( !p_fetcher->b_live )
+
+    /* The threads exit once the queue is empty, so there is no idle one */
+    if( p_fetcher->i_live < p_fetcher->i_live_max )
     {
         if( vlc_clone_detach( NULL, Thread, p_fetcher,
                               VLC_THREAD_PRIORITY_LOW ) )
-            msg_Err( p_fetcher->p_playlist,
-                     "cannot spawn secondary preparse thread" );
+        {
+            if( p_fetcher->i_live == 0 )
+                msg_Err( p_fetcher->p_playlist,
+                         "cannot spawn secondary preparse thread" );
+        }
         else
-            p_fetcher->b_live = true;
+            p_fetcher->i_live++;
     }
     vlc_mutex_unlock( &p_fetcher->lock );
 }
@@ -111,12 +127,19 @@ void playlist_fetcher_Delete( playlist_fetcher_t *p_fetcher )
         REMOVE_ELEM( p_fetcher->pp_waiting, p_fetcher->i_waiting, 0 );
     }
 
-    while( p_fetcher->b_live )
+    while( p_fetcher->i_live > 0 )
         vlc_cond_wait( &p_fetcher->wait, &p_fetcher->lock );
     vlc_mutex_unlock( &p_fetcher->lock );
 
     vlc_cond_destroy( &p_fetcher->wait );
     vlc_mutex_destroy( &p_fetcher->lock );
+
+    FOREACH_ARRAY( playlist_album_t album, p_fetcher->albums )
+        free( album.psz_artist );
+        free( album.psz_album );
+        free( album.psz_arturl );
+    FOREACH_END();
+    ARRAY_RESET( p_fetcher->albums );
     free( p_fetcher );
 }
 
@@ -149,30 +172,42 @@ static int FindArt( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
     /* If we already checked this album in this session, skip */
     if( psz_artist && psz_album )
     {
+        bool b_searched = false, b_found = false;
+        char *psz_album_arturl = NULL;
+
+        /* Other threads may be recording albums */
+        vlc_mutex_lock( &p_fetcher->lock );
         FOREACH_ARRAY( playlist_album_t album, p_fetcher->albums )
             if( !strcmp( album.psz_artist, psz_artist ) &&
                 !strcmp( album.psz_album, psz_album ) )
             {
-                msg_Dbg( p_fetcher->p_playlist,
-                         " %s - %s has already been searched",
-                         psz_artist, psz_album );
-                /* TODO-fenrir if we cache art filename too, we can go faster */
-                free( psz_artist );
-                free( psz_album );
-                if( album.b_found )
-                {
-                    if( !strncmp( album.psz_arturl, "file://", 7 ) )
-                        input_item_SetArtURL( p_item, album.psz_arturl );
-                    else /* Actually get URL from cache */
-                        playlist_FindArtInCache( p_item );
-                    return 0;
-                }
-                else
-                {
-                    return VLC_EGENERIC;
-                }
+                b_searched = true;
+                b_found = album.b_found;
+                if( album.psz_arturl )
+                    psz_album_arturl = strdup( album.psz_arturl );
+                break;
             }
         FOREACH_END();
+        vlc_mutex_unlock( &p_fetcher->lock );
+
+        if( b_searched )
+        {
+            msg_Dbg( p_fetcher->p_playlist,
+                     " %s - %s has already been searched",
+                     psz_artist, psz_album );
+            free( psz_artist );
+            free( psz_album );
+            if( b_found )
+            {
+                if( psz_album_arturl &&
+                    !strncmp( psz_album_arturl, "file://", 7 ) )
+                    input_item_SetArtURL( p_item, psz_album_arturl );
+                else /* Actually get URL from cache */
+                    playlist_FindArtInCache( p_item );
+            }
+            free( psz_album_arturl );
+            return b_found ? 0 : VLC_EGENERIC;
+        }
     }
     free( psz_artist );
     free( psz_album );
@@ -247,7 +282,9 @@ static int FindArt( playlist_fetcher_t *p_fetcher, input_item_t *p_item )
         a.psz_album = psz_album;
         a.psz_arturl = input_item_GetArtURL( p_item );
         a.b_found = (i_ret == VLC_EGENERIC ? false : true );
+        vlc_mutex_lock( &p_fetcher->lock );
         ARRAY_APPEND( p_fetcher->albums, a );
+        vlc_mutex_unlock( &p_fetcher->lock );
     }
     else
     {
@@ -420,7 +457,7 @@ static void *Thread( void *p_data )
         }
         else
         {
-            p_fetcher->b_live = false;
+            p_fetcher->i_live--;
             vlc_cond_signal( &p_fetcher->wait );
         }
         vlc_mutex_unlock( &p_fetcher->lock );
@@ -449,6 +486,8 @@ static void *Thread( void *p_data )
         if( !i_ret ) /* Art is now in cache */
         {
             PL_DEBUG( "found art for %s in cache", psz_name );
+            /* Scale it once here rather than in every interface */
+            playlist_MakeArtThumbnails( p_playlist, p_item );
             input_item_SetArtFetched( p_item, true );
             var_SetAddress( p_playlist, "item-change", p_item );
         }
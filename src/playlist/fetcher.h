@@ -34,7 +34,7 @@
 typedef struct playlist_fetcher_t playlist_fetcher_t;
 
 /**
- * This function creates the fetcher object and thread.
+ * This function creates the fetcher object. Its threads are spawned on demand.
  */
 playlist_fetcher_t *playlist_fetcher_New( playlist_t * );
 
@@ -47,7 +47,7 @@ playlist_fetcher_t *playlist_fetcher_New( playlist_t * );
 void playlist_fetcher_Push( playlist_fetcher_t *, input_item_t * );
 
 /**
- * This function destroys the fetcher object and thread.
+ * This function destroys the fetcher object and waits for its threads.
  *
  * All pending input items will be released.
  */
@@ -180,6 +180,8 @@ static void input_item_changed( const vlc_event_t * p_event,
 {
     playlist_item_t *p_item = user_data;
     VLC_UNUSED( p_event );
+    /* The keys are rebuilt with the playlist lock, when they are used */
+    vlc_atomic_set( &pli_priv(p_item)->stale, 1 );
     var_SetAddress( p_item->p_playlist, "item-change", p_item->p_input );
 }
 
@@ -226,10 +228,12 @@ static void uninstall_input_item_observer( playlist_item_t * p_item )
 playlist_item_t *playlist_ItemNewFromInput( playlist_t *p_playlist,
                                               input_item_t *p_input )
 {
-    playlist_item_t* p_item = malloc( sizeof( playlist_item_t ) );
-    if( !p_item )
+    playlist_item_private_t *p = malloc( sizeof( *p ) );
+    if( !p )
         return NULL;
 
+    playlist_item_t *p_item = &p->public_data;
+
     assert( p_input );
 
     p_item->p_input = p_input;
@@ -243,11 +247,33 @@ playlist_item_t *playlist_ItemNewFromInput( playlist_t *p_playlist,
     p_item->i_flags = 0;
     p_item->p_playlist = p_playlist;
 
+    vlc_atomic_set( &p->stale, 1 );
+    p->psz_search = NULL;
+    p->psz_title = NULL;
+    for( int i = 0; i < PLAYLIST_KEY_COUNT; i++ )
+        p->ppsz_keys[i] = NULL;
+    p->i_duration = 0;
+    p->i_keys_gen = 0;
+    p->i_search_gen = 0;
+
     install_input_item_observer( p_item );
 
     return p_item;
 }
 
+/**
+ * Free an item that is not referenced by the playlist anymore
+ *
+ * \param p_item item to free
+ */
+void playlist_ItemDelete( playlist_item_t *p_item )
+{
+    playlist_ItemCleanKeys( p_item );
+    free( p_item->pp_children );
+    vlc_gc_decref( p_item->p_input );
+    free( pli_priv(p_item) );
+}
+
 /***************************************************************************
  * Playlist item destruction
  ***************************************************************************/
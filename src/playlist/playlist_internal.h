@@ -36,6 +36,7 @@
 
 #include "input/input_interface.h"
 #include <assert.h>
+#include <vlc_atomic.h>
 
 #include "art.h"
 #include "fetcher.h"
@@ -91,10 +92,46 @@ typedef struct playlist_private_t
     bool     b_auto_preparse;
     mtime_t  last_rebuild_date;
 
+    struct {
+        /* Last live search, refined by the next one if it extends it */
+        char *              psz_string; /**< Folded search string */
+        int                 i_root;     /**< Id of the searched node */
+        bool                b_recursive;
+    } search;
+
 } playlist_private_t;
 
 #define pl_priv( pl ) ((playlist_private_t *)(pl))
 
+/* Sort keys cached by the playlist items */
+enum
+{
+    PLAYLIST_KEY_ALBUM,
+    PLAYLIST_KEY_ARTIST,
+    PLAYLIST_KEY_GENRE,
+    PLAYLIST_KEY_TRACK_NUMBER,
+    PLAYLIST_KEY_DESCRIPTION,
+    PLAYLIST_KEY_RATING,
+    PLAYLIST_KEY_COUNT
+};
+
+typedef struct playlist_item_private_t
+{
+    playlist_item_t     public_data;
+
+    /* The keys are only accessed with the playlist lock, and rebuilt from
+     * the input item when it has changed since */
+    vlc_atomic_t        stale;        /**< Input item changed */
+    char               *psz_search;   /**< Folded title, album and artist */
+    char               *psz_title;    /**< Title, or name */
+    char               *ppsz_keys[PLAYLIST_KEY_COUNT]; /**< Meta sort keys */
+    mtime_t             i_duration;
+    unsigned            i_keys_gen;   /**< Bumped when the keys are rebuilt */
+    unsigned            i_search_gen; /**< i_keys_gen at the last search */
+} playlist_item_private_t;
+
+#define pli_priv( pli ) ((playlist_item_private_t *)(pli))
+
 /*****************************************************************************
  * Prototypes
  *****************************************************************************/
@@ -111,6 +148,12 @@ void pl_Deactivate (libvlc_int_t *);
 /* */
 playlist_item_t *playlist_ItemNewFromInput( playlist_t *p_playlist,
                                             input_item_t *p_input );
+void playlist_ItemDelete( playlist_item_t * );
+
+/* Search and sort keys */
+void playlist_ItemUpdateKeys( playlist_item_t * );
+void playlist_ItemCleanKeys( playlist_item_t * );
+char *playlist_FoldString( const char * );
 
 /* Engine */
 playlist_item_t * get_current_status_item( playlist_t * p_playlist);
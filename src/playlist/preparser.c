@@ -27,6 +27,7 @@
 
 #include <vlc_common.h>
 #include <vlc_playlist.h>
+#include <vlc_cpu.h>
 
 #include "art.h"
 #include "fetcher.h"
@@ -44,10 +45,14 @@ struct playlist_preparser_t
 
     vlc_mutex_t     lock;
     vlc_cond_t      wait;
-    bool            b_live;
+    int             i_live;     /* Number of running threads */
+    int             i_live_max;
     input_item_t  **pp_waiting;
     int             i_waiting;
+    int             i_urgent;   /* Number of items jumping the queue, which
+                                   are at the head of pp_waiting */
 
+    mtime_t         i_timeout;
     int             i_art_policy;
 };
 
@@ -66,29 +71,62 @@ playlist_preparser_t *playlist_preparser_New( playlist_t *p_playlist, playlist_f
     p_preparser->p_fetcher = p_fetcher;
     vlc_mutex_init( &p_preparser->lock );
     vlc_cond_init( &p_preparser->wait );
-    p_preparser->b_live = false;
+    p_preparser->i_live = 0;
+    p_preparser->i_live_max = var_InheritInteger( p_playlist, "preparse-threads" );
+    if( p_preparser->i_live_max <= 0 )
+        p_preparser->i_live_max = vlc_GetCPUCount();
+    p_preparser->i_timeout = INT64_C(1000) *
+                             var_InheritInteger( p_playlist, "preparse-timeout" );
     p_preparser->i_art_policy = var_GetInteger( p_playlist, "album-art" );
     p_preparser->i_waiting = 0;
+    p_preparser->i_urgent = 0;
     p_preparser->pp_waiting = NULL;
 
     return p_preparser;
 }
 
-void playlist_preparser_Push( playlist_preparser_t *p_preparser, input_item_t *p_item )
+void playlist_preparser_Push( playlist_preparser_t *p_preparser,
+                              input_item_t *p_item, bool b_urgent )
 {
     vlc_gc_incref( p_item );
 
     vlc_mutex_lock( &p_preparser->lock );
-    INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
-                 p_preparser->i_waiting, p_item );
-    if( !p_preparser->b_live )
+    if( b_urgent )
+    {
+        /* Move the item to the head of the queue if it is already waiting */
+        for( int i = 0; i < p_preparser->i_waiting; i++ )
+        {
+            if( p_preparser->pp_waiting[i] != p_item )
+                continue;
+
+            vlc_gc_decref( p_item );
+            if( i < p_preparser->i_urgent )
+            {
+                vlc_mutex_unlock( &p_preparser->lock );
+                return;
+            }
+            REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, i );
+            break;
+        }
+        INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
+                     p_preparser->i_urgent, p_item );
+        p_preparser->i_urgent++;
+    }
+    else
+    {
+        INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
+                     p_preparser->i_waiting, p_item );
+    }
+
+    /* The threads exit once the queue is empty, so there is no idle one */
+    if( p_preparser->i_live < p_preparser->i_live_max )
     {
         if( vlc_clone_detach( NULL, Thread, p_preparser,
                               VLC_THREAD_PRIORITY_LOW ) )
             msg_Warn( p_preparser->p_playlist,
                       "cannot spawn pre-parser thread" );
         else
-            p_preparser->b_live = true;
+            p_preparser->i_live++;
     }
     vlc_mutex_unlock( &p_preparser->lock );
 }
@@ -102,8 +140,9 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
         vlc_gc_decref( p_preparser->pp_waiting[0] );
         REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
     }
+    p_preparser->i_urgent = 0;
 
-    while( p_preparser->b_live )
+    while( p_preparser->i_live > 0 )
         vlc_cond_wait( &p_preparser->wait, &p_preparser->lock );
     vlc_mutex_unlock( &p_preparser->lock );
 
@@ -119,8 +158,10 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 /**
  * This function preparses an item when needed.
  */
-static void Preparse( playlist_t *p_playlist, input_item_t *p_item )
+static void Preparse( playlist_preparser_t *p_preparser, input_item_t *p_item )
 {
+    playlist_t *p_playlist = p_preparser->p_playlist;
+
     vlc_mutex_lock( &p_item->lock );
     int i_type = p_item->i_type;
     vlc_mutex_unlock( &p_item->lock );
@@ -128,18 +169,29 @@ static void Preparse( playlist_t *p_playlist, input_item_t *p_item )
     if( i_type != ITEM_TYPE_FILE )
         return;
 
-    stats_TimerStart( p_playlist, "Preparse run", STATS_TIMER_PREPARSE );
+    /* The timer cannot measure concurrent runs */
+    const bool b_timer = p_preparser->i_live_max == 1;
+    if( b_timer )
+        stats_TimerStart( p_playlist, "Preparse run", STATS_TIMER_PREPARSE );
 
     /* Do not preparse if it is already done (like by playing it) */
     if( !input_item_IsPreparsed( p_item ) )
     {
-        input_Preparse( VLC_OBJECT(p_playlist), p_item );
+        if( input_Preparse( VLC_OBJECT(p_playlist), p_item,
+                            p_preparser->i_timeout ) == VLC_ETIMEOUT )
+        {
+            char *psz_uri = input_item_GetURI( p_item );
+            msg_Warn( p_playlist, "preparsing of %s timed out",
+                      psz_uri ? psz_uri : "(null)" );
+            free( psz_uri );
+        }
         input_item_SetPreparsed( p_item, true );
 
         var_SetAddress( p_playlist, "item-change", p_item );
     }
 
-    stats_TimerStop( p_playlist, STATS_TIMER_PREPARSE );
+    if( b_timer )
+        stats_TimerStop( p_playlist, STATS_TIMER_PREPARSE );
 }
 
 /**
@@ -189,7 +241,6 @@ static void Art( playlist_preparser_t *p_preparser, input_item_t *p_item )
 static void *Thread( void *data )
 {
     playlist_preparser_t *p_preparser = data;
-    playlist_t *p_playlist = p_preparser->p_playlist;
 
     for( ;; )
     {
@@ -201,11 +252,13 @@ static void *Thread( void *data )
         {
             p_current = p_preparser->pp_waiting[0];
             REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+            if( p_preparser->i_urgent > 0 )
+                p_preparser->i_urgent--;
         }
         else
         {
             p_current = NULL;
-            p_preparser->b_live = false;
+            p_preparser->i_live--;
             vlc_cond_signal( &p_preparser->wait );
         }
         vlc_mutex_unlock( &p_preparser->lock );
@@ -213,9 +266,10 @@ static void *Thread( void *data )
         if( !p_current )
             break;
 
-        Preparse( p_playlist, p_current );
+        Preparse( p_preparser, p_current );
 
         Art( p_preparser, p_current );
+        vlc_gc_decref( p_current );
     }
     return NULL;
 }
@@ -35,7 +35,9 @@
 typedef struct playlist_preparser_t playlist_preparser_t;
 
 /**
- * This function creates the preparser object and thread.
+ * This function creates the preparser object.
+ *
+ * Up to "preparse-threads" threads are run on demand.
  */
 playlist_preparser_t *playlist_preparser_New( playlist_t *, playlist_fetcher_t * );
 
@@ -44,8 +46,11 @@ playlist_preparser_t *playlist_preparser_New( playlist_t *, playlist_fetcher_t *
  *
  * The input item is retained until the preparsing is done or until the
  * preparser object is deleted.
+ * Urgent items (such as the visible ones) are preparsed before the others,
+ * even if they were already waiting.
  */
-void playlist_preparser_Push( playlist_preparser_t *, input_item_t * );
+void playlist_preparser_Push( playlist_preparser_t *, input_item_t *,
+                              bool b_urgent );
 
 /**
  * This function destroys the preparser object and thread.
@@ -24,10 +24,12 @@
 # include "config.h"
 #endif
 #include <assert.h>
+#include <wctype.h>
 
 #include <vlc_common.h>
 #include <vlc_playlist.h>
 #include <vlc_charset.h>
+#include "../libvlc.h"
 #include "playlist_internal.h"
 
 /***************************************************************************
@@ -81,6 +83,149 @@ playlist_item_t* playlist_ItemGetByInput( playlist_t * p_playlist,
 }
 
 
+/***************************************************************************
+ * Search and sort keys
+ ***************************************************************************/
+
+static const vlc_meta_type_t key_metas[PLAYLIST_KEY_COUNT] =
+{
+    [PLAYLIST_KEY_ALBUM]        = vlc_meta_Album,
+    [PLAYLIST_KEY_ARTIST]       = vlc_meta_Artist,
+    [PLAYLIST_KEY_GENRE]        = vlc_meta_Genre,
+    [PLAYLIST_KEY_TRACK_NUMBER] = vlc_meta_TrackNumber,
+    [PLAYLIST_KEY_DESCRIPTION]  = vlc_meta_Description,
+    [PLAYLIST_KEY_RATING]       = vlc_meta_Rating,
+};
+
+/**
+ * Fold the case of an UTF-8 string, so that strstr() on folded strings
+ * matches like vlc_strcasestr() does on the original ones.
+ * @param psz_string: the string to fold
+ * @return the folded string, stopping at the first invalid sequence, or NULL
+ * on error
+ */
+char *playlist_FoldString( const char *psz_string )
+{
+    /* A lower case code point never takes more than twice as many bytes */
+    char *psz_fold = malloc( 2 * strlen( psz_string ) + 1 );
+    if( unlikely(psz_fold == NULL) )
+        return NULL;
+
+    uint8_t *p = (uint8_t *)psz_fold;
+    for( ;; )
+    {
+        uint32_t cp;
+        ssize_t s = vlc_towc( psz_string, &cp );
+        if( s <= 0 )
+            break;
+        psz_string += s;
+
+        cp = towlower( cp );
+        if( cp < 0x80 )
+            *p++ = cp;
+        else if( cp < 0x800 )
+        {
+            *p++ = 0xC0 | (cp >> 6);
+            *p++ = 0x80 | (cp & 0x3F);
+        }
+        else if( cp < 0x10000 )
+        {
+            *p++ = 0xE0 | (cp >> 12);
+            *p++ = 0x80 | ((cp >> 6) & 0x3F);
+            *p++ = 0x80 | (cp & 0x3F);
+        }
+        else
+        {
+            *p++ = 0xF0 | (cp >> 18);
+            *p++ = 0x80 | ((cp >> 12) & 0x3F);
+            *p++ = 0x80 | ((cp >> 6) & 0x3F);
+            *p++ = 0x80 | (cp & 0x3F);
+        }
+    }
+    *p = '\0';
+    return psz_fold;
+}
+
+/**
+ * Free the keys of an item
+ * @param p_item: the item
+ */
+void playlist_ItemCleanKeys( playlist_item_t *p_item )
+{
+    playlist_item_private_t *p = pli_priv(p_item);
+
+    FREENULL( p->psz_search );
+    FREENULL( p->psz_title );
+    for( int i = 0; i < PLAYLIST_KEY_COUNT; i++ )
+        FREENULL( p->ppsz_keys[i] );
+}
+
+/**
+ * Rebuild the keys of an item if its input item changed since they were
+ * last built. The playlist has to be locked.
+ * @param p_item: the item
+ */
+void playlist_ItemUpdateKeys( playlist_item_t *p_item )
+{
+    playlist_item_private_t *p = pli_priv(p_item);
+    input_item_t *p_input = p_item->p_input;
+
+    /* Cleared before reading the input item, so no change can be missed */
+    if( !vlc_atomic_swap( &p->stale, 0 ) )
+        return;
+    playlist_ItemCleanKeys( p_item );
+    p->i_keys_gen++;
+
+    vlc_mutex_lock( &p_input->lock );
+    const char *psz_title = NULL;
+    if( p_input->p_meta )
+    {
+        psz_title = vlc_meta_Get( p_input->p_meta, vlc_meta_Title );
+        for( int i = 0; i < PLAYLIST_KEY_COUNT; i++ )
+        {
+            const char *psz_key = vlc_meta_Get( p_input->p_meta, key_metas[i] );
+            if( psz_key )
+                p->ppsz_keys[i] = strdup( psz_key );
+        }
+    }
+    if( EMPTY_STR( psz_title ) )
+        psz_title = p_input->psz_name;
+    if( psz_title )
+        p->psz_title = strdup( psz_title );
+    p->i_duration = p_input->i_duration;
+    vlc_mutex_unlock( &p_input->lock );
+
+    /* The search key is the list of the folded non empty fields, each one
+     * terminated by a nul, and the list by an empty field */
+    const char *ppsz_fields[] = { p->psz_title,
+                                  p->ppsz_keys[PLAYLIST_KEY_ALBUM],
+                                  p->ppsz_keys[PLAYLIST_KEY_ARTIST] };
+    size_t i_search = 0;
+
+    for( unsigned i = 0; i < sizeof(ppsz_fields) / sizeof(ppsz_fields[0]); i++ )
+    {
+        if( EMPTY_STR( ppsz_fields[i] ) )
+            continue;
+
+        char *psz_fold = playlist_FoldString( ppsz_fields[i] );
+        if( psz_fold == NULL )
+            continue;
+
+        const size_t i_fold = strlen( psz_fold ) + 1;
+        char *psz_search = i_fold > 1
+                         ? realloc( p->psz_search, i_search + i_fold + 1 )
+                         : NULL;
+        if( psz_search )
+        {
+            memcpy( &psz_search[i_search], psz_fold, i_fold );
+            i_search += i_fold;
+            psz_search[i_search] = '\0';
+            p->psz_search = psz_search;
+        }
+        free( psz_fold );
+    }
+}
+
 /***************************************************************************
  * Live search handling
  ***************************************************************************/
@@ -101,14 +246,40 @@ static void playlist_LiveSearchClean( playlist_item_t *p_root )
 }
 
 
+/**
+ * Check whether an item matches the search string
+ * @param p_item: the item
+ * @param psz_string: the folded string to search
+ * @return true if the item matches
+ */
+static bool playlist_LiveSearchMatch( playlist_item_t *p_item,
+                                      const char *psz_string )
+{
+    playlist_ItemUpdateKeys( p_item );
+    pli_priv(p_item)->i_search_gen = pli_priv(p_item)->i_keys_gen;
+
+    for( const char *psz_field = pli_priv(p_item)->psz_search;
+         psz_field != NULL && *psz_field;
+         psz_field += strlen( psz_field ) + 1 )
+    {
+        if( strstr( psz_field, psz_string ) )
+            return true;
+    }
+    return false;
+}
+
 /**
  * Enable/Disable items in the playlist according to the search argument
  * @param p_root: the current root item
- * @param psz_string: the string to search
+ * @param psz_string: the folded string to search
+ * @param b_refine: the items were last filtered with a substring of
+ *                  psz_string, the disabled items cannot match unless their
+ *                  keys changed since they were last checked
  * @return true if an item match
  */
 static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
-                                               const char *psz_string, bool b_recursive )
+                                               const char *psz_string,
+                                               bool b_recursive, bool b_refine )
 {
     int i;
     bool b_match = false;
@@ -118,30 +289,21 @@ static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
         playlist_item_t *p_item = p_root->pp_children[i];
         // Go recurssively if their is some children
         if( b_recursive && p_item->i_children >= 0 &&
-            playlist_LiveSearchUpdateInternal( p_item, psz_string, true ) )
+            playlist_LiveSearchUpdateInternal( p_item, psz_string, true,
+                                               b_refine ) )
         {
             b_enable = true;
         }
 
         if( !b_enable )
         {
-            vlc_mutex_lock( &p_item->p_input->lock );
-            // Do we have some meta ?
-            if( p_item->p_input->p_meta )
-            {
-                // Use Title or fall back to psz_name
-                const char *psz_title = vlc_meta_Get( p_item->p_input->p_meta, vlc_meta_Title );
-                if( !psz_title )
-                    psz_title = p_item->p_input->psz_name;
-                const char *psz_album = vlc_meta_Get( p_item->p_input->p_meta, vlc_meta_Album );
-                const char *psz_artist = vlc_meta_Get( p_item->p_input->p_meta, vlc_meta_Artist );
-                b_enable = ( psz_title && vlc_strcasestr( psz_title, psz_string ) ) ||
-                           ( psz_album && vlc_strcasestr( psz_album, psz_string ) ) ||
-                           ( psz_artist && vlc_strcasestr( psz_artist, psz_string ) );
-            }
-            else
-                b_enable = p_item->p_input->psz_name && vlc_strcasestr( p_item->p_input->psz_name, psz_string );
-            vlc_mutex_unlock( &p_item->p_input->lock );
+            /* The keys may also have been rebuilt by a sort or another
+             * search since this item was checked */
+            playlist_item_private_t *p = pli_priv(p_item);
+            if( !b_refine || !( p_item->i_flags & PLAYLIST_DBL_FLAG ) ||
+                vlc_atomic_get( &p->stale ) ||
+                p->i_search_gen != p->i_keys_gen )
+                b_enable = playlist_LiveSearchMatch( p_item, psz_string );
         }
 
         if( b_enable )
@@ -166,13 +328,34 @@ static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
 int playlist_LiveSearchUpdate( playlist_t *p_playlist, playlist_item_t *p_root,
                                const char *psz_string, bool b_recursive )
 {
+    playlist_private_t *p_sys = pl_priv(p_playlist);
     PL_ASSERT_LOCKED;
-    pl_priv(p_playlist)->b_reset_currently_playing = true;
-    if( *psz_string )
-        playlist_LiveSearchUpdateInternal( p_root, psz_string, b_recursive );
+    p_sys->b_reset_currently_playing = true;
+
+    char *psz_fold = *psz_string ? playlist_FoldString( psz_string ) : NULL;
+    if( psz_fold && *psz_fold )
+    {
+        /* While the user types, each search extends the previous one and
+         * can only disable more items */
+        bool b_refine = p_sys->search.psz_string != NULL &&
+                        p_sys->search.i_root == p_root->i_id &&
+                        p_sys->search.b_recursive == b_recursive &&
+                        strstr( psz_fold, p_sys->search.psz_string ) != NULL;
+
+        playlist_LiveSearchUpdateInternal( p_root, psz_fold, b_recursive,
+                                           b_refine );
+    }
     else
+    {
         playlist_LiveSearchClean( p_root );
-    vlc_cond_signal( &pl_priv(p_playlist)->signal );
+        FREENULL( psz_fold );
+    }
+
+    free( p_sys->search.psz_string );
+    p_sys->search.psz_string = psz_fold;
+    p_sys->search.i_root = p_root->i_id;
+    p_sys->search.b_recursive = b_recursive;
+
+    vlc_cond_signal( &p_sys->signal );
     return VLC_SUCCESS;
 }
-
@@ -35,47 +35,52 @@
 
 /* General comparison functions */
 /**
- * Compare two items using their title or name
- * @param first: the first item
- * @param second: the second item
+ * Compare two strings, the missing ones going last
+ * @param psz_first: the first string or NULL
+ * @param psz_second: the second string or NULL
  * @return -1, 0 or 1 like strcmp
  */
-static inline int meta_strcasecmp_title( const playlist_item_t *first,
-                              const playlist_item_t *second )
+static inline int key_strcasecmp( const char *psz_first,
+                                  const char *psz_second )
 {
-    int i_ret;
-    char *psz_first = input_item_GetTitleFbName( first->p_input );
-    char *psz_second = input_item_GetTitleFbName( second->p_input );
-
     if( psz_first && psz_second )
-        i_ret = strcasecmp( psz_first, psz_second );
+        return strcasecmp( psz_first, psz_second );
     else if( !psz_first && psz_second )
-        i_ret = 1;
+        return 1;
     else if( psz_first && !psz_second )
-        i_ret = -1;
+        return -1;
     else
-        i_ret = 0;
-    free( psz_first );
-    free( psz_second );
+        return 0;
+}
 
-    return i_ret;
+/**
+ * Compare two items using their title or name
+ * @param first: the first item
+ * @param second: the second item
+ * @return -1, 0 or 1 like strcmp
+ */
+static inline int meta_strcasecmp_title( const playlist_item_t *first,
+                              const playlist_item_t *second )
+{
+    return key_strcasecmp( pli_priv(first)->psz_title,
+                           pli_priv(second)->psz_title );
 }
 
 /**
- * Compare two intems accoring to the given meta type
+ * Compare two intems accoring to the given sort key
  * @param first: the first item
  * @param second: the second item
- * @param meta: the meta type to use to sort the items
+ * @param i_key: the PLAYLIST_KEY_* meta to use to sort the items
  * @param b_integer: true if the meta are integers
  * @return -1, 0 or 1 like strcmp
  */
 static inline int meta_sort( const playlist_item_t *first,
                              const playlist_item_t *second,
-                             vlc_meta_type_t meta, bool b_integer )
+                             int i_key, bool b_integer )
 {
     int i_ret;
-    char *psz_first = input_item_GetMeta( first->p_input, meta );
-    char *psz_second = input_item_GetMeta( second->p_input, meta );
+    const char *psz_first = pli_priv(first)->ppsz_keys[i_key];
+    const char *psz_second = pli_priv(second)->ppsz_keys[i_key];
 
     /* Nodes go first */
     if( first->i_children == -1 && second->i_children >= 0 )
@@ -101,8 +106,6 @@ static inline int meta_sort( const playlist_item_t *first,
             i_ret = strcasecmp( psz_first, psz_second );
     }
 
-    free( psz_first );
-    free( psz_second );
     return i_ret;
 }
 
@@ -137,6 +140,9 @@ void playlist_ItemArraySort( unsigned i_items, playlist_item_t **pp_items,
 {
     if( p_sortfn )
     {
+        /* Compare the cached keys, without locking the input items */
+        for( unsigned i = 0; i < i_items; i++ )
+            playlist_ItemUpdateKeys( pp_items[i] );
         qsort( pp_items, i_items, sizeof( pp_items[0] ), p_sortfn );
     }
     else /* Randomise */
@@ -216,17 +222,17 @@ int playlist_RecursiveNodeSort( playlist_t *p_playlist, playlist_item_t *p_node,
 
 SORTFN( SORT_ALBUM, first, second )
 {
-    int i_ret = meta_sort( first, second, vlc_meta_Album, false );
+    int i_ret = meta_sort( first, second, PLAYLIST_KEY_ALBUM, false );
     /* Items came from the same album: compare the track numbers */
     if( i_ret == 0 )
-        i_ret = meta_sort( first, second, vlc_meta_TrackNumber, true );
+        i_ret = meta_sort( first, second, PLAYLIST_KEY_TRACK_NUMBER, true );
 
     return i_ret;
 }
 
 SORTFN( SORT_ARTIST, first, second )
 {
-    int i_ret = meta_sort( first, second, vlc_meta_Artist, false );
+    int i_ret = meta_sort( first, second, PLAYLIST_KEY_ARTIST, false );
     /* Items came from the same artist: compare the albums */
     if( i_ret == 0 )
         i_ret = proto_SORT_ALBUM( first, second );
@@ -236,13 +242,13 @@ SORTFN( SORT_ARTIST, first, second )
 
 SORTFN( SORT_DESCRIPTION, first, second )
 {
-    return meta_sort( first, second, vlc_meta_Description, false );
+    return meta_sort( first, second, PLAYLIST_KEY_DESCRIPTION, false );
 }
 
 SORTFN( SORT_DURATION, first, second )
 {
-    mtime_t time1 = input_item_GetDuration( first->p_input );
-    mtime_t time2 = input_item_GetDuration( second->p_input );
+    mtime_t time1 = pli_priv(first)->i_duration;
+    mtime_t time2 = pli_priv(second)->i_duration;
     int i_ret = time1 > time2 ? 1 :
                     ( time1 == time2 ? 0 : -1 );
     return i_ret;
@@ -250,7 +256,7 @@ SORTFN( SORT_DURATION, first, second )
 
 SORTFN( SORT_GENRE, first, second )
 {
-    return meta_sort( first, second, vlc_meta_Genre, false );
+    return meta_sort( first, second, PLAYLIST_KEY_GENRE, false );
 }
 
 SORTFN( SORT_ID, first, second )
@@ -260,7 +266,7 @@ SORTFN( SORT_ID, first, second )
 
 SORTFN( SORT_RATING, first, second )
 {
-    return meta_sort( first, second, vlc_meta_Rating, true );
+    return meta_sort( first, second, PLAYLIST_KEY_RATING, true );
 }
 
 SORTFN( SORT_TITLE, first, second )
@@ -283,43 +289,30 @@ SORTFN( SORT_TITLE_NODES_FIRST, first, second )
 
 SORTFN( SORT_TITLE_NUMERIC, first, second )
 {
-    int i_ret;
-    char *psz_first = input_item_GetTitleFbName( first->p_input );
-    char *psz_second = input_item_GetTitleFbName( second->p_input );
+    const char *psz_first = pli_priv(first)->psz_title;
+    const char *psz_second = pli_priv(second)->psz_title;
 
     if( psz_first && psz_second )
-        i_ret = atoi( psz_first ) - atoi( psz_second );
+        return atoi( psz_first ) - atoi( psz_second );
     else if( !psz_first && psz_second )
-        i_ret = 1;
+        return 1;
     else if( psz_first && !psz_second )
-        i_ret = -1;
+        return -1;
     else
-        i_ret = 0;
-
-    free( psz_first );
-    free( psz_second );
-    return i_ret;
+        return 0;
 }
 
 SORTFN( SORT_TRACK_NUMBER, first, second )
 {
-    return meta_sort( first, second, vlc_meta_TrackNumber, true );
+    return meta_sort( first, second, PLAYLIST_KEY_TRACK_NUMBER, true );
 }
 
 SORTFN( SORT_URI, first, second )
 {
-    int i_ret;
+    /* The URI is not cached, it does not send change events */
     char *psz_first = input_item_GetURI( first->p_input );
     char *psz_second = input_item_GetURI( second->p_input );
-
-    if( psz_first && psz_second )
-        i_ret = strcasecmp( psz_first, psz_second );
-    else if( !psz_first && psz_second )
-        i_ret = 1;
-    else if( psz_first && !psz_second )
-        i_ret = -1;
-    else
-        i_ret = 0;
+    int i_ret = key_strcasecmp( psz_first, psz_second );
 
     free( psz_first );
     free( psz_second );
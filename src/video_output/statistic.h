@@ -29,11 +29,14 @@ typedef struct {
 
     int displayed;
     int lost;
+
+    mtime_t latency; /* Predicted time to display a decoded picture */
 } vout_statistic_t;
 
 static inline void vout_statistic_Init(vout_statistic_t *stat)
 {
     vlc_spin_init(&stat->spin);
+    stat->latency = 0;
 }
 static inline void vout_statistic_Clean(vout_statistic_t *stat)
 {
@@ -56,5 +59,18 @@ static inline void vout_statistic_Update(vout_statistic_t *stat, int displayed,
     stat->lost      += lost;
     vlc_spin_unlock(&stat->spin);
 }
+static inline void vout_statistic_SetLatency(vout_statistic_t *stat, mtime_t latency)
+{
+    vlc_spin_lock(&stat->spin);
+    stat->latency = latency;
+    vlc_spin_unlock(&stat->spin);
+}
+static inline mtime_t vout_statistic_GetLatency(vout_statistic_t *stat)
+{
+    vlc_spin_lock(&stat->spin);
+    mtime_t latency = stat->latency;
+    vlc_spin_unlock(&stat->spin);
+    return latency;
+}
 
 #endif
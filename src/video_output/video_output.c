@@ -71,6 +71,9 @@ static void VoutDestructor(vlc_object_t *);
 /* Better be in advance when awakening than late... */
 #define VOUT_MWAIT_TOLERANCE (INT64_C(4000))
 
+/* Minimal delay between two reports of late pictures dropped */
+#define VOUT_LATE_REPORT_DELAY (INT64_C(1000000))
+
 /* */
 static int VoutValidateFormat(video_format_t *dst,
                               const video_format_t *src)
@@ -291,6 +294,11 @@ void vout_GetResetStatistic(vout_thread_t *vout, int *displayed, int *lost)
     vout_statistic_GetReset( &vout->p->statistic, displayed, lost );
 }
 
+mtime_t vout_GetDisplayLatency(vout_thread_t *vout)
+{
+    return vout_statistic_GetLatency(&vout->p->statistic);
+}
+
 void vout_Flush(vout_thread_t *vout, mtime_t date)
 {
     vout_control_PushTime(&vout->p->control, VOUT_CONTROL_FLUSH, date);
@@ -814,6 +822,33 @@ static void ThreadChangeFilters(vout_thread_t *vout,
 }
 
 
+/* Time needed to display a picture popped from the decoder fifo */
+static mtime_t ThreadDisplayLatency(vout_thread_t *vout)
+{
+    return vout_chrono_GetLow(&vout->p->static_filter) +
+           vout_chrono_GetLow(&vout->p->render);
+}
+
+/* The late pictures are reported at a limited rate, so that a slow machine
+ * does not flood the log */
+static void ThreadReportLate(vout_thread_t *vout, mtime_t late)
+{
+    vout->p->late.count++;
+    vout->p->late.max = __MAX(vout->p->late.max, late);
+
+    const mtime_t date = mdate();
+    if (date - vout->p->late.date < VOUT_LATE_REPORT_DELAY)
+        return;
+
+    msg_Warn(vout, "%d picture(s) too late to be displayed (missing up to %d ms, "
+             "filtering and rendering take %d ms)",
+             vout->p->late.count, (int)(vout->p->late.max/1000),
+             (int)(ThreadDisplayLatency(vout)/1000));
+    vout->p->late.count = 0;
+    vout->p->late.max   = 0;
+    vout->p->late.date  = date;
+}
+
 /* */
 static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool is_late_dropped)
 {
@@ -831,10 +866,10 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool is_
         } else {
             decoded = picture_fifo_Pop(vout->p->decoder_fifo);
             if (is_late_dropped && decoded && !decoded->b_force) {
-                const mtime_t predicted = mdate() + 0; /* TODO improve */
+                const mtime_t predicted = mdate() + ThreadDisplayLatency(vout);
                 const mtime_t late = predicted - decoded->date;
                 if (late > VOUT_DISPLAY_LATE_THRESHOLD) {
-                    msg_Warn(vout, "picture is too late to be displayed (missing %d ms)", (int)(late/1000));
+                    ThreadReportLate(vout, late);
                     picture_Release(decoded);
                     lost_count++;
                     continue;
@@ -858,7 +893,9 @@ static int ThreadDisplayPreparePicture(vout_thread_t *vout, bool reuse, bool is_
         vout->p->displayed.is_interlaced = !decoded->b_progressive;
         vout->p->displayed.qtype         = decoded->i_qtype;
 
+        vout_chrono_Start(&vout->p->static_filter);
         picture = filter_chain_VideoFilter(vout->p->filter.chain_static, decoded);
+        vout_chrono_Stop(&vout->p->static_filter);
     }
 
     vlc_mutex_unlock(&vout->p->filter.lock);
@@ -1031,6 +1068,7 @@ static int ThreadDisplayRenderPicture(vout_thread_t *vout, bool is_forced)
     }
 
     vout_chrono_Stop(&vout->p->render);
+    vout_statistic_SetLatency(&vout->p->statistic, ThreadDisplayLatency(vout));
 #if 0
         {
         static int i = 0;
@@ -1414,7 +1452,12 @@ static void ThreadInit(vout_thread_t *vout)
     vout->p->pause.is_on      = false;
     vout->p->pause.date       = VLC_TS_INVALID;
 
+    vout->p->late.count       = 0;
+    vout->p->late.max         = 0;
+    vout->p->late.date        = VLC_TS_INVALID;
+
     vout_chrono_Init(&vout->p->render, 5, 10000); /* Arbitrary initial time */
+    vout_chrono_Init(&vout->p->static_filter, 5, 1000); /* Arbitrary initial time */
 }
 
 static void ThreadClean(vout_thread_t *vout)
@@ -1424,6 +1467,7 @@ static void ThreadClean(vout_thread_t *vout)
         vout_window_Delete(vout->p->window.object);
     }
     vout_chrono_Clean(&vout->p->render);
+    vout_chrono_Clean(&vout->p->static_filter);
     vout->p->dead = true;
     vout_control_Dead(&vout->p->control);
 }
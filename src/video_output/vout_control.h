@@ -41,6 +41,12 @@ void spu_OffsetSubtitleDate( spu_t *p_spu, mtime_t i_duration );
  */
 void vout_GetResetStatistic( vout_thread_t *p_vout, int *pi_displayed, int *pi_lost );
 
+/**
+ * This function will return the time needed to filter and render a decoded
+ * picture, as currently measured.
+ */
+mtime_t vout_GetDisplayLatency( vout_thread_t *p_vout );
+
 /**
  * This function will ensure that all ready/displayed pciture have at most
  * the provided dat
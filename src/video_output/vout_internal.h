@@ -117,6 +117,11 @@ struct vout_thread_sys_t
 
     /* */
     bool            is_late_dropped;
+    struct {
+        int         count;      /* pictures dropped since the last report */
+        mtime_t     max;
+        mtime_t     date;       /* date of the last report */
+    } late;
 
     /* Video filter2 chain */
     struct {
@@ -137,6 +142,7 @@ struct vout_thread_sys_t
     picture_pool_t  *decoder_pool;
     picture_fifo_t  *decoder_fifo;
     vout_chrono_t   render;           /**< picture render time estimator */
+    vout_chrono_t   static_filter;    /**< picture static filtering time estimator */
 };
 
 /* TODO to move them to vlc_vout.h */